@@ -24,7 +24,7 @@ template <typename Dtype>
 class Blob {
  public:
   Blob()
-       : data_(), diff_(), count_(0), capacity_(0) {}
+       : data_(), diff_(), count_(0), capacity_(0), lazy_diff_(false) {}
 
   /// @brief Deprecated; use <code>Blob(const vector<int>& shape)</code>.
   explicit Blob(const int num, const int channels, const int height,
@@ -212,10 +212,18 @@ class Blob {
   }
 
   inline const shared_ptr<SyncedMemory>& diff() const {
-    CHECK(diff_);
+    CHECK(diff_) << "The lazy diff is only created when first written";
     return diff_;
   }
 
+  /**
+   * @brief Creates the diff only when first written (mutable_cpu_diff,
+   *        mutable_gpu_diff) instead of with the data, dropping the current
+   *        one. Reading a diff never written is then an error. The blobs of
+   *        inference_only nets never create theirs.
+   */
+  void set_lazy_diff(const bool lazy_diff);
+
   const Dtype* cpu_data() const;
   void set_cpu_data(Dtype* data);
   const int* gpu_shape() const;
@@ -230,6 +238,14 @@ class Blob {
   void Update();
   void FromProto(const BlobProto& proto, bool reshape = true);
   void ToProto(BlobProto* proto, bool write_diff = false) const;
+  /**
+   * @brief Writes the data as 16 bit floats of the given format, rounded to
+   *        the nearest: half the size of a float model file. No diff.
+   *
+   * Storage only: FromProto converts half_data back to Dtype, in which the
+   * blob keeps its data in memory.
+   */
+  void ToHalfProto(BlobProto* proto, const HalfFormat format) const;
 
   /// @brief Compute the sum of absolute values (L1 norm) of the data.
   Dtype asum_data() const;
@@ -252,6 +268,7 @@ class Blob {
    *
    * This deallocates the SyncedMemory holding this Blob's data_, as
    * shared_ptr calls its destructor when reset with the "=" operator.
+   * A later Reshape beyond the shared memory allocates new memory.
    */
   void ShareData(const Blob& other);
   /**
@@ -261,6 +278,7 @@ class Blob {
    *
    * This deallocates the SyncedMemory holding this Blob's diff_, as
    * shared_ptr calls its destructor when reset with the "=" operator.
+   * Nothing is shared with a lazy diff not created yet.
    */
   void ShareDiff(const Blob& other);
 
@@ -273,6 +291,10 @@ class Blob {
   vector<int> shape_;
   int count_;
   int capacity_;
+  bool lazy_diff_;
+
+  /// Replaces the diff after the data was reallocated (unless lazy_diff_)
+  void ResetDiff(const size_t size);
 
   DISABLE_COPY_AND_ASSIGN(Blob);
 };  // class Blob
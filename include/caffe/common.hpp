@@ -65,6 +65,15 @@ private:\
   INSTANTIATE_LAYER_GPU_FORWARD(classname); \
   INSTANTIATE_LAYER_GPU_BACKWARD(classname)
 
+// Runs the following for loop on Caffe::parallel_threads(work) OpenMP threads,
+// work being the number of elements it processes; serially without OpenMP.
+#ifdef _OPENMP
+#define CAFFE_PARALLEL_FOR(work) _Pragma(STRINGIFY(omp parallel for \
+    num_threads(caffe::Caffe::parallel_threads(work))))
+#else
+#define CAFFE_PARALLEL_FOR(work)
+#endif
+
 // A simple macro to mark codes that are not implemented, so that when the code
 // is executed we will see a fatal log.
 #define NOT_IMPLEMENTED LOG(FATAL) << "Not Implemented Yet"
@@ -166,6 +175,14 @@ class Caffe {
   inline static bool multiprocess() { return Get().multiprocess_; }
   inline static void set_multiprocess(bool val) { Get().multiprocess_ = val; }
   inline static bool root_solver() { return Get().solver_rank_ == 0; }
+  // The number of threads of the parallel CPU loops (CAFFE_PARALLEL_FOR),
+  // 1 without OpenMP. Unlike the mode, it is shared by all the threads. 0
+  // (default) keeps the OpenMP default (OMP_NUM_THREADS, or one per core).
+  static int num_threads();
+  static void set_num_threads(const int num_threads);
+  // The number of threads worth running for a loop over work elements, at
+  // most num_threads()
+  static int parallel_threads(const int work);
 
  protected:
 #ifndef CPU_ONLY
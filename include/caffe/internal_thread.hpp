@@ -1,6 +1,8 @@
 #ifndef CAFFE_INTERNAL_THREAD_HPP_
 #define CAFFE_INTERNAL_THREAD_HPP_
 
+#include <vector>
+
 #include "caffe/common.hpp"
 
 /**
@@ -14,21 +16,22 @@ namespace caffe {
 /**
  * Virtual class encapsulate boost::thread for use in base class
  * The child class will acquire the ability to run a single thread,
- * by reimplementing the virtual function InternalThreadEntry.
+ * by reimplementing the virtual function InternalThreadEntry, or a pool of
+ * threads, by reimplementing InternalThreadEntryN.
  */
 class InternalThread {
  public:
-  InternalThread() : thread_() {}
+  InternalThread() : threads_() {}
   virtual ~InternalThread();
 
   /**
    * Caffe's thread local state will be initialized using the current
    * thread values, e.g. device id, solver index etc. The random seed
-   * is initialized using caffe_rng_rand.
+   * is initialized using caffe_rng_rand (a different one per thread).
    */
-  void StartInternalThread();
+  void StartInternalThread(int thread_count = 1);
 
-  /** Will not return until the internal thread has exited. */
+  /** Will not return until all the internal threads have exited. */
   void StopInternalThread();
 
   bool is_started() const;
@@ -37,15 +40,19 @@ class InternalThread {
   /* Implement this method in your subclass
       with the code you want your thread to run. */
   virtual void InternalThreadEntry() {}
+  /* Run by each of the thread_count threads, thread_id in
+      [0, thread_count). Calls InternalThreadEntry by default. */
+  virtual void InternalThreadEntryN(int thread_id) { InternalThreadEntry(); }
 
-  /* Should be tested when running loops to exit when requested. */
+  /* Should be tested by the internal threads when running loops to exit
+      when requested. */
   bool must_stop();
 
  private:
-  void entry(int device, Caffe::Brew mode, int rand_seed,
+  void entry(int thread_id, int device, Caffe::Brew mode, int rand_seed,
       int solver_count, int solver_rank, bool multiprocess);
 
-  shared_ptr<boost::thread> thread_;
+  vector<shared_ptr<boost::thread> > threads_;
 };
 
 }  // namespace caffe
@@ -1,6 +1,8 @@
 #ifndef CAFFE_LAYER_H_
 #define CAFFE_LAYER_H_
 
+#include <stdint.h>
+
 #include <algorithm>
 #include <string>
 #include <vector>
@@ -38,7 +40,7 @@ class Layer {
    * layer.
    */
   explicit Layer(const LayerParameter& param)
-    : layer_param_(param) {
+    : layer_param_(param), reshape_count_(0), reshape_skip_count_(0) {
       // Set phase and copy blobs (if there are any).
       phase_ = param.phase();
       if (layer_param_.blobs_size() > 0) {
@@ -69,6 +71,7 @@ class Layer {
     CheckBlobCounts(bottom, top);
     LayerSetUp(bottom, top);
     Reshape(bottom, top);
+    UpdateReshapeSignature(bottom, top);
     SetLossWeights(top);
   }
 
@@ -119,7 +122,9 @@ class Layer {
    * The Forward wrapper calls the relevant device wrapper function
    * (Forward_cpu or Forward_gpu) to compute the top blob values given the
    * bottom blobs.  If the layer has any non-zero loss_weights, the wrapper
-   * then computes and returns the loss.
+   * then computes and returns the loss. Reshape is called first, unless the
+   * blob shapes did not change since the previous call (see
+   * AllowReshapeSkip).
    *
    * Your layer should implement Forward_cpu and (optionally) Forward_gpu.
    */
@@ -269,6 +274,50 @@ class Layer {
     return true;
   }
 
+  /**
+   * @brief Return whether Forward may replace the data of the top blobs by
+   *        the data of bottom[0] (Blob::ShareData).
+   *
+   * The Net activation memory planner keeps the bottom blob alive as long as
+   * these tops are used. Sharing done by Reshape needs no override, the
+   * planner already sees it.
+   */
+  virtual inline bool ForwardSharesBottomData() const { return false; }
+
+  /**
+   * @brief Return whether the layer computes correctly, Forward and Backward
+   *        alike, with top[0] being bottom[0] (in-place computation).
+   *
+   * NetParameter.optimize_in_place then computes it in place when nothing
+   * else uses its bottom.
+   */
+  virtual inline bool AllowInPlace() const { return false; }
+
+  /**
+   * @brief Return whether Backward reads the data of the top blobs (e.g.
+   *        Sigmoid derives its gradient from its output), bottoms computed in
+   *        place included (e.g. ReLU).
+   *
+   * NetParameter.optimize_in_place does not let the next layer overwrite
+   * them. Layers known not to read them return false.
+   */
+  virtual inline bool BackwardUsesTopData() const { return true; }
+
+  /**
+   * @brief Return whether Forward may skip Reshape when the bottom and top
+   *        blobs, their shapes and the memory of the bottom blobs are the
+   *        same as at the previous Reshape.
+   *
+   * Layers whose Reshape depends on anything else (e.g. on the bottom
+   * values, as Filter) should return false.
+   */
+  virtual inline bool AllowReshapeSkip() const { return true; }
+
+  /// @brief Number of Forward calls that ran Reshape.
+  inline int reshape_count() const { return reshape_count_; }
+  /// @brief Number of Forward calls that skipped Reshape.
+  inline int reshape_skip_count() const { return reshape_skip_count_; }
+
   /**
    * @brief Specifies whether the layer should compute gradients w.r.t. a
    *        parameter at a particular index given by param_id.
@@ -306,6 +355,18 @@ class Layer {
    *  the objective function. */
   vector<Dtype> loss_;
 
+  /** The blobs, their shapes and the bottom memory at the last Reshape. */
+  vector<intptr_t> reshape_signature_;
+  int reshape_count_;
+  int reshape_skip_count_;
+
+  /**
+   * Updates reshape_signature_ and returns whether it changed, i.e. whether
+   * Reshape must run.
+   */
+  bool UpdateReshapeSignature(const vector<Blob<Dtype>*>& bottom,
+      const vector<Blob<Dtype>*>& top);
+
   /** @brief Using the CPU device, compute the layer output. */
   virtual void Forward_cpu(const vector<Blob<Dtype>*>& bottom,
       const vector<Blob<Dtype>*>& top) = 0;
@@ -413,7 +474,14 @@ template <typename Dtype>
 inline Dtype Layer<Dtype>::Forward(const vector<Blob<Dtype>*>& bottom,
     const vector<Blob<Dtype>*>& top) {
   Dtype loss = 0;
-  Reshape(bottom, top);
+  if (UpdateReshapeSignature(bottom, top) || !AllowReshapeSkip()) {
+    Reshape(bottom, top);
+    // The top shapes are part of the signature
+    UpdateReshapeSignature(bottom, top);
+    ++reshape_count_;
+  } else {
+    ++reshape_skip_count_;
+  }
   switch (Caffe::mode()) {
   case Caffe::CPU:
     Forward_cpu(bottom, top);
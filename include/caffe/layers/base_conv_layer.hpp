@@ -7,6 +7,7 @@
 #include "caffe/layer.hpp"
 #include "caffe/proto/caffe.pb.h"
 #include "caffe/util/im2col.hpp"
+#include "caffe/util/int8_gemm.hpp"
 
 namespace caffe {
 
@@ -27,6 +28,7 @@ class BaseConvolutionLayer : public Layer<Dtype> {
   virtual inline int MinBottomBlobs() const { return 1; }
   virtual inline int MinTopBlobs() const { return 1; }
   virtual inline bool EqualNumBottomTopBlobs() const { return true; }
+  virtual inline bool BackwardUsesTopData() const { return false; }
 
  protected:
   // Helper functions that abstract away the column buffer and gemm arguments.
@@ -40,6 +42,17 @@ class BaseConvolutionLayer : public Layer<Dtype> {
   void weight_cpu_gemm(const Dtype* input, const Dtype* output, Dtype*
       weights);
   void backward_cpu_bias(Dtype* bias, const Dtype* input);
+  // Batched versions (col_buffer_batch_kb): lower batch images at once, so
+  // that each group runs a single GEMM for all of them. backward_cpu_gemm_batch
+  // computes the weight gradient and the input gradient, unless NULL.
+  void forward_cpu_gemm_batch(const Dtype* input, const Dtype* weights,
+      Dtype* output, const int batch);
+  void backward_cpu_gemm_batch(const Dtype* input, const Dtype* output,
+      const Dtype* weights, Dtype* weight_diff, Dtype* input_diff,
+      const int batch);
+  // forward_cpu_gemm with the quantized weights of int8_gemm (without bias)
+  void forward_cpu_gemm_int8(const Dtype* input, Int8Gemm<Dtype>* int8_gemm,
+      Dtype* output);
 
 #ifndef CPU_ONLY
   void forward_gpu_gemm(const Dtype* col_input, const Dtype* weights,
@@ -92,31 +105,37 @@ class BaseConvolutionLayer : public Layer<Dtype> {
   bool bias_term_;
   bool is_1x1_;
   bool force_nd_im2col_;
+  /// @brief The number of images lowered at once on CPU (1: not batched).
+  int col_batch_;
 
  private:
   // wrap im2col/col2im so we don't have to remember the (long) argument lists
-  inline void conv_im2col_cpu(const Dtype* data, Dtype* col_buff) {
+  // col_stride (2D only): see im2col_cpu
+  inline void conv_im2col_cpu(const Dtype* data, Dtype* col_buff,
+      const int col_stride = 0) {
     if (!force_nd_im2col_ && num_spatial_axes_ == 2) {
       im2col_cpu(data, conv_in_channels_,
           conv_input_shape_.cpu_data()[1], conv_input_shape_.cpu_data()[2],
           kernel_shape_.cpu_data()[0], kernel_shape_.cpu_data()[1],
           pad_.cpu_data()[0], pad_.cpu_data()[1],
           stride_.cpu_data()[0], stride_.cpu_data()[1],
-          dilation_.cpu_data()[0], dilation_.cpu_data()[1], col_buff);
+          dilation_.cpu_data()[0], dilation_.cpu_data()[1], col_buff,
+          col_stride);
     } else {
       im2col_nd_cpu(data, num_spatial_axes_, conv_input_shape_.cpu_data(),
           col_buffer_shape_.data(), kernel_shape_.cpu_data(),
           pad_.cpu_data(), stride_.cpu_data(), dilation_.cpu_data(), col_buff);
     }
   }
-  inline void conv_col2im_cpu(const Dtype* col_buff, Dtype* data) {
+  inline void conv_col2im_cpu(const Dtype* col_buff, Dtype* data,
+      const int col_stride = 0) {
     if (!force_nd_im2col_ && num_spatial_axes_ == 2) {
       col2im_cpu(col_buff, conv_in_channels_,
           conv_input_shape_.cpu_data()[1], conv_input_shape_.cpu_data()[2],
           kernel_shape_.cpu_data()[0], kernel_shape_.cpu_data()[1],
           pad_.cpu_data()[0], pad_.cpu_data()[1],
           stride_.cpu_data()[0], stride_.cpu_data()[1],
-          dilation_.cpu_data()[0], dilation_.cpu_data()[1], data);
+          dilation_.cpu_data()[0], dilation_.cpu_data()[1], data, col_stride);
     } else {
       col2im_nd_cpu(col_buff, num_spatial_axes_, conv_input_shape_.cpu_data(),
           col_buffer_shape_.data(), kernel_shape_.cpu_data(),
@@ -167,6 +186,10 @@ class BaseConvolutionLayer : public Layer<Dtype> {
 
   Blob<Dtype> col_buffer_;
   Blob<Dtype> bias_multiplier_;
+  // Column buffer and output (or output gradient) of col_batch_ images,
+  // column n * conv_out_spatial_dim_ + i being position i of image n
+  Blob<Dtype> col_batch_buffer_;
+  Blob<Dtype> output_batch_buffer_;
 };
 
 }  // namespace caffe
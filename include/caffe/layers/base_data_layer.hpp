@@ -1,6 +1,7 @@
 #ifndef CAFFE_DATA_LAYERS_HPP_
 #define CAFFE_DATA_LAYERS_HPP_
 
+#include <map>
 #include <vector>
 
 #include "caffe/blob.hpp"
@@ -49,6 +50,25 @@ class Batch {
   Blob<Dtype> data_, label_;
 };
 
+/**
+ * @brief Loads batches ahead of Forward on data_param.prefetch_threads
+ *        worker threads.
+ *
+ * Each batch gets a sequence number when a worker starts loading it, and
+ * finished batches go through a reorder buffer, so Forward sees them in
+ * sequence order whatever the number of workers. load_batch is called in
+ * an ordered section: a worker only starts once the previous batch has been
+ * read, so state shared by consecutive batches (DB cursors, file lists)
+ * is used in batch order. Layers whose load_batch is otherwise thread-safe
+ * leave the section early with EndOrderedRead (e.g. once the raw data is
+ * read, before decoding and transforming it), letting the workers
+ * overlap; the others keep loading one batch at a time.
+ *
+ * Forward does not copy batches: the tops share the batch memory
+ * (Blob::ShareData), which stays valid until the next Forward. The batch
+ * is then returned to the prefetch threads, so blobs still referencing it
+ * must not be read anymore.
+ */
 template <typename Dtype>
 class BasePrefetchingDataLayer :
     public BaseDataLayer<Dtype>, public InternalThread {
@@ -65,16 +85,89 @@ class BasePrefetchingDataLayer :
   virtual void Forward_gpu(const vector<Blob<Dtype>*>& bottom,
       const vector<Blob<Dtype>*>& top);
 
+  struct PrefetchStats {
+    // Number of batches
+    int depth;
+    // Fraction of the time Forward waited for a batch, and fraction of the
+    // prefetch threads time spent waiting for a free batch
+    double stall_ratio;
+    double loader_wait_ratio;
+  };
+  /// @brief Returns the prefetching statistics since the previous call.
+  PrefetchStats prefetch_stats();
+
+  /**
+   * @brief Whether batches can be added or removed once the prefetch threads
+   *        run (data_param.prefetch_max). Layers keeping per-batch state
+   *        indexed like prefetch_ should return false.
+   */
+  virtual inline bool AllowPrefetchResize() const { return true; }
+
  protected:
-  virtual void InternalThreadEntry();
+  // Queue wait totals at a given time
+  struct PrefetchSnapshot {
+    double seconds;
+    double consumer_wait_seconds;
+    double loader_wait_seconds;
+  };
+  PrefetchSnapshot TakePrefetchSnapshot() const;
+  // Called by Forward, adds or removes a batch based on the waits
+  void AdaptPrefetch();
+  void AddPrefetchBatch();
+  void RemovePrefetchBatch();
+  void ErasePrefetchBatch(Batch<Dtype>* batch);
+  // Called by Forward, returns prefetch_current_ to prefetch_free_ (or
+  // removes it, see RemovePrefetchBatch)
+  void ReleaseCurrentBatch();
+  // Makes the tops share the memory of prefetch_current_
+  void ShareCurrentBatch(const vector<Blob<Dtype>*>& top);
+
+  virtual void InternalThreadEntryN(int worker);
   virtual void load_batch(Batch<Dtype>* batch) = 0;
 
+  /// @brief Called by load_batch, at most once, to let the next batch be
+  ///        read while this one is being finished.
+  void EndOrderedRead();
+  /// @brief Index of the calling prefetch worker, in [0, prefetch_threads).
+  int prefetch_worker() const;
+  /// @brief The DataTransformer of the calling prefetch worker (its random
+  ///        generator is not shared).
+  DataTransformer<Dtype>* prefetch_transformer() const;
+
   vector<shared_ptr<Batch<Dtype> > > prefetch_;
   BlockingQueue<Batch<Dtype>*> prefetch_free_;
   BlockingQueue<Batch<Dtype>*> prefetch_full_;
   Batch<Dtype>* prefetch_current_;
 
   Blob<Dtype> transformed_data_;
+
+  int prefetch_threads_;
+  vector<shared_ptr<DataTransformer<Dtype> > > prefetch_transformers_;
+
+  // Adaptive prefetching (disabled if prefetch_max_ <= prefetch_min_)
+  int prefetch_min_;
+  int prefetch_max_;
+  size_t prefetch_max_bytes_;
+  int prefetch_forwards_;
+  int prefetch_quiet_periods_;
+  // Set when no batch was free to remove, prefetch_current_ is removed once
+  // released
+  bool prefetch_remove_pending_;
+  PrefetchSnapshot prefetch_adapt_snapshot_;
+  PrefetchSnapshot prefetch_stats_snapshot_;
+
+ private:
+  void PublishBatch(uint64_t sequence, Batch<Dtype>* batch);
+
+  // Same as BlockingQueue, keeps boost/thread.hpp out of the header
+  class sync;
+  shared_ptr<sync> sync_;
+  // Next sequence number to hand out, sequence number allowed in the
+  // ordered section and next one to push to prefetch_full_
+  uint64_t prefetch_sequence_;
+  uint64_t prefetch_read_turn_;
+  uint64_t prefetch_published_;
+  std::map<uint64_t, Batch<Dtype>*> prefetch_reorder_;
 };
 
 }  // namespace caffe
@@ -26,6 +26,11 @@ class ConcatLayer : public Layer<Dtype> {
   virtual inline const char* type() const { return "Concat"; }
   virtual inline int MinBottomBlobs() const { return 1; }
   virtual inline int ExactNumTopBlobs() const { return 1; }
+  virtual inline bool BackwardUsesTopData() const { return false; }
+
+  /// @brief The number of concatenations, 1 if the bottoms are contiguous
+  ///        in the top (see Net::PlanActivationMemory)
+  inline int num_concats() const { return num_concats_; }
 
  protected:
   /**
@@ -56,16 +56,50 @@ class ConvolutionLayer : public BaseConvolutionLayer<Dtype> {
    *  output channels. Concretely 4 input channels, 8 output channels, and
    *  2 groups separate input channels 1-2 and output channels 1-4 into the
    *  first group and input channels 3-4 and output channels 5-8 into the second
-   *  group.
+   *  group. On CPU, 2D convolutions with at most kMaxGroupChannels input
+   *  channels per group (such as depthwise convolutions) are computed
+   *  directly, without im2col.
    *  - bias_term (\b optional, default true). Whether to have a bias.
    *  - engine: convolution has CAFFE (matrix multiplication) and CUDNN (library
    *    kernels + stream parallelism) engines.
    */
   explicit ConvolutionLayer(const LayerParameter& param)
-      : BaseConvolutionLayer<Dtype>(param) {}
+      : BaseConvolutionLayer<Dtype>(param), fused_batch_norm_(NULL),
+        fused_scale_(NULL), fused_relu_(NULL) {}
 
   virtual inline const char* type() const { return "Convolution"; }
 
+  /**
+   * @brief Computes the given in place layers following this one within
+   *        Forward, for inference (NetParameter.fuse_inference_layers): the
+   *        BatchNorm (global statistics) and Scale (per channel) layers are
+   *        folded into the weights and bias, which are applied together with
+   *        the ReLU in a single pass over the output of the GEMM. Each layer
+   *        may be NULL. Returns false if this engine cannot fuse them, in
+   *        which case nothing changes.
+   *
+   * The folded weights are computed again whenever any of the parameters of
+   * the fused layers changed. Backward ignores the fused layers.
+   */
+  virtual bool FuseInference(Layer<Dtype>* batch_norm, Layer<Dtype>* scale,
+      Layer<Dtype>* relu);
+
+  /**
+   * @brief Quantizes the weights (folded with the fused layers) for the int8
+   *        inference path, unless they did not change or the layer has no
+   *        quantization_param.
+   *
+   * In the TEST phase, with a quantization_param, Forward_cpu computes the
+   * products with the int8 weights and the input quantized over the
+   * calibrated range, except for the grouped kernel (use_grouped_kernel).
+   * Forward quantizes the weights again whenever they changed; Net quantizes
+   * them as they are loaded (CopyTrainedLayersFrom).
+   */
+  void QuantizeWeights();
+
+  /// @brief The most input channels per group of the grouped CPU kernel.
+  static const int kMaxGroupChannels = 8;
+
  protected:
   virtual void Forward_cpu(const vector<Blob<Dtype>*>& bottom,
       const vector<Blob<Dtype>*>& top);
@@ -77,6 +111,35 @@ class ConvolutionLayer : public BaseConvolutionLayer<Dtype> {
       const vector<bool>& propagate_down, const vector<Blob<Dtype>*>& bottom);
   virtual inline bool reverse_dimensions() { return false; }
   virtual void compute_output_shape();
+
+  // Folds the fused BatchNorm and Scale layers into fused_weights_ and
+  // fused_bias_, unless fused_versions_ are still current
+  void FoldFusedLayers();
+  // Adds the bias (if not NULL) and applies the fused ReLU (if any) to the
+  // output of one image
+  void forward_cpu_bias_relu(Dtype* output, const Dtype* bias);
+  // Whether Forward_cpu uses forward_cpu_grouped: 2D convolutions with
+  // several groups of at most kMaxGroupChannels input channels (depthwise
+  // convolutions having one)
+  bool use_grouped_kernel();
+  // Computes the output of one image directly from the input, without
+  // col_buffer_: each filter tap adds the shifted input channel, scaled by
+  // the weight, to the output channel. Many tiny GEMMs per group would be
+  // slower.
+  void forward_cpu_grouped(const Dtype* input, const Dtype* weights,
+      Dtype* output);
+  // Whether Forward_cpu uses the int8 weights (see QuantizeWeights)
+  bool use_int8();
+
+  Layer<Dtype>* fused_batch_norm_;
+  Layer<Dtype>* fused_scale_;
+  Layer<Dtype>* fused_relu_;
+  /// @brief The versions (SyncedMemory::version) of the parameters
+  ///        fused_weights_ and fused_bias_ were computed from.
+  vector<uint64_t> fused_versions_;
+  Blob<Dtype> fused_weights_;
+  Blob<Dtype> fused_bias_;
+  Int8Gemm<Dtype> int8_gemm_;
 };
 
 }  // namespace caffe
@@ -37,6 +37,9 @@ class CuDNNConvolutionLayer : public ConvolutionLayer<Dtype> {
   virtual void Reshape(const vector<Blob<Dtype>*>& bottom,
       const vector<Blob<Dtype>*>& top);
   virtual ~CuDNNConvolutionLayer();
+  // The fused layers are not computed by Forward_gpu
+  virtual bool FuseInference(Layer<Dtype>* batch_norm, Layer<Dtype>* scale,
+      Layer<Dtype>* relu) { return false; }
 
  protected:
   virtual void Forward_gpu(const vector<Blob<Dtype>*>& bottom,
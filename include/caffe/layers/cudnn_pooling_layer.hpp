@@ -29,6 +29,8 @@ class CuDNNPoolingLayer : public PoolingLayer<Dtype> {
   // Currently, cuDNN does not support the extra top blob.
   virtual inline int MinTopBlobs() const { return -1; }
   virtual inline int ExactNumTopBlobs() const { return 1; }
+  // cuDNN finds the max positions from the output
+  virtual inline bool BackwardUsesTopData() const { return true; }
 
  protected:
   virtual void Forward_gpu(const vector<Blob<Dtype>*>& bottom,
@@ -0,0 +1,68 @@
+#ifndef CAFFE_DIRECT_CONV_LAYER_HPP_
+#define CAFFE_DIRECT_CONV_LAYER_HPP_
+
+#include <vector>
+
+#include "caffe/blob.hpp"
+#include "caffe/layer.hpp"
+#include "caffe/proto/caffe.pb.h"
+
+#include "caffe/layers/conv_layer.hpp"
+
+namespace caffe {
+
+/**
+ * @brief Direct implementation of ConvolutionLayer (CPU forward pass), without
+ *        column buffer.
+ *
+ * The filters are stored blocked by kBlock output channels (OIhw8o), so the
+ * innermost loop multiplies one input value by kBlock consecutive weights, for
+ * kTileWidth outputs of a row at once: the kTileWidth x kBlock accumulators
+ * stay in (AVX2 / AVX-512) vector registers. Only a zero-padded copy of the
+ * input is made, instead of the kernel size times larger im2col buffer.
+ *
+ * The blobs keep the NCHW layout. The filters are blocked again only when the
+ * weights changed. Backward, the GPU and other than 2D convolutions use
+ * ConvolutionLayer (im2col).
+ */
+template <typename Dtype>
+class DirectConvolutionLayer : public ConvolutionLayer<Dtype> {
+ public:
+  explicit DirectConvolutionLayer(const LayerParameter& param)
+      : ConvolutionLayer<Dtype>(param), use_direct_(false),
+        weights_version_(0) {}
+  virtual void LayerSetUp(const vector<Blob<Dtype>*>& bottom,
+      const vector<Blob<Dtype>*>& top);
+  virtual void Reshape(const vector<Blob<Dtype>*>& bottom,
+      const vector<Blob<Dtype>*>& top);
+  // The fused layers are not computed by Forward_cpu
+  virtual bool FuseInference(Layer<Dtype>* batch_norm, Layer<Dtype>* scale,
+      Layer<Dtype>* relu) { return false; }
+
+  /// @brief The number of output channels computed together.
+  static const int kBlock = 8;
+  /// @brief The number of outputs of a row computed together.
+  static const int kTileWidth = 4;
+
+ protected:
+  virtual void Forward_cpu(const vector<Blob<Dtype>*>& bottom,
+      const vector<Blob<Dtype>*>& top);
+
+  // Blocks the filters into filters_, unless weights_version_ is still
+  // current
+  void BlockFilters();
+
+  bool use_direct_;
+  /// @brief The version (SyncedMemory::version) of the weights filters_ was
+  ///        computed from.
+  uint64_t weights_version_;
+  /// @brief Output channel blocks x channels / group x kernel x kBlock
+  ///        filters, zero beyond num_output.
+  Blob<Dtype> filters_;
+  /// @brief channels x padded height x padded width input of one image.
+  Blob<Dtype> padded_input_;
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_DIRECT_CONV_LAYER_HPP_
@@ -39,6 +39,8 @@ class DropoutLayer : public NeuronLayer<Dtype> {
       const vector<Blob<Dtype>*>& top);
 
   virtual inline const char* type() const { return "Dropout"; }
+  virtual inline bool AllowInPlace() const { return true; }
+  virtual inline bool BackwardUsesTopData() const { return false; }
 
  protected:
   /**
@@ -28,6 +28,16 @@ class EltwiseLayer : public Layer<Dtype> {
   virtual inline const char* type() const { return "Eltwise"; }
   virtual inline int MinBottomBlobs() const { return 2; }
   virtual inline int ExactNumTopBlobs() const { return 1; }
+  // Sums are computed in place in bottom[0], products read the top in
+  // Backward
+  virtual inline bool AllowInPlace() const {
+    return this->layer_param_.eltwise_param().operation() ==
+        EltwiseParameter_EltwiseOp_SUM;
+  }
+  virtual inline bool BackwardUsesTopData() const {
+    return this->layer_param_.eltwise_param().operation() ==
+        EltwiseParameter_EltwiseOp_PROD;
+  }
 
  protected:
   virtual void Forward_cpu(const vector<Blob<Dtype>*>& bottom,
@@ -6,6 +6,7 @@
 #include "caffe/blob.hpp"
 #include "caffe/layer.hpp"
 #include "caffe/proto/caffe.pb.h"
+#include "caffe/util/int8_gemm.hpp"
 
 namespace caffe {
 
@@ -28,6 +29,17 @@ class InnerProductLayer : public Layer<Dtype> {
   virtual inline const char* type() const { return "InnerProduct"; }
   virtual inline int ExactNumBottomBlobs() const { return 1; }
   virtual inline int ExactNumTopBlobs() const { return 1; }
+  virtual inline bool BackwardUsesTopData() const { return false; }
+
+  /**
+   * @brief Quantizes the weights for the int8 inference path, unless they did
+   *        not change or the layer has no quantization_param.
+   *
+   * In the TEST phase, with a quantization_param, Forward_cpu computes the
+   * inner products with the int8 weights and the input quantized over the
+   * calibrated range (see ConvolutionLayer::QuantizeWeights).
+   */
+  void QuantizeWeights();
 
  protected:
   virtual void Forward_cpu(const vector<Blob<Dtype>*>& bottom,
@@ -38,6 +50,8 @@ class InnerProductLayer : public Layer<Dtype> {
       const vector<bool>& propagate_down, const vector<Blob<Dtype>*>& bottom);
   virtual void Backward_gpu(const vector<Blob<Dtype>*>& top,
       const vector<bool>& propagate_down, const vector<Blob<Dtype>*>& bottom);
+  // Whether Forward_cpu uses the int8 weights (see QuantizeWeights)
+  bool use_int8();
 
   int M_;
   int K_;
@@ -45,6 +59,7 @@ class InnerProductLayer : public Layer<Dtype> {
   bool bias_term_;
   Blob<Dtype> bias_multiplier_;
   bool transpose_;  ///< if true, assume transposed weights
+  Int8Gemm<Dtype> int8_gemm_;
 };
 
 }  // namespace caffe
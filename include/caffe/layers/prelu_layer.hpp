@@ -40,6 +40,8 @@ class PReLULayer : public NeuronLayer<Dtype> {
       const vector<Blob<Dtype>*>& top);
 
   virtual inline const char* type() const { return "PReLU"; }
+  virtual inline bool AllowInPlace() const { return true; }
+  virtual inline bool BackwardUsesTopData() const { return false; }
 
  protected:
   /**
@@ -35,6 +35,8 @@ class PythonLayer : public Layer<Dtype> {
   }
 
   virtual inline const char* type() const { return "Python"; }
+  // reshape may depend on the layer state (e.g. the next input to load)
+  virtual inline bool AllowReshapeSkip() const { return false; }
 
  protected:
   virtual void Forward_cpu(const vector<Blob<Dtype>*>& bottom,
@@ -37,6 +37,8 @@ class ScaleLayer: public Layer<Dtype> {
   virtual inline int MinBottomBlobs() const { return 1; }
   virtual inline int MaxBottomBlobs() const { return 2; }
   virtual inline int ExactNumTopBlobs() const { return 1; }
+  virtual inline bool AllowInPlace() const { return true; }
+  virtual inline bool BackwardUsesTopData() const { return false; }
 
  protected:
   /**
@@ -29,6 +29,10 @@ class SliceLayer : public Layer<Dtype> {
   virtual inline int ExactNumBottomBlobs() const { return 1; }
   virtual inline int MinTopBlobs() const { return 1; }
 
+  /// @brief The number of slices, 1 if the tops are contiguous in the bottom
+  ///        (see Net::PlanActivationMemory)
+  inline int num_slices() const { return num_slices_; }
+
  protected:
   virtual void Forward_cpu(const vector<Blob<Dtype>*>& bottom,
       const vector<Blob<Dtype>*>& top);
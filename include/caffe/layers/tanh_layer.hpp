@@ -26,6 +26,7 @@ class TanHLayer : public NeuronLayer<Dtype> {
       : NeuronLayer<Dtype>(param) {}
 
   virtual inline const char* type() const { return "TanH"; }
+  virtual inline bool AllowInPlace() const { return true; }
 
  protected:
   /**
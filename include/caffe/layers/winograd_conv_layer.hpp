@@ -0,0 +1,69 @@
+#ifndef CAFFE_WINOGRAD_CONV_LAYER_HPP_
+#define CAFFE_WINOGRAD_CONV_LAYER_HPP_
+
+#include <vector>
+
+#include "caffe/blob.hpp"
+#include "caffe/layer.hpp"
+#include "caffe/proto/caffe.pb.h"
+
+#include "caffe/layers/conv_layer.hpp"
+
+namespace caffe {
+
+/**
+ * @brief Winograd implementation of ConvolutionLayer (CPU forward pass).
+ *
+ * 3x3 filters with stride 1 and no dilation are computed with the minimal
+ * filtering algorithm F(m x m, 3 x 3) (Lavin & Gray, "Fast Algorithms for
+ * Convolutional Neural Networks", 2016), m being winograd_tile (2 or 4): each
+ * (m + 2) x (m + 2) input tile yields an m x m output tile with one GEMM per
+ * tile element, reducing the multiplications 2.25 (m = 2) or 4 (m = 4) times
+ * compared to im2col.
+ *
+ * The filters are transformed again only when the weights changed. Other
+ * filter shapes, Backward and the GPU use ConvolutionLayer (im2col).
+ */
+template <typename Dtype>
+class WinogradConvolutionLayer : public ConvolutionLayer<Dtype> {
+ public:
+  explicit WinogradConvolutionLayer(const LayerParameter& param)
+      : ConvolutionLayer<Dtype>(param), use_winograd_(false),
+        weights_version_(0) {}
+  virtual void LayerSetUp(const vector<Blob<Dtype>*>& bottom,
+      const vector<Blob<Dtype>*>& top);
+  virtual void Reshape(const vector<Blob<Dtype>*>& bottom,
+      const vector<Blob<Dtype>*>& top);
+  // The fused layers are not computed by Forward_cpu
+  virtual bool FuseInference(Layer<Dtype>* batch_norm, Layer<Dtype>* scale,
+      Layer<Dtype>* relu) { return false; }
+
+ protected:
+  virtual void Forward_cpu(const vector<Blob<Dtype>*>& bottom,
+      const vector<Blob<Dtype>*>& top);
+
+  // Transforms the filters into filters_, unless weights_version_ is still
+  // current
+  void TransformFilters();
+
+  bool use_winograd_;
+  /// @brief The output tile size m, and the input tile size m + 2.
+  int tile_;
+  int alpha_;
+  int tiles_h_;
+  int tiles_w_;
+  /// @brief The version (SyncedMemory::version) of the weights filters_ was
+  ///        computed from.
+  uint64_t weights_version_;
+  /// @brief alpha x alpha x num_output x channels / group transformed filters.
+  Blob<Dtype> filters_;
+  /// @brief alpha x alpha x channels x tiles transformed input tiles.
+  Blob<Dtype> input_tiles_;
+  /// @brief alpha x alpha x num_output x tiles products, before the inverse
+  ///        transform.
+  Blob<Dtype> output_tiles_;
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_WINOGRAD_CONV_LAYER_HPP_
@@ -25,7 +25,8 @@ class Net {
  public:
   explicit Net(const NetParameter& param);
   explicit Net(const string& param_file, Phase phase,
-      const int level = 0, const vector<string>* stages = NULL);
+      const int level = 0, const vector<string>* stages = NULL,
+      const bool inference_only = false);
   virtual ~Net() {}
 
   /// @brief Initialize a network with a NetParameter.
@@ -135,6 +136,8 @@ class Net {
   }
   /// @brief returns the phase: TRAIN or TEST
   inline Phase phase() const { return phase_; }
+  /// @brief returns whether the net is forward-only (see inference_only)
+  inline bool inference_only() const { return inference_only_; }
   /**
    * @brief returns the bottom vecs for each layer -- usually you won't
    *        need this unless you do per-layer checks such as gradients.
@@ -170,6 +173,11 @@ class Net {
   inline const vector<bool>& layer_need_backward() const {
     return layer_need_backward_;
   }
+  /// @brief Whether each layer is computed by a previous one (and skipped by
+  ///        Forward), see fuse_inference_layers
+  inline const vector<bool>& layer_fused() const {
+    return layer_fused_;
+  }
   /// @brief returns the parameters
   inline const vector<shared_ptr<Blob<Dtype> > >& params() const {
     return params_;
@@ -216,6 +224,12 @@ class Net {
 
   void set_debug_info(const bool value) { debug_info_ = value; }
 
+  /// @brief returns the bytes of the shared activation arena (0 if the
+  ///        activation memory is not optimized)
+  inline size_t activation_memory_size() const {
+    return activation_memory_ ? activation_memory_->size() : 0;
+  }
+
   // Helpers for Init.
   /**
    * @brief Remove layers that the user specified should be excluded given the current
@@ -262,10 +276,49 @@ class Net {
   int AppendBottom(const NetParameter& param, const int layer_id,
                    const int bottom_id, set<string>* available_blobs,
                    map<string, int>* blob_name_to_idx);
+  /**
+   * @brief Makes layer layer_id compute in place if possible
+   *        (optimize_in_place): renames its top like its bottom in param, as
+   *        well as the later uses of the top, which is added to aliases.
+   */
+  void PlanInPlace(const int layer_id,
+      const map<string, int>& blob_name_to_idx, NetParameter* param,
+      map<string, string>* aliases);
   /// @brief Append a new parameter blob to the net.
   void AppendParam(const NetParameter& param, const int layer_id,
                    const int param_id);
 
+  /**
+   * @brief Clears the backward flags of the layers and bottoms that do not
+   *        contribute to the loss (nothing to do for inference_only nets).
+   */
+  void MarkBackwardUnderLoss();
+  /**
+   * @brief Whether Backward would run any layer (not for inference_only nets,
+   *        always with force_backward).
+   */
+  bool BackwardNeeded() const;
+  /**
+   * @brief Lets the convolutions compute the BatchNorm, Scale and ReLU layers
+   *        directly following them in place (fuse_inference_layers), marking
+   *        those in layer_fused_.
+   */
+  void FuseInferenceLayers(const NetParameter& param);
+  /**
+   * @brief Quantizes the weights of the convolutions and inner products with
+   *        a quantization_param, as CopyTrainedLayersFrom loaded them.
+   */
+  void QuantizeLayers();
+
+  /**
+   * @brief Assigns the (non-pinned) activations to offsets of a single arena,
+   *        reusing the memory of the blobs whose last consumer already ran.
+   *        The inputs of a Concat (outputs of a Slice) become views of its
+   *        output (input) when possible, saving the copies.
+   *        Called by Init and Reshape if optimize_activation_memory is set.
+   */
+  void PlanActivationMemory();
+
   /// @brief Helper for displaying debug info in Forward.
   void ForwardDebugInfo(const int layer_id);
   /// @brief Helper for displaying debug info in Backward.
@@ -277,11 +330,14 @@ class Net {
   string name_;
   /// @brief The phase: TRAIN or TEST
   Phase phase_;
+  /// @brief Whether the net is forward-only
+  bool inference_only_;
   /// @brief Individual layers in the net
   vector<shared_ptr<Layer<Dtype> > > layers_;
   vector<string> layer_names_;
   map<string, int> layer_names_index_;
   vector<bool> layer_need_backward_;
+  vector<bool> layer_fused_;
   /// @brief the blobs storing intermediate results between the layer.
   vector<shared_ptr<Blob<Dtype> > > blobs_;
   vector<string> blob_names_;
@@ -330,6 +386,9 @@ class Net {
   size_t memory_used_;
   /// Whether to compute and display debug info for the net.
   bool debug_info_;
+  /// Whether the activations share the activation_memory_ arena
+  bool optimize_activation_memory_;
+  shared_ptr<SyncedMemory> activation_memory_;
   // Callbacks
   vector<Callback*> before_forward_;
   vector<Callback*> after_forward_;
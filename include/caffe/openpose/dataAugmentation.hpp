@@ -40,7 +40,6 @@ namespace caffe {
                               const cv::Size& finalSize, const cv::Mat& image,
                               const unsigned char defaultBorderValue);
     // Other functions
-    void keepRoiInside(cv::Rect& roi, const cv::Size& imageSize);
     void clahe(cv::Mat& bgrImage, const int tileSize, const int clipLimit);
 
 }  // namespace caffe
@@ -0,0 +1,71 @@
+#ifndef CAFFE_OPENPOSE_IMAGE_DECODER_HPP
+#define CAFFE_OPENPOSE_IMAGE_DECODER_HPP
+#ifdef USE_OPENCV
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <opencv2/core/core.hpp> // cv::Mat
+
+namespace caffe {
+    // Reads images from disk (e.g., DOME frames and depth maps) with a pool of decoding threads and keeps the
+    // last decoded frames in a bounded LRU cache. Frames are shared between calls, so they must not be modified.
+    class ImageDecoder
+    {
+    public:
+        // numberThreads = 0 decodes synchronously in the calling thread, cacheSize = 0 disables the cache
+        ImageDecoder(const int numberThreads, const int cacheSize);
+
+        ~ImageDecoder();
+
+        // Starts decoding the image in the background (no-op if cached, in flight or numberThreads = 0)
+        void prefetch(const std::string& path, const int flags, const int reduction = 1);
+
+        // Returns the decoded image (waiting for it if it is being decoded), empty if it could not be read
+        cv::Mat get(const std::string& path, const int flags, const int reduction = 1);
+
+        // Forgets the prefetched images not fetched by get (e.g., those of a batch abandoned after an error), so
+        // they do not pile up. Called once per batch
+        void clearPending();
+
+        unsigned long long getHits() const;
+
+        unsigned long long getMisses() const;
+
+    private:
+        const int mCacheSize;
+        std::vector<std::thread> mThreads;
+        std::deque<std::function<void()>> mTasks;
+        bool mStop;
+        // LRU cache (most recent at the front) + in-flight decodings
+        std::list<std::pair<std::string, cv::Mat>> mCache;
+        std::unordered_map<std::string, std::list<std::pair<std::string, cv::Mat>>::iterator> mCacheIndex;
+        std::unordered_map<std::string, std::shared_future<cv::Mat>> mPending;
+        unsigned long long mHits;
+        unsigned long long mMisses;
+        mutable std::mutex mMutex;
+        std::condition_variable mConditionVariable;
+
+        void threadLoop();
+
+        void addToCache(const std::string& key, const cv::Mat& image);
+    };
+
+    // Decodes the image at 1/reduction of its resolution (DCT-domain scaling for JPEG files)
+    cv::Mat imreadReduced(const std::string& path, const int flags, const int reduction);
+
+    // Largest reduction in {1, 2, 4, 8} such that the image is not upsampled back when scaling it by maxScale
+    int getDecodeReduction(const float maxScale);
+
+}  // namespace caffe
+
+#endif  // USE_OPENCV
+#endif  // CAFFE_OPENPOSE_IMAGE_DECODER_HPP
@@ -0,0 +1,85 @@
+#ifndef CAFFE_OPENPOSE_LABEL_RENDERER_HPP
+#define CAFFE_OPENPOSE_LABEL_RENDERER_HPP
+#ifdef USE_OPENCV
+
+#include <string>
+#include <vector>
+#include <opencv2/core/core.hpp> // cv::Mat, cv::Point, cv::Rect, cv::Size
+#include "metaData.hpp"
+#include "poseModel.hpp"
+
+// Label rendering (heat maps, PAFs and masks) of the OpenPose data layer. It only depends on OpenCV, so it is also
+// built as the standalone `caffe_oplabels` library (see tools/oplabels_benchmark.cpp for its benchmark).
+namespace caffe {
+    // Reference is the original (scalar) implementation, kept as ground truth for the other engines. Scalar,
+    // Avx2 and Avx512 share the separable Gaussian formulation. Auto picks the best one supported by the CPU.
+    // Vectorized engines only apply to float, double falls back to Scalar.
+    enum class LabelRenderingEngine : unsigned char
+    {
+        Reference = 0,
+        Scalar,
+        Avx2,
+        Avx512,
+        Auto
+    };
+
+    // Whether the engine was compiled in and is supported by this CPU
+    bool isLabelRenderingEngineSupported(const LabelRenderingEngine labelRenderingEngine);
+    // Auto resolved to the actual engine
+    LabelRenderingEngine getLabelRenderingEngine(const LabelRenderingEngine labelRenderingEngine);
+    std::string getLabelRenderingEngineName(const LabelRenderingEngine labelRenderingEngine);
+
+    struct LabelRenderingParameters
+    {
+        int gridX;
+        int gridY;
+        int stride;
+        float sigma;
+        int threshold; // PAF half-width (in label pixels)
+    };
+
+    // Heat map: entry = max(entry, Gaussian(center)) (1% tails are not rendered)
+    template<typename Dtype>
+    void putGaussianMaps(Dtype* entry, const cv::Point2f& centerPoint, const int stride, const int gridX,
+                         const int gridY, const float sigma,
+                         const LabelRenderingEngine labelRenderingEngine = LabelRenderingEngine::Auto);
+    // PAF of the limb A->B, averaged with the previous limbs (count keeps the number of limbs per pixel, it
+    // must be zero-initialized for each PAF)
+    template<typename Dtype>
+    void putVectorMaps(Dtype* entryX, Dtype* entryY, Dtype* count, const cv::Point2f& centerA,
+                       const cv::Point2f& centerB, const int stride, const int gridX, const int gridY,
+                       const int threshold,
+                       const LabelRenderingEngine labelRenderingEngine = LabelRenderingEngine::Auto);
+    // background = max(1 - max(heat maps), 0)
+    template<typename Dtype>
+    void putBackgroundMap(Dtype* background, const Dtype* heatMaps, const int numberBodyParts,
+                          const int channelOffset);
+
+    // Renders the labels of a single image: [getNumberPafChannels PAFs][getNumberBodyParts heat maps][background]
+    // (i.e., getNumberBodyBkgAndPAF channels of gridY x gridX). Only people[i].isVisible <= 1 keypoints are drawn.
+    template<typename Dtype>
+    void renderLabels(Dtype* labels, const std::vector<Joints>& people, const PoseModel poseModel,
+                      const LabelRenderingParameters& labelRenderingParameters,
+                      const LabelRenderingEngine labelRenderingEngine = LabelRenderingEngine::Auto);
+    // Same for N images into a contiguous N x getNumberBodyBkgAndPAF x gridY x gridX buffer
+    template<typename Dtype>
+    void renderLabelsBatch(Dtype* labels, const std::vector<std::vector<Joints>>& peoplePerImage,
+                           const PoseModel poseModel, const LabelRenderingParameters& labelRenderingParameters,
+                           const LabelRenderingEngine labelRenderingEngine = LabelRenderingEngine::Auto);
+
+    // Masks
+    void maskHands(cv::Mat& maskMiss, const std::vector<float>& isVisible, const std::vector<cv::Point2f>& points,
+                   const float stride, const float ratio);
+    void maskFeet(cv::Mat& maskMiss, const std::vector<float>& isVisible, const std::vector<cv::Point2f>& points,
+                  const float stride, const float ratio);
+    template<typename Dtype>
+    void fillMaskChannels(Dtype* transformedLabel, const int gridX, const int gridY, const int numberTotalChannels,
+                          const int channelOffset, const cv::Mat& maskMiss);
+
+    // Other functions
+    void keepRoiInside(cv::Rect& roi, const cv::Size& imageSize);
+
+}  // namespace caffe
+
+#endif  // USE_OPENCV
+#endif  // CAFFE_OPENPOSE_LABEL_RENDERER_HPP
@@ -4,6 +4,8 @@
 #ifndef CAFFE_OPENPOSE_OP_DATA_LAYER_HPP
 #define CAFFE_OPENPOSE_OP_DATA_LAYER_HPP
 
+#include <atomic>
+#include <mutex>
 #include <vector>
 
 #include "caffe/blob.hpp"
@@ -29,7 +31,20 @@ class OPDataLayer : public BasePrefetchingDataLayer<Dtype> {
   virtual inline const char* type() const { return "OPData"; }
   virtual inline int ExactNumBottomBlobs() const { return 0; }
   virtual inline int MinTopBlobs() const { return 1; }
-  virtual inline int MaxTopBlobs() const { return 2; }
+  // data, label and (OpenPose, optional) test_letterbox info
+  virtual inline int MaxTopBlobs() const { return 3; }
+  // OpenPose: added
+  // Epoch and progress within the epoch ([0, 1]) of the main DB, as counted
+  // by the prefetching sampler (not by the LMDB writing order)
+  int getEpoch() const;
+  float getEpochProgress() const;
+  virtual void Forward_cpu(const vector<Blob<Dtype>*>& bottom,
+      const vector<Blob<Dtype>*>& top);
+  virtual void Forward_gpu(const vector<Blob<Dtype>*>& bottom,
+      const vector<Blob<Dtype>*>& top);
+  // Letterbox info blobs are indexed like prefetch_
+  virtual inline bool AllowPrefetchResize() const { return mPrefetchLetterboxes.empty(); }
+  // OpenPose: added end
 
  protected:
   void Next();
@@ -61,11 +76,27 @@ class OPDataLayer : public BasePrefetchingDataLayer<Dtype> {
   OPTransformationParameter op_transform_param_;
   // Data augmentation class
   shared_ptr<OPDataTransformer<Dtype> > mOPDataTransformer;
+  // One per prefetch worker (index 0 being mOPDataTransformer and
+  // mOPDataTransformerSecondary), their decoding state is not shared
+  vector<shared_ptr<OPDataTransformer<Dtype> > > mOPDataTransformers;
+  vector<shared_ptr<OPDataTransformer<Dtype> > > mOPDataTransformersSecondary;
+  // TEST phase letterboxing (fixed batch shape), info blob per prefetch batch
+  bool mLetterbox;
+  vector<shared_ptr<Blob<Dtype> > > mPrefetchLetterboxes;
+  Blob<Dtype>* getLetterbox(const Batch<Dtype>* batch) const;
+  // Sampler epoch counters (main and secondary lmdb)
+  std::atomic<int> mEpoch;
+  std::atomic<uint64_t> mEpochPosition;
+  uint64_t mEpochSize;
+  std::atomic<int> mEpochSecond;
+  std::atomic<uint64_t> mEpochPositionSecond;
+  uint64_t mEpochSizeSecond;
   // Timer
   unsigned long long mOnes;
   unsigned long long mTwos;
   int mCounter;
   double mDuration;
+  std::mutex mTimerMutex;
   // OpenPose: added end
 };
 
@@ -7,10 +7,14 @@
 
 #include <vector>
 // OpenPose: added
+#include <deque>
+#include <utility>
 #ifdef USE_OPENCV
     #include <opencv2/core/core.hpp> // cv::Mat, cv::Point, cv::Size
 #endif  // USE_OPENCV
 #include "dataAugmentation.hpp"
+#include "imageDecoder.hpp"
+#include "labelRenderer.hpp"
 #include "metaData.hpp"
 #include "poseModel.hpp"
 // OpenPose: added end
@@ -66,8 +70,14 @@ protected:
     // OpenPose: added
     // Image and label
 public:
+    // epoch is given by the data layer sampler
+    // transformedLetterbox (5 elements, optional) receives the test_letterbox scale, offset and original size
     void Transform(Blob<Dtype>* transformedData, Blob<Dtype>* transformedLabel, const Datum& datum,
-                   const Datum* datumNegative = nullptr);
+                   const Datum* datumNegative, const int epoch, Dtype* transformedLetterbox = nullptr);
+    // Starts reading the images of a datum that are not stored in the LMDB (DOME) before Transform needs them
+    // Called before the Prefetch calls of each batch: drops what the previous one left (e.g., after Transform threw)
+    void StartBatch();
+    void Prefetch(const Datum& datum);
     int getNumberChannels() const;
 protected:
     // OpenPose: added end
@@ -84,25 +94,20 @@ protected:
 protected:
     PoseModel mPoseModel;
     PoseCategory mPoseCategory;
-    int mCurrentEpoch;
     std::string mModelString;
+    shared_ptr<ImageDecoder> mImageDecoder;
+    // Scales sampled by Prefetch (before decoding the image) for the datums that Transform will receive, matched
+    // by address within the current batch (cleared by StartBatch)
+    std::deque<std::pair<const Datum*, float>> mPrefetchedScales;
 
     // Label generation
-    void generateDataAndLabel(Dtype* transformedData, Dtype* transformedLabel, const Datum& datum,
-                              const Datum* datumNegative);
+    void generateDataAndLabel(Dtype* transformedData, Dtype* transformedLabel, Dtype* transformedLetterbox,
+                              const Datum& datum, const Datum* datumNegative, const int epoch);
+    float getScale(const MetaData& metaData, const Datum& datum);
+    int getImageReduction(const float scale) const;
     void generateDepthLabelMap(Dtype* transformedLabel, const cv::Mat& depth) const;
     void generateLabelMap(Dtype* transformedLabel, const cv::Size& imageSize, const cv::Mat& maskMiss,
                           const MetaData& metaData) const;
-    void putGaussianMaps(Dtype* entry, const cv::Point2f& center, const int stride, const int gridX, const int gridY,
-                         const float sigma) const;
-    void putVectorMaps(Dtype* entryX, Dtype* entryY, Dtype* maskX, Dtype* maskY, cv::Mat& count,
-                       const cv::Point2f& centerA, const cv::Point2f& centerB, const int stride,
-                       const int gridX, const int gridY, const float sigma, const int threshold,
-                       const int diagonal, const float diagonalProportion) const;
-    // // For Distance
-    // void putVectorMaps(Dtype* entryX, Dtype* entryY, Dtype* entryD, Dtype* entryDMask, cv::Mat& count,
-    //                    const cv::Point2f& centerA, const cv::Point2f& centerB, const int stride, const int gridX,
-    //                    const int gridY, const float sigma, const int thre) const;
     // OpenPose: added end
 };
 
@@ -1,13 +1,12 @@
 #ifndef CAFFE_SYNCEDMEM_HPP_
 #define CAFFE_SYNCEDMEM_HPP_
 
-#include <cstdlib>
+#include <stdint.h>
 
-#ifdef USE_MKL
-  #include "mkl.h"
-#endif
+#include <cstdlib>
 
 #include "caffe/common.hpp"
+#include "caffe/util/host_allocator.hpp"
 
 namespace caffe {
 
@@ -16,7 +15,13 @@ namespace caffe {
 // The improvement in performance seems negligible in the single GPU case,
 // but might be more significant for parallel training. Most importantly,
 // it improved stability for large models on many GPUs.
-inline void CaffeMallocHost(void** ptr, size_t size, bool* use_cuda) {
+// Otherwise it comes from the HostAllocator (see util/host_allocator.hpp),
+// which sets *zeroed if the memory is already filled with zeros.
+inline void CaffeMallocHost(void** ptr, size_t size, bool* use_cuda,
+                            bool* zeroed = NULL) {
+  if (zeroed) {
+    *zeroed = false;
+  }
 #ifndef CPU_ONLY
   if (Caffe::mode() == Caffe::GPU) {
     CUDA_CHECK(cudaMallocHost(ptr, size));
@@ -24,13 +29,13 @@ inline void CaffeMallocHost(void** ptr, size_t size, bool* use_cuda) {
     return;
   }
 #endif
-#ifdef USE_MKL
-  *ptr = mkl_malloc(size ? size:1, 64);
-#else
-  *ptr = malloc(size);
-#endif
+  bool allocator_zeroed = false;
+  *ptr = GetHostAllocator()->Allocate(size, &allocator_zeroed);
   *use_cuda = false;
   CHECK(*ptr) << "host allocation of size " << size << " failed";
+  if (zeroed) {
+    *zeroed = allocator_zeroed;
+  }
 }
 
 inline void CaffeFreeHost(void* ptr, bool use_cuda) {
@@ -40,11 +45,7 @@ inline void CaffeFreeHost(void* ptr, bool use_cuda) {
     return;
   }
 #endif
-#ifdef USE_MKL
-  mkl_free(ptr);
-#else
-  free(ptr);
-#endif
+  GetHostAllocator()->Free(ptr);
 }
 
 
@@ -68,6 +69,13 @@ class SyncedMemory {
   enum SyncedHead { UNINITIALIZED, HEAD_AT_CPU, HEAD_AT_GPU, SYNCED };
   SyncedHead head() { return head_; }
   size_t size() { return size_; }
+  /**
+   * @brief Changes whenever the data may be written: on construction and on
+   *        every set_*_data or mutable_*_data call. It is never reused, so
+   *        the caches derived from the data (e.g. transformed weights) are
+   *        current while the version they were computed from is.
+   */
+  uint64_t version() const { return version_; }
 
 #ifndef CPU_ONLY
   void async_gpu_push(const cudaStream_t& stream);
@@ -86,6 +94,7 @@ class SyncedMemory {
   bool cpu_malloc_use_cuda_;
   bool own_gpu_data_;
   int device_;
+  uint64_t version_;
 
   DISABLE_COPY_AND_ASSIGN(SyncedMemory);
 };  // class SyncedMemory
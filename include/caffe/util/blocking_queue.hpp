@@ -1,23 +1,46 @@
 #ifndef CAFFE_UTIL_BLOCKING_QUEUE_HPP_
 #define CAFFE_UTIL_BLOCKING_QUEUE_HPP_
 
-#include <queue>
+#include <stdint.h>
+
 #include <string>
 
 namespace caffe {
 
+/**
+ * @brief Bounded multi-producer multi-consumer queue.
+ *
+ * Elements live in a lock-free ring (capacity rounded up to a power of two):
+ * pushes and pops that do not need to wait take no lock. Waiting threads
+ * (pop on an empty queue, push on a full one) spin briefly, then sleep on a
+ * condition variable, so they can be interrupted (boost::thread_interrupted).
+ * The time spent waiting is accumulated in stats().
+ */
 template<typename T>
 class BlockingQueue {
  public:
-  explicit BlockingQueue();
+  struct Stats {
+    uint64_t pushes;
+    uint64_t pops;
+    // Calls that found the queue full (push) or empty (pop), and the time
+    // they waited
+    uint64_t push_waits;
+    uint64_t pop_waits;
+    double push_wait_seconds;
+    double pop_wait_seconds;
+  };
+
+  explicit BlockingQueue(size_t capacity = 1024);
 
+  // Waits while the queue is full
   void push(const T& t);
 
+  bool try_push(const T& t);
+
   bool try_pop(T* t);
 
-  // This logs a message if the threads needs to be blocked
-  // useful for detecting e.g. when data feeding is too slow
-  T pop(const string& log_on_wait = "");
+  // Waits while the queue is empty
+  T pop();
 
   bool try_peek(T* t);
 
@@ -25,6 +48,9 @@ class BlockingQueue {
   T peek();
 
   size_t size() const;
+  size_t capacity() const;
+
+  Stats stats() const;
 
  protected:
   /**
@@ -34,7 +60,6 @@ class BlockingQueue {
    */
   class sync;
 
-  std::queue<T> queue_;
   shared_ptr<sync> sync_;
 
 DISABLE_COPY_AND_ASSIGN(BlockingQueue);
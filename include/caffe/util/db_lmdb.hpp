@@ -83,6 +83,8 @@ class LMDB : public DB {
   }
   virtual LMDBCursor* NewCursor();
   virtual LMDBTransaction* NewTransaction();
+  // Number of entries, read from the database statistics (no cursor walk)
+  size_t NumEntries();
 
  private:
   MDB_env* mdb_env_;
@@ -0,0 +1,137 @@
+#ifndef CAFFE_UTIL_FAST_MATH_H_
+#define CAFFE_UTIL_FAST_MATH_H_
+
+#include <stdint.h>
+
+#include <cmath>
+#include <cstring>
+
+namespace caffe {
+
+// Polynomial approximations of the float transcendental functions (Cephes
+// coefficients), written without branches so that the compiler vectorizes the
+// loops calling them: the out of range inputs are selected on the integer bit
+// patterns, which cannot raise floating point exceptions. Maximum error
+// against the correctly rounded result over all the floats, with or without
+// FMA, in units in the last place:
+//   fast_exp      1 ULP; 0 below -87.34 (instead of denormals) and inf above
+//                 88.376 (instead of up to FLT_MAX)
+//   fast_log      1 ULP
+//   fast_tanh     1 ULP
+//   fast_sigmoid  2 ULP; 0 below -88.376
+// fast_exp(b * fast_log(a)), as caffe_powx, is within 1 + 1.5 |b ln(a)| ULP
+// of a^b. The double overloads call std::.
+
+inline uint32_t float_as_bits(const float x) {
+  uint32_t bits;
+  std::memcpy(&bits, &x, sizeof(bits));
+  return bits;
+}
+
+inline float bits_as_float(const uint32_t bits) {
+  float x;
+  std::memcpy(&x, &bits, sizeof(x));
+  return x;
+}
+
+// All ones if condition, else 0
+inline uint32_t bit_mask(const uint32_t condition) {
+  return 0u - (condition != 0);
+}
+
+// The bits of a where mask is set, else of b
+inline uint32_t select_bits(const uint32_t mask, const uint32_t a,
+    const uint32_t b) {
+  return (a & mask) | (b & ~mask);
+}
+
+inline float fast_exp(const float x) {
+  // x = n ln(2) + r, |r| <= ln(2) / 2, n rounded by adding 1.5 * 2^23
+  const float rounded = x * 1.44269504088896341f + 12582912.0f;
+  const float n = rounded - 12582912.0f;
+  const float r = x - n * 0.693359375f + n * 2.12194440e-4f;
+  float p = 1.9875691500e-4f;
+  p = p * r + 1.3981999507e-3f;
+  p = p * r + 8.3334519073e-3f;
+  p = p * r + 4.1665795894e-2f;
+  p = p * r + 1.6666665459e-1f;
+  p = p * r + 5.0000001201e-1f;
+  p = p * r * r + r + 1.0f;
+  // 2^n, from the low bits of rounded
+  const float scale =
+      bits_as_float((float_as_bits(rounded) - 0x4b400000u + 127u) << 23);
+  // Outside of [-87.3365448, 88.3762626]: 0, inf or NaN
+  const uint32_t bits = float_as_bits(x);
+  const uint32_t abs_bits = bits & 0x7fffffffu;
+  const uint32_t negative = bit_mask(bits >> 31);
+  const uint32_t nan = bit_mask(abs_bits > 0x7f800000u);
+  const uint32_t special =
+      select_bits(nan, bits, select_bits(negative, 0u, 0x7f800000u));
+  const uint32_t limit = select_bits(negative, 0x42aeac50u, 0x42b0c0a5u);
+  return bits_as_float(select_bits(bit_mask(abs_bits > limit), special,
+      float_as_bits(p * scale)));
+}
+
+inline float fast_log(const float x) {
+  // Denormals are scaled by 2^23
+  uint32_t bits = float_as_bits(x);
+  const bool denormal = bits < 0x00800000u;
+  bits = select_bits(bit_mask(denormal), float_as_bits(x * 8388608.0f), bits);
+  // x = 2^e (1 + m), sqrt(1/2) <= 1 + m < sqrt(2)
+  bits += 0x3f800000u - 0x3f3504f3u;
+  const float e = static_cast<float>(static_cast<int>(bits >> 23) - 127
+      - (denormal ? 23 : 0));
+  const float m = bits_as_float((bits & 0x007fffffu) + 0x3f3504f3u) - 1.0f;
+  const float z = m * m;
+  float p = 7.0376836292e-2f;
+  p = p * m - 1.1514610310e-1f;
+  p = p * m + 1.1676998740e-1f;
+  p = p * m - 1.2420140846e-1f;
+  p = p * m + 1.4249322787e-1f;
+  p = p * m - 1.6668057665e-1f;
+  p = p * m + 2.0000714765e-1f;
+  p = p * m - 2.4999993993e-1f;
+  p = p * m + 3.3333331174e-1f;
+  const float y = p * m * z - 2.12194440e-4f * e - 0.5f * z + m
+      + 0.693359375f * e;
+  // 0, negative, inf and NaN: -inf, NaN, inf and NaN
+  const uint32_t x_bits = float_as_bits(x);
+  const uint32_t special = select_bits(bit_mask((x_bits & 0x7fffffffu) == 0),
+      0xff800000u, select_bits(bit_mask(x_bits >> 31), 0x7fc00000u, x_bits));
+  return bits_as_float(select_bits(bit_mask(x_bits - 1u >= 0x7f7fffffu),
+      special, float_as_bits(y)));
+}
+
+inline float fast_tanh(const float x) {
+  const uint32_t bits = float_as_bits(x);
+  const uint32_t abs_bits = bits & 0x7fffffffu;
+  const float abs_x = bits_as_float(abs_bits);
+  // |x| < 0.625: x + x^3 P(x^2)
+  const float z = x * x;
+  float p = -5.70498872745e-3f;
+  p = p * z + 2.06390887954e-2f;
+  p = p * z - 5.37397155531e-2f;
+  p = p * z + 1.33314422036e-1f;
+  p = p * z - 3.33332819422e-1f;
+  const float small = p * z * x + x;
+  // Otherwise 1 - 2 / (e^2|x| + 1), with the sign of x
+  const float large = 1.0f - 2.0f / (fast_exp(abs_x + abs_x) + 1.0f);
+  const uint32_t large_bits = float_as_bits(large) | (bits & 0x80000000u);
+  return bits_as_float(select_bits(bit_mask(abs_bits < 0x3f200000u),
+      float_as_bits(small), large_bits));
+}
+
+inline float fast_sigmoid(const float x) {
+  return 1.0f / (1.0f + fast_exp(-x));
+}
+
+inline double fast_exp(const double x) { return std::exp(x); }
+inline double fast_log(const double x) { return std::log(x); }
+inline double fast_tanh(const double x) { return std::tanh(x); }
+inline double fast_sigmoid(const double x) {
+  return 1. / (1. + std::exp(-x));
+}
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_FAST_MATH_H_
@@ -0,0 +1,75 @@
+#ifndef CAFFE_UTIL_HALF_H_
+#define CAFFE_UTIL_HALF_H_
+
+#include <stdint.h>
+
+#include <string>
+
+#include "caffe/proto/caffe.pb.h"
+#include "caffe/util/fast_math.hpp"
+
+namespace caffe {
+
+// Conversions between float and the 16 bit formats of HalfFormat, rounding to
+// the nearest even. NaN stays NaN; FLOAT16 overflows to inf from 65520 and
+// keeps the denormals. Branch free (see fast_math.hpp) so that the loops
+// calling them vectorize.
+
+inline uint16_t float_to_bfloat16(const float x) {
+  const uint32_t bits = float_as_bits(x);
+  const uint32_t rounded = bits + 0x7fffu + ((bits >> 16) & 1u);
+  // NaN: quiet, which the rounding could have carried to inf
+  const uint32_t nan = bit_mask((bits & 0x7fffffffu) > 0x7f800000u);
+  return static_cast<uint16_t>(
+      select_bits(nan, bits | 0x00400000u, rounded) >> 16);
+}
+
+inline float bfloat16_to_float(const uint16_t h) {
+  return bits_as_float(static_cast<uint32_t>(h) << 16);
+}
+
+inline uint16_t float_to_float16(const float x) {
+  const uint32_t bits = float_as_bits(x);
+  const uint32_t abs_bits = bits & 0x7fffffffu;
+  // The exponent rebiased from 127 to 15, with the rounding carrying into it
+  const uint32_t normal =
+      (abs_bits + 0xc8000fffu + ((abs_bits >> 13) & 1u)) >> 13;
+  // Below 2^-14: adding 0.5 aligns the mantissa, rounded by the addition
+  const uint32_t denormal =
+      float_as_bits(bits_as_float(abs_bits) + 0.5f) - 0x3f000000u;
+  // From 2^16: inf or NaN
+  const uint32_t special =
+      select_bits(bit_mask(abs_bits > 0x7f800000u), 0x7e00u, 0x7c00u);
+  uint32_t half = select_bits(bit_mask(abs_bits < 0x38800000u), denormal,
+      normal);
+  half = select_bits(bit_mask(abs_bits >= 0x47800000u), special, half);
+  return static_cast<uint16_t>(half | ((bits >> 16) & 0x8000u));
+}
+
+inline float float16_to_float(const uint16_t h) {
+  const uint32_t shifted = static_cast<uint32_t>(h & 0x7fffu) << 13;
+  const uint32_t exponent = shifted & 0x0f800000u;
+  // The exponent rebiased from 15 to 127, and to 255 for inf and NaN
+  const uint32_t normal = shifted + 0x38000000u;
+  const uint32_t special = normal + 0x38000000u;
+  // Denormals: normalized by the float subtraction of 2^-14
+  const uint32_t denormal = float_as_bits(
+      bits_as_float(shifted + 0x38800000u) - bits_as_float(0x38800000u));
+  uint32_t bits = select_bits(bit_mask(exponent == 0x0f800000u), special,
+      normal);
+  bits = select_bits(bit_mask(exponent == 0), denormal, bits);
+  return bits_as_float(bits | (static_cast<uint32_t>(h & 0x8000u) << 16));
+}
+
+// Writes the n values of x as 16 bit floats in format, 2 bytes each in little
+// endian order, as BlobProto.half_data
+void EncodeHalf(const int n, const float* x, const HalfFormat format,
+    std::string* bytes);
+
+// Reads the n values written by EncodeHalf into y
+void DecodeHalf(const int n, const std::string& bytes,
+    const HalfFormat format, float* y);
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_HALF_H_
@@ -0,0 +1,137 @@
+#ifndef CAFFE_UTIL_HOST_ALLOCATOR_HPP_
+#define CAFFE_UTIL_HOST_ALLOCATOR_HPP_
+
+#include <cstddef>
+#include <map>
+#include <vector>
+
+#include "caffe/common.hpp"
+
+namespace caffe {
+
+/**
+ * @brief Allocates the host memory of SyncedMemory (CUDA pinned memory
+ *        excepted). Implementations must be thread-safe.
+ */
+class HostAllocator {
+ public:
+  HostAllocator() {}
+  virtual ~HostAllocator() {}
+
+  /**
+   * @brief Returns size bytes aligned to (at least) kAlignment.
+   *
+   * *zeroed is set to true if the memory is known to be filled with zeros
+   * (e.g. fresh anonymous mappings), so the caller can skip clearing it.
+   */
+  virtual void* Allocate(size_t size, bool* zeroed) = 0;
+  virtual void Free(void* ptr) = 0;
+
+  static const size_t kAlignment = 64;
+
+  DISABLE_COPY_AND_ASSIGN(HostAllocator);
+};
+
+/**
+ * @brief The default HostAllocator.
+ *
+ * Buffers below huge_page_threshold come from the heap, 64-byte aligned.
+ * Larger ones are anonymous mappings aligned to 2 MB, optionally backed by
+ * transparent huge pages (off by default), and placed either on the NUMA node
+ * of the first thread writing them (first touch, the default) or on
+ * numa_node. Their pages are zero, so they are only faulted in by the thread
+ * that fills them.
+ * Mappings, huge pages and NUMA binding are only available on Linux, other
+ * platforms always use the heap.
+ *
+ * Each buffer is preceded by a header (in kAlignment bytes, or a page for
+ * mappings) telling how to release it, so Free takes no lock. A mapping still
+ * costs an mmap and a munmap: for buffers allocated and released often (e.g.
+ * once per batch), raise huge_page_threshold above their size or wrap the
+ * allocator in a PooledHostAllocator.
+ */
+class AlignedHostAllocator : public HostAllocator {
+ public:
+  enum NumaPolicy { FIRST_TOUCH, PREFERRED, BIND };
+
+  explicit AlignedHostAllocator(size_t huge_page_threshold = kHugePageSize,
+      bool transparent_huge_pages = false,
+      NumaPolicy numa_policy = FIRST_TOUCH, int numa_node = 0);
+
+  virtual void* Allocate(size_t size, bool* zeroed);
+  virtual void Free(void* ptr);
+
+  static const size_t kHugePageSize = 2 << 20;
+
+ protected:
+  void* MapAligned(size_t size);
+
+  size_t huge_page_threshold_;
+  bool transparent_huge_pages_;
+  NumaPolicy numa_policy_;
+  int numa_node_;
+
+  DISABLE_COPY_AND_ASSIGN(AlignedHostAllocator);
+};
+
+/**
+ * @brief Keeps the buffers released by Free (e.g. when Blob::Reshape grows a
+ *        blob) and hands them out again to later allocations of the same
+ *        size class, so reshape-heavy workloads reach a steady state without
+ *        allocations.
+ *
+ * Sizes are rounded up to size classes (4 per power of two, i.e. at most 25%
+ * of padding). At most max_cached_bytes are kept, the rest goes back to the
+ * wrapped allocator. Recycled buffers are not zero.
+ */
+class PooledHostAllocator : public HostAllocator {
+ public:
+  struct Stats {
+    size_t hits;
+    size_t misses;
+    size_t in_use_bytes;
+    size_t cached_bytes;
+    /// Peak of in_use_bytes + cached_bytes, i.e. of the memory held
+    size_t peak_bytes;
+  };
+
+  explicit PooledHostAllocator(shared_ptr<HostAllocator> allocator,
+      size_t max_cached_bytes = size_t(1) << 30);
+  virtual ~PooledHostAllocator();
+
+  virtual void* Allocate(size_t size, bool* zeroed);
+  virtual void Free(void* ptr);
+
+  Stats stats() const;
+  /// @brief Returns the cached buffers to the wrapped allocator.
+  void Trim();
+
+  static size_t SizeClass(size_t size);
+
+ protected:
+  class sync;
+
+  shared_ptr<HostAllocator> allocator_;
+  size_t max_cached_bytes_;
+  shared_ptr<sync> sync_;
+  map<void*, size_t> in_use_;
+  map<size_t, vector<void*> > cached_;
+  Stats stats_;
+
+  DISABLE_COPY_AND_ASSIGN(PooledHostAllocator);
+};
+
+/**
+ * @brief Returns the allocator used by CaffeMallocHost.
+ */
+shared_ptr<HostAllocator> GetHostAllocator();
+/**
+ * @brief Replaces the allocator used by CaffeMallocHost. Buffers are released
+ *        by the current allocator, so call it before any host allocation
+ *        (e.g. at the beginning of main).
+ */
+void SetHostAllocator(shared_ptr<HostAllocator> allocator);
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_HOST_ALLOCATOR_HPP_
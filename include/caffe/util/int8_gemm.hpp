@@ -0,0 +1,78 @@
+#ifndef CAFFE_UTIL_INT8_GEMM_H_
+#define CAFFE_UTIL_INT8_GEMM_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "caffe/common.hpp"
+#include "caffe/proto/caffe.pb.h"
+#include "caffe/util/math_functions.hpp"
+
+namespace caffe {
+
+/**
+ * @brief The quantized weights and buffers of the int8 inference path of
+ *        ConvolutionLayer and InnerProductLayer (quantization_param).
+ *
+ * Each row (output channel) of the weights is quantized to [-127, 127] with
+ * the scale max |w| / 127 of the row. The inputs are quantized to [0, 255]
+ * over the calibrated range [input_min, input_max], 0 being the zero point
+ * z. caffe_cpu_gemm_s8u8s32 computes the products in 32 bit integers, which
+ * are converted back to Dtype with w_scale * input_scale * (p - z row_sum).
+ */
+template <typename Dtype>
+class Int8Gemm {
+ public:
+  Int8Gemm()
+      : rows_(0), cols_(0), transposed_(false), version_(0),
+        input_scale_(1), zero_point_(0) {}
+
+  /// @brief Sets the range of the inputs quantized by QuantizeInput.
+  void SetInputRange(const QuantizationParameter& param);
+  /**
+   * @brief Quantizes the rows x cols weights (cols x rows if transposed),
+   *        unless their version (SyncedMemory::version) did not change since
+   *        the previous call.
+   */
+  void QuantizeWeights(const int rows, const int cols, const Dtype* weights,
+      const uint64_t version, const bool transposed = false);
+  /// @brief Quantizes count inputs, returning them until the next call.
+  const uint8_t* QuantizeInput(const int count, const Dtype* input);
+  /**
+   * @brief Multiplies the rows [first_row, first_row + rows) of the weights
+   *        by the quantized input (cols x n, or n x cols with TransB),
+   *        writing entry (i, j) of the product at
+   *        output[i * row_stride + j * col_stride].
+   */
+  void Forward(const CBLAS_TRANSPOSE TransB, const int first_row,
+      const int rows, const int n, const uint8_t* input, Dtype* output,
+      const int row_stride, const int col_stride);
+
+  int rows() const { return rows_; }
+  int cols() const { return cols_; }
+  const int8_t* weights() const { return weights_.data(); }
+  /// @brief The scales of the rows of the weights.
+  const Dtype* weight_scales() const { return weight_scales_.data(); }
+
+ private:
+  int rows_;
+  int cols_;
+  bool transposed_;
+  /// @brief The version of the weights the quantized weights were computed
+  ///        from.
+  uint64_t version_;
+  Dtype input_scale_;
+  int zero_point_;
+  vector<int8_t> weights_;
+  vector<Dtype> weight_scales_;
+  vector<int32_t> row_sums_;
+  vector<uint8_t> input_;
+  vector<int32_t> product_;
+
+  DISABLE_COPY_AND_ASSIGN(Int8Gemm);
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_INT8_GEMM_H_
@@ -25,6 +25,14 @@ void caffe_cpu_gemv(const CBLAS_TRANSPOSE TransA, const int M, const int N,
     const Dtype alpha, const Dtype* A, const Dtype* x, const Dtype beta,
     Dtype* y);
 
+// C = A B in 32 bit integers, for the int8 inference path (util/int8_gemm.hpp):
+// A is M x K signed, B K x N unsigned (N x K with TransB), row major. The
+// entries of A must be in [-127, 127] and K at most kMaxInt8GemmK, so that
+// the sums cannot overflow.
+const int kMaxInt8GemmK = 65536;
+void caffe_cpu_gemm_s8u8s32(const CBLAS_TRANSPOSE TransB, const int M,
+    const int N, const int K, const int8_t* A, const uint8_t* B, int32_t* C);
+
 template <typename Dtype>
 void caffe_axpy(const int N, const Dtype alpha, const Dtype* X,
     Dtype* Y);
@@ -94,6 +102,13 @@ void caffe_exp(const int n, const Dtype* a, Dtype* y);
 template <typename Dtype>
 void caffe_log(const int n, const Dtype* a, Dtype* y);
 
+// y = 1 / (1 + exp(-a))
+template <typename Dtype>
+void caffe_sigmoid(const int n, const Dtype* a, Dtype* y);
+
+template <typename Dtype>
+void caffe_tanh(const int n, const Dtype* a, Dtype* y);
+
 template <typename Dtype>
 void caffe_abs(const int n, const Dtype* a, Dtype* y);
 
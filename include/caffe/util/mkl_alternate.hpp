@@ -25,6 +25,7 @@ extern "C" {
   template<typename Dtype> \
   void v##name(const int n, const Dtype* a, Dtype* y) { \
     CHECK_GT(n, 0); CHECK(a); CHECK(y); \
+    CAFFE_PARALLEL_FOR(n) \
     for (int i = 0; i < n; ++i) { operation; } \
   } \
   inline void vs##name( \
@@ -48,6 +49,7 @@ DEFINE_VSL_UNARY_FUNC(Abs, y[i] = fabs(a[i]))
   template<typename Dtype> \
   void v##name(const int n, const Dtype* a, const Dtype b, Dtype* y) { \
     CHECK_GT(n, 0); CHECK(a); CHECK(y); \
+    CAFFE_PARALLEL_FOR(n) \
     for (int i = 0; i < n; ++i) { operation; } \
   } \
   inline void vs##name( \
@@ -67,6 +69,7 @@ DEFINE_VSL_UNARY_FUNC_WITH_PARAM(Powx, y[i] = pow(a[i], b))
   template<typename Dtype> \
   void v##name(const int n, const Dtype* a, const Dtype* b, Dtype* y) { \
     CHECK_GT(n, 0); CHECK(a); CHECK(b); CHECK(y); \
+    CAFFE_PARALLEL_FOR(n) \
     for (int i = 0; i < n; ++i) { operation; } \
   } \
   inline void vs##name( \
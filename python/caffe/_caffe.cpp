@@ -108,7 +108,7 @@ void CheckContiguousArray(PyArrayObject* arr, string name,
 // Net constructor
 shared_ptr<Net<Dtype> > Net_Init(string network_file, int phase,
     const int level, const bp::object& stages,
-    const bp::object& weights) {
+    const bp::object& weights, const bool inference_only) {
   CheckFile(network_file);
 
   // Convert stages from list to vector
@@ -121,7 +121,7 @@ shared_ptr<Net<Dtype> > Net_Init(string network_file, int phase,
 
   // Initialize net
   shared_ptr<Net<Dtype> > net(new Net<Dtype>(network_file,
-        static_cast<Phase>(phase), level, &stages_vector));
+        static_cast<Phase>(phase), level, &stages_vector, inference_only));
 
   // Load weights
   if (!weights.is_none()) {
@@ -408,7 +408,8 @@ BOOST_PYTHON_MODULE(_caffe) {
     .def("__init__", bp::make_constructor(&Net_Init,
           bp::default_call_policies(), (bp::arg("network_file"), "phase",
             bp::arg("level")=0, bp::arg("stages")=bp::object(),
-            bp::arg("weights")=bp::object())))
+            bp::arg("weights")=bp::object(),
+            bp::arg("inference_only")=false)))
     // Legacy constructor
     .def("__init__", bp::make_constructor(&Net_Init_Load))
     .def("_forward", &Net<Dtype>::ForwardFromTo)
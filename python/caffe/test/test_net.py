@@ -119,6 +119,13 @@ class TestNet(unittest.TestCase):
         # Check that the diffs are now 0
         self.assertTrue((diff == 0).all())
 
+    def test_inference_only(self):
+        net_file = simple_net_file(self.num_output)
+        net = caffe.Net(net_file, caffe.TEST, inference_only=True)
+        os.remove(net_file)
+        net.forward()
+        self.assertTrue(np.isfinite(net.blobs['loss'].data).all())
+
     def test_inputs_outputs(self):
         self.assertEqual(self.net.inputs, [])
         self.assertEqual(self.net.outputs, ['loss'])
@@ -1,9 +1,11 @@
+#include <algorithm>
 #include <climits>
 #include <vector>
 
 #include "caffe/blob.hpp"
 #include "caffe/common.hpp"
 #include "caffe/syncedmem.hpp"
+#include "caffe/util/half.hpp"
 #include "caffe/util/math_functions.hpp"
 
 namespace caffe {
@@ -40,7 +42,7 @@ void Blob<Dtype>::Reshape(const vector<int>& shape) {
   if (count_ > capacity_) {
     capacity_ = count_;
     data_.reset(new SyncedMemory(capacity_ * sizeof(Dtype)));
-    diff_.reset(new SyncedMemory(capacity_ * sizeof(Dtype)));
+    ResetDiff(capacity_ * sizeof(Dtype));
   }
 }
 
@@ -63,14 +65,14 @@ template <typename Dtype>
 Blob<Dtype>::Blob(const int num, const int channels, const int height,
     const int width)
   // capacity_ must be initialized before calling Reshape
-  : capacity_(0) {
+  : capacity_(0), lazy_diff_(false) {
   Reshape(num, channels, height, width);
 }
 
 template <typename Dtype>
 Blob<Dtype>::Blob(const vector<int>& shape)
   // capacity_ must be initialized before calling Reshape
-  : capacity_(0) {
+  : capacity_(0), lazy_diff_(false) {
   Reshape(shape);
 }
 
@@ -93,7 +95,7 @@ void Blob<Dtype>::set_cpu_data(Dtype* data) {
   size_t size = count_ * sizeof(Dtype);
   if (data_->size() != size) {
     data_.reset(new SyncedMemory(size));
-    diff_.reset(new SyncedMemory(size));
+    ResetDiff(size);
   }
   data_->set_cpu_data(data);
 }
@@ -111,21 +113,36 @@ void Blob<Dtype>::set_gpu_data(Dtype* data) {
   size_t size = count_ * sizeof(Dtype);
   if (data_->size() != size) {
     data_.reset(new SyncedMemory(size));
-    diff_.reset(new SyncedMemory(size));
+    ResetDiff(size);
   }
   data_->set_gpu_data(data);
 }
 
+template <typename Dtype>
+void Blob<Dtype>::set_lazy_diff(const bool lazy_diff) {
+  lazy_diff_ = lazy_diff;
+  if (data_) {
+    ResetDiff(data_->size());
+  }
+}
+
+template <typename Dtype>
+void Blob<Dtype>::ResetDiff(const size_t size) {
+  if (lazy_diff_) {
+    diff_.reset();
+  } else {
+    diff_.reset(new SyncedMemory(size));
+  }
+}
+
 template <typename Dtype>
 const Dtype* Blob<Dtype>::cpu_diff() const {
-  CHECK(diff_);
-  return (const Dtype*)diff_->cpu_data();
+  return (const Dtype*)diff()->cpu_data();
 }
 
 template <typename Dtype>
 const Dtype* Blob<Dtype>::gpu_diff() const {
-  CHECK(diff_);
-  return (const Dtype*)diff_->gpu_data();
+  return (const Dtype*)diff()->gpu_data();
 }
 
 template <typename Dtype>
@@ -142,13 +159,19 @@ Dtype* Blob<Dtype>::mutable_gpu_data() {
 
 template <typename Dtype>
 Dtype* Blob<Dtype>::mutable_cpu_diff() {
-  CHECK(diff_);
+  if (!diff_) {
+    CHECK(data_);
+    diff_.reset(new SyncedMemory(data_->size()));
+  }
   return static_cast<Dtype*>(diff_->mutable_cpu_data());
 }
 
 template <typename Dtype>
 Dtype* Blob<Dtype>::mutable_gpu_diff() {
-  CHECK(diff_);
+  if (!diff_) {
+    CHECK(data_);
+    diff_.reset(new SyncedMemory(data_->size()));
+  }
   return static_cast<Dtype*>(diff_->mutable_gpu_data());
 }
 
@@ -156,12 +179,18 @@ template <typename Dtype>
 void Blob<Dtype>::ShareData(const Blob& other) {
   CHECK_EQ(count_, other.count());
   data_ = other.data();
+  // Later reshapes stay within the shared memory
+  capacity_ = std::min(capacity_,
+      static_cast<int>(data_->size() / sizeof(Dtype)));
 }
 
 template <typename Dtype>
 void Blob<Dtype>::ShareDiff(const Blob& other) {
   CHECK_EQ(count_, other.count());
-  diff_ = other.diff();
+  if (!other.diff_) {
+    return;
+  }
+  diff_ = other.diff_;
 }
 
 // The "update" method is used for parameter blobs in a Net, which are stored
@@ -177,7 +206,7 @@ void Blob<Dtype>::Update() {
   case SyncedMemory::HEAD_AT_CPU:
     // perform computation on CPU
     caffe_axpy<Dtype>(count_, Dtype(-1),
-        static_cast<const Dtype*>(diff_->cpu_data()),
+        static_cast<const Dtype*>(diff()->cpu_data()),
         static_cast<Dtype*>(data_->mutable_cpu_data()));
     break;
   case SyncedMemory::HEAD_AT_GPU:
@@ -185,7 +214,7 @@ void Blob<Dtype>::Update() {
 #ifndef CPU_ONLY
     // perform computation on GPU
     caffe_gpu_axpy<Dtype>(count_, Dtype(-1),
-        static_cast<const Dtype*>(diff_->gpu_data()),
+        static_cast<const Dtype*>(diff()->gpu_data()),
         static_cast<Dtype*>(data_->mutable_gpu_data()));
 #else
     NO_GPU;
@@ -441,8 +470,7 @@ void Blob<Dtype>::CopyFrom(const Blob& source, bool copy_diff, bool reshape) {
   switch (Caffe::mode()) {
   case Caffe::GPU:
     if (copy_diff) {
-      caffe_copy(count_, source.gpu_diff(),
-          static_cast<Dtype*>(diff_->mutable_gpu_data()));
+      caffe_copy(count_, source.gpu_diff(), mutable_gpu_diff());
     } else {
       caffe_copy(count_, source.gpu_data(),
           static_cast<Dtype*>(data_->mutable_gpu_data()));
@@ -450,8 +478,7 @@ void Blob<Dtype>::CopyFrom(const Blob& source, bool copy_diff, bool reshape) {
     break;
   case Caffe::CPU:
     if (copy_diff) {
-      caffe_copy(count_, source.cpu_diff(),
-          static_cast<Dtype*>(diff_->mutable_cpu_data()));
+      caffe_copy(count_, source.cpu_diff(), mutable_cpu_diff());
     } else {
       caffe_copy(count_, source.cpu_data(),
           static_cast<Dtype*>(data_->mutable_cpu_data()));
@@ -487,7 +514,11 @@ void Blob<Dtype>::FromProto(const BlobProto& proto, bool reshape) {
   }
   // copy data
   Dtype* data_vec = mutable_cpu_data();
-  if (proto.double_data_size() > 0) {
+  if (proto.has_half_data()) {
+    vector<float> values(count_);
+    DecodeHalf(count_, proto.half_data(), proto.half_format(), values.data());
+    std::copy(values.begin(), values.end(), data_vec);
+  } else if (proto.double_data_size() > 0) {
     CHECK_EQ(count_, proto.double_data_size());
     for (int i = 0; i < count_; ++i) {
       data_vec[i] = proto.double_data(i);
@@ -553,6 +584,23 @@ void Blob<float>::ToProto(BlobProto* proto, bool write_diff) const {
   }
 }
 
+template <typename Dtype>
+void Blob<Dtype>::ToHalfProto(BlobProto* proto,
+    const HalfFormat format) const {
+  proto->clear_shape();
+  for (int i = 0; i < shape_.size(); ++i) {
+    proto->mutable_shape()->add_dim(shape_[i]);
+  }
+  proto->clear_data();
+  proto->clear_diff();
+  proto->clear_double_data();
+  proto->clear_double_diff();
+  const Dtype* data_vec = cpu_data();
+  const vector<float> values(data_vec, data_vec + count_);
+  EncodeHalf(count_, values.data(), format, proto->mutable_half_data());
+  proto->set_half_format(format);
+}
+
 INSTANTIATE_CLASS(Blob);
 template class Blob<int>;
 template class Blob<unsigned int>;
@@ -1,5 +1,9 @@
 #include <boost/thread.hpp>
 #include <glog/logging.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include <algorithm>
 #include <cmath>
 #include <cstdio>
 #include <ctime>
@@ -19,6 +23,28 @@ Caffe& Caffe::Get() {
   return *(thread_instance_.get());
 }
 
+// The thread count of the parallel CPU loops, shared by all the threads.
+static int num_threads_ = 0;
+// Fewer elements per thread cost more in synchronization than they save.
+static const int kParallelGrain = 8192;
+
+int Caffe::num_threads() {
+#ifdef _OPENMP
+  return num_threads_ > 0 ? num_threads_ : omp_get_max_threads();
+#else
+  return 1;
+#endif
+}
+
+void Caffe::set_num_threads(const int num_threads) {
+  CHECK_GE(num_threads, 0);
+  num_threads_ = num_threads;
+}
+
+int Caffe::parallel_threads(const int work) {
+  return std::max(1, std::min(num_threads(), work / kParallelGrain));
+}
+
 // random seeding
 int64_t cluster_seedgen(void) {
   int64_t s, seed, pid;
@@ -11,36 +11,48 @@ InternalThread::~InternalThread() {
 }
 
 bool InternalThread::is_started() const {
-  return thread_ && thread_->joinable();
+  for (int i = 0; i < threads_.size(); ++i) {
+    if (threads_[i]->joinable()) {
+      return true;
+    }
+  }
+  return false;
 }
 
 bool InternalThread::must_stop() {
-  return thread_ && thread_->interruption_requested();
+  // Asked by the internal threads themselves, which must not read threads_
+  // while StartInternalThread is still appending to it
+  return boost::this_thread::interruption_requested();
 }
 
-void InternalThread::StartInternalThread() {
+void InternalThread::StartInternalThread(int thread_count) {
   CHECK(!is_started()) << "Threads should persist and not be restarted.";
+  CHECK_GE(thread_count, 1);
 
   int device = 0;
 #ifndef CPU_ONLY
   CUDA_CHECK(cudaGetDevice(&device));
 #endif
   Caffe::Brew mode = Caffe::mode();
-  int rand_seed = caffe_rng_rand();
   int solver_count = Caffe::solver_count();
   int solver_rank = Caffe::solver_rank();
   bool multiprocess = Caffe::multiprocess();
 
+  threads_.clear();
   try {
-    thread_.reset(new boost::thread(&InternalThread::entry, this, device, mode,
-          rand_seed, solver_count, solver_rank, multiprocess));
+    for (int i = 0; i < thread_count; ++i) {
+      int rand_seed = caffe_rng_rand();
+      threads_.push_back(shared_ptr<boost::thread>(new boost::thread(
+          &InternalThread::entry, this, i, device, mode, rand_seed,
+          solver_count, solver_rank, multiprocess)));
+    }
   } catch (std::exception& e) {
     LOG(FATAL) << "Thread exception: " << e.what();
   }
 }
 
-void InternalThread::entry(int device, Caffe::Brew mode, int rand_seed,
-    int solver_count, int solver_rank, bool multiprocess) {
+void InternalThread::entry(int thread_id, int device, Caffe::Brew mode,
+    int rand_seed, int solver_count, int solver_rank, bool multiprocess) {
 #ifndef CPU_ONLY
   CUDA_CHECK(cudaSetDevice(device));
 #endif
@@ -50,17 +62,21 @@ void InternalThread::entry(int device, Caffe::Brew mode, int rand_seed,
   Caffe::set_solver_rank(solver_rank);
   Caffe::set_multiprocess(multiprocess);
 
-  InternalThreadEntry();
+  InternalThreadEntryN(thread_id);
 }
 
 void InternalThread::StopInternalThread() {
   if (is_started()) {
-    thread_->interrupt();
-    try {
-      thread_->join();
-    } catch (boost::thread_interrupted&) {
-    } catch (std::exception& e) {
-      LOG(FATAL) << "Thread exception: " << e.what();
+    for (int i = 0; i < threads_.size(); ++i) {
+      threads_[i]->interrupt();
+    }
+    for (int i = 0; i < threads_.size(); ++i) {
+      try {
+        threads_[i]->join();
+      } catch (boost::thread_interrupted&) {
+      } catch (std::exception& e) {
+        LOG(FATAL) << "Thread exception: " << e.what();
+      }
     }
   }
 }
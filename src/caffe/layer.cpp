@@ -2,6 +2,48 @@
 
 namespace caffe {
 
+// The signature lists, for each bottom then top blob, the blob itself (e.g.
+// in-place computation is detected by Reshape), its number of axes and its
+// shape, and for bottom blobs, their SyncedMemory: layers sharing it in
+// Reshape (e.g. the Reshape layer) must share it again once it is replaced.
+template <typename Dtype>
+bool Layer<Dtype>::UpdateReshapeSignature(const vector<Blob<Dtype>*>& bottom,
+    const vector<Blob<Dtype>*>& top) {
+  bool changed = false;
+  size_t index = 0;
+  vector<intptr_t>& signature = reshape_signature_;
+  // Compares in place, no allocation once the signature is complete
+  const auto update = [&signature, &index, &changed](intptr_t value) {
+    if (index == signature.size()) {
+      signature.push_back(value);
+      changed = true;
+    } else if (signature[index] != value) {
+      signature[index] = value;
+      changed = true;
+    }
+    ++index;
+  };
+  for (int i = 0; i < bottom.size() + top.size(); ++i) {
+    const Blob<Dtype>& blob = i < bottom.size() ?
+        *bottom[i] : *top[i - bottom.size()];
+    const vector<int>& shape = blob.shape();
+    update(reinterpret_cast<intptr_t>(&blob));
+    update(shape.size());
+    for (int axis = 0; axis < shape.size(); ++axis) {
+      update(shape[axis]);
+    }
+    if (i < bottom.size()) {
+      update(reinterpret_cast<intptr_t>(
+          blob.count() > 0 ? blob.data().get() : NULL));
+    }
+  }
+  if (index != signature.size()) {
+    signature.resize(index);
+    changed = true;
+  }
+  return changed;
+}
+
 INSTANTIATE_CLASS(Layer);
 
 }  // namespace caffe
@@ -240,6 +240,26 @@ void BaseConvolutionLayer<Dtype>::Reshape(const vector<Blob<Dtype>*>& bottom,
     }
   }
   col_buffer_.Reshape(col_buffer_shape_);
+  // Lowering several images at once (col_buffer_batch_kb) widens the GEMMs.
+  // The buffers hold the columns and outputs of col_batch_ images.
+  col_batch_ = 1;
+  const size_t batch_bytes = size_t(1024) *
+      this->layer_param_.convolution_param().col_buffer_batch_kb();
+  if (batch_bytes > 0 && !reverse_dimensions() && num_spatial_axes_ == 2
+      && !force_nd_im2col_) {
+    const size_t image_bytes = sizeof(Dtype) * conv_out_spatial_dim_ *
+        (kernel_dim_ * group_ + conv_out_channels_);
+    col_batch_ = std::max(1, static_cast<int>(
+        std::min<size_t>(num_, batch_bytes / image_bytes)));
+  }
+  if (col_batch_ > 1) {
+    vector<int> batch_shape(2);
+    batch_shape[0] = kernel_dim_ * group_;
+    batch_shape[1] = col_batch_ * conv_out_spatial_dim_;
+    col_batch_buffer_.Reshape(batch_shape);
+    batch_shape[0] = conv_out_channels_;
+    output_batch_buffer_.Reshape(batch_shape);
+  }
   bottom_dim_ = bottom[0]->count(channel_axis_);
   top_dim_ = top[0]->count(channel_axis_);
   num_kernels_im2col_ = conv_in_channels_ * conv_out_spatial_dim_;
@@ -272,6 +292,24 @@ void BaseConvolutionLayer<Dtype>::forward_cpu_gemm(const Dtype* input,
   }
 }
 
+template <typename Dtype>
+void BaseConvolutionLayer<Dtype>::forward_cpu_gemm_int8(const Dtype* input,
+    Int8Gemm<Dtype>* int8_gemm, Dtype* output) {
+  const Dtype* col_buff = input;
+  if (!is_1x1_) {
+    conv_im2col_cpu(input, col_buffer_.mutable_cpu_data());
+    col_buff = col_buffer_.cpu_data();
+  }
+  const uint8_t* col_int8 = int8_gemm->QuantizeInput(
+      kernel_dim_ * group_ * conv_out_spatial_dim_, col_buff);
+  const int group_outputs = conv_out_channels_ / group_;
+  for (int g = 0; g < group_; ++g) {
+    int8_gemm->Forward(CblasNoTrans, group_outputs * g, group_outputs,
+        conv_out_spatial_dim_, col_int8 + col_offset_ * g,
+        output + output_offset_ * g, conv_out_spatial_dim_, 1);
+  }
+}
+
 template <typename Dtype>
 void BaseConvolutionLayer<Dtype>::forward_cpu_bias(Dtype* output,
     const Dtype* bias) {
@@ -321,6 +359,75 @@ void BaseConvolutionLayer<Dtype>::backward_cpu_bias(Dtype* bias,
       input, bias_multiplier_.cpu_data(), 1., bias);
 }
 
+template <typename Dtype>
+void BaseConvolutionLayer<Dtype>::forward_cpu_gemm_batch(const Dtype* input,
+    const Dtype* weights, Dtype* output, const int batch) {
+  const int batch_dim = batch * conv_out_spatial_dim_;
+  Dtype* col_buff = col_batch_buffer_.mutable_cpu_data();
+  for (int n = 0; n < batch; ++n) {
+    conv_im2col_cpu(input + n * bottom_dim_,
+        col_buff + n * conv_out_spatial_dim_, batch_dim);
+  }
+  Dtype* output_buff = output_batch_buffer_.mutable_cpu_data();
+  for (int g = 0; g < group_; ++g) {
+    caffe_cpu_gemm<Dtype>(CblasNoTrans, CblasNoTrans, conv_out_channels_ /
+        group_, batch_dim, kernel_dim_,
+        (Dtype)1., weights + weight_offset_ * g,
+        col_buff + col_offset_ * batch * g,
+        (Dtype)0., output_buff + output_offset_ * batch * g);
+  }
+  // Back to one output per image
+  for (int n = 0; n < batch; ++n) {
+    for (int c = 0; c < conv_out_channels_; ++c) {
+      caffe_copy(conv_out_spatial_dim_,
+          output_buff + c * batch_dim + n * conv_out_spatial_dim_,
+          output + n * top_dim_ + c * conv_out_spatial_dim_);
+    }
+  }
+}
+
+template <typename Dtype>
+void BaseConvolutionLayer<Dtype>::backward_cpu_gemm_batch(const Dtype* input,
+    const Dtype* output, const Dtype* weights, Dtype* weight_diff,
+    Dtype* input_diff, const int batch) {
+  const int batch_dim = batch * conv_out_spatial_dim_;
+  Dtype* output_buff = output_batch_buffer_.mutable_cpu_data();
+  for (int n = 0; n < batch; ++n) {
+    for (int c = 0; c < conv_out_channels_; ++c) {
+      caffe_copy(conv_out_spatial_dim_,
+          output + n * top_dim_ + c * conv_out_spatial_dim_,
+          output_buff + c * batch_dim + n * conv_out_spatial_dim_);
+    }
+  }
+  Dtype* col_buff = col_batch_buffer_.mutable_cpu_data();
+  if (weight_diff) {
+    for (int n = 0; n < batch; ++n) {
+      conv_im2col_cpu(input + n * bottom_dim_,
+          col_buff + n * conv_out_spatial_dim_, batch_dim);
+    }
+    for (int g = 0; g < group_; ++g) {
+      caffe_cpu_gemm<Dtype>(CblasNoTrans, CblasTrans,
+          conv_out_channels_ / group_, kernel_dim_, batch_dim,
+          (Dtype)1., output_buff + output_offset_ * batch * g,
+          col_buff + col_offset_ * batch * g,
+          (Dtype)1., weight_diff + weight_offset_ * g);
+    }
+  }
+  if (input_diff) {
+    for (int g = 0; g < group_; ++g) {
+      caffe_cpu_gemm<Dtype>(CblasTrans, CblasNoTrans, kernel_dim_,
+          batch_dim, conv_out_channels_ / group_,
+          (Dtype)1., weights + weight_offset_ * g,
+          output_buff + output_offset_ * batch * g,
+          (Dtype)0., col_buff + col_offset_ * batch * g);
+    }
+    for (int n = 0; n < batch; ++n) {
+      conv_col2im_cpu(col_buff + n * conv_out_spatial_dim_,
+          input_diff + n * bottom_dim_, batch_dim);
+    }
+  }
+}
+
 #ifndef CPU_ONLY
 
 template <typename Dtype>
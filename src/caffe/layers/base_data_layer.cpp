@@ -1,4 +1,7 @@
 #include <boost/thread.hpp>
+#include <algorithm>
+#include <chrono>
+#include <map>
 #include <vector>
 
 #include "caffe/blob.hpp"
@@ -11,6 +14,42 @@
 
 namespace caffe {
 
+namespace {
+
+// State of the prefetch worker running on the calling thread
+struct PrefetchWorker {
+  int index;
+  // Whether the worker is in the ordered section
+  bool reading;
+};
+
+boost::thread_specific_ptr<PrefetchWorker>& CurrentPrefetchWorker() {
+  static boost::thread_specific_ptr<PrefetchWorker> worker;
+  return worker;
+}
+
+// Adaptive prefetching: Forward calls between decisions, wait ratios
+// considered significant or negligible, and negligible periods before
+// removing a batch
+const int kPrefetchAdaptForwards = 50;
+const double kPrefetchStallRatio = 0.02;
+const double kPrefetchQuietRatio = 0.001;
+const int kPrefetchQuietPeriods = 20;
+
+double PrefetchClock() {
+  return std::chrono::duration<double>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}  // namespace
+
+template <typename Dtype>
+class BasePrefetchingDataLayer<Dtype>::sync {
+ public:
+  boost::mutex mutex_;
+  boost::condition_variable read_turn_;
+};
+
 template <typename Dtype>
 BaseDataLayer<Dtype>::BaseDataLayer(const LayerParameter& param)
     : Layer<Dtype>(param),
@@ -37,7 +76,20 @@ BasePrefetchingDataLayer<Dtype>::BasePrefetchingDataLayer(
     const LayerParameter& param)
     : BaseDataLayer<Dtype>(param),
       prefetch_(param.data_param().prefetch()),
-      prefetch_free_(), prefetch_full_(), prefetch_current_() {
+      prefetch_free_(std::max(param.data_param().prefetch(),
+                              param.data_param().prefetch_max())),
+      prefetch_full_(std::max(param.data_param().prefetch(),
+                              param.data_param().prefetch_max())),
+      prefetch_current_(),
+      prefetch_threads_(param.data_param().prefetch_threads()),
+      prefetch_min_(param.data_param().prefetch()),
+      prefetch_max_(param.data_param().prefetch_max()),
+      prefetch_max_bytes_(size_t(param.data_param().prefetch_max_mb()) << 20),
+      prefetch_forwards_(), prefetch_quiet_periods_(),
+      prefetch_remove_pending_(false),
+      sync_(new sync()), prefetch_sequence_(), prefetch_read_turn_(),
+      prefetch_published_() {
+  CHECK_GE(prefetch_threads_, 1) << "prefetch_threads must be positive";
   for (int i = 0; i < prefetch_.size(); ++i) {
     prefetch_[i].reset(new Batch<Dtype>());
     prefetch_free_.push(prefetch_[i].get());
@@ -48,6 +100,13 @@ template <typename Dtype>
 void BasePrefetchingDataLayer<Dtype>::LayerSetUp(
     const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top) {
   BaseDataLayer<Dtype>::LayerSetUp(bottom, top);
+  // Worker 0 uses data_transformer_, the others their own copy
+  prefetch_transformers_.clear();
+  prefetch_transformers_.push_back(this->data_transformer_);
+  for (int i = 1; i < prefetch_threads_; ++i) {
+    prefetch_transformers_.push_back(shared_ptr<DataTransformer<Dtype> >(
+        new DataTransformer<Dtype>(this->transform_param_, this->phase_)));
+  }
 
   // Before starting the prefetch thread, we make cpu_data and gpu_data
   // calls so that the prefetch thread does not accidentally make simultaneous
@@ -70,13 +129,20 @@ void BasePrefetchingDataLayer<Dtype>::LayerSetUp(
   }
 #endif
   DLOG(INFO) << "Initializing prefetch";
-  this->data_transformer_->InitRand();
-  StartInternalThread();
+  for (int i = 0; i < prefetch_transformers_.size(); ++i) {
+    prefetch_transformers_[i]->InitRand();
+  }
+  StartInternalThread(prefetch_threads_);
+  prefetch_adapt_snapshot_ = TakePrefetchSnapshot();
+  prefetch_stats_snapshot_ = prefetch_adapt_snapshot_;
   DLOG(INFO) << "Prefetch initialized.";
 }
 
 template <typename Dtype>
-void BasePrefetchingDataLayer<Dtype>::InternalThreadEntry() {
+void BasePrefetchingDataLayer<Dtype>::InternalThreadEntryN(int worker) {
+  CurrentPrefetchWorker().reset(new PrefetchWorker());
+  CurrentPrefetchWorker()->index = worker;
+  CurrentPrefetchWorker()->reading = false;
 #ifndef CPU_ONLY
   cudaStream_t stream;
   if (Caffe::mode() == Caffe::GPU) {
@@ -87,7 +153,18 @@ void BasePrefetchingDataLayer<Dtype>::InternalThreadEntry() {
   try {
     while (!must_stop()) {
       Batch<Dtype>* batch = prefetch_free_.pop();
+      uint64_t sequence;
+      {
+        // Wait until the previous batch has been read
+        boost::mutex::scoped_lock lock(sync_->mutex_);
+        sequence = prefetch_sequence_++;
+        while (prefetch_read_turn_ != sequence) {
+          sync_->read_turn_.wait(lock);
+        }
+      }
+      CurrentPrefetchWorker()->reading = true;
       load_batch(batch);
+      EndOrderedRead();
 #ifndef CPU_ONLY
       if (Caffe::mode() == Caffe::GPU) {
         batch->data_.data().get()->async_gpu_push(stream);
@@ -97,7 +174,7 @@ void BasePrefetchingDataLayer<Dtype>::InternalThreadEntry() {
         CUDA_CHECK(cudaStreamSynchronize(stream));
       }
 #endif
-      prefetch_full_.push(batch);
+      PublishBatch(sequence, batch);
     }
   } catch (boost::thread_interrupted&) {
     // Interrupted exception is expected on shutdown
@@ -110,22 +187,208 @@ void BasePrefetchingDataLayer<Dtype>::InternalThreadEntry() {
 }
 
 template <typename Dtype>
-void BasePrefetchingDataLayer<Dtype>::Forward_cpu(
-    const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top) {
-  if (prefetch_current_) {
+void BasePrefetchingDataLayer<Dtype>::EndOrderedRead() {
+  PrefetchWorker* worker = CurrentPrefetchWorker().get();
+  if (!worker || !worker->reading) {
+    return;
+  }
+  worker->reading = false;
+  {
+    boost::mutex::scoped_lock lock(sync_->mutex_);
+    ++prefetch_read_turn_;
+  }
+  sync_->read_turn_.notify_all();
+}
+
+template <typename Dtype>
+int BasePrefetchingDataLayer<Dtype>::prefetch_worker() const {
+  PrefetchWorker* worker = CurrentPrefetchWorker().get();
+  return worker ? worker->index : 0;
+}
+
+template <typename Dtype>
+DataTransformer<Dtype>*
+BasePrefetchingDataLayer<Dtype>::prefetch_transformer() const {
+  return prefetch_transformers_[prefetch_worker()].get();
+}
+
+template <typename Dtype>
+typename BasePrefetchingDataLayer<Dtype>::PrefetchSnapshot
+BasePrefetchingDataLayer<Dtype>::TakePrefetchSnapshot() const {
+  PrefetchSnapshot snapshot;
+  snapshot.seconds = PrefetchClock();
+  snapshot.consumer_wait_seconds = prefetch_full_.stats().pop_wait_seconds;
+  snapshot.loader_wait_seconds = prefetch_free_.stats().pop_wait_seconds;
+  return snapshot;
+}
+
+template <typename Dtype>
+typename BasePrefetchingDataLayer<Dtype>::PrefetchStats
+BasePrefetchingDataLayer<Dtype>::prefetch_stats() {
+  const PrefetchSnapshot snapshot = TakePrefetchSnapshot();
+  const double seconds =
+      std::max(snapshot.seconds - prefetch_stats_snapshot_.seconds, 1e-9);
+  PrefetchStats stats;
+  stats.depth = prefetch_.size();
+  stats.stall_ratio = (snapshot.consumer_wait_seconds
+      - prefetch_stats_snapshot_.consumer_wait_seconds) / seconds;
+  stats.loader_wait_ratio = (snapshot.loader_wait_seconds
+      - prefetch_stats_snapshot_.loader_wait_seconds)
+      / (seconds * prefetch_threads_);
+  prefetch_stats_snapshot_ = snapshot;
+  return stats;
+}
+
+// Extra batches only help if the stalls come from bursts, i.e. if the
+// prefetch threads could have loaded ahead but ran out of free batches. A
+// stalling Forward with busy prefetch threads needs more threads instead.
+template <typename Dtype>
+void BasePrefetchingDataLayer<Dtype>::AdaptPrefetch() {
+  if (prefetch_max_ <= prefetch_min_ || !AllowPrefetchResize()
+      || ++prefetch_forwards_ < kPrefetchAdaptForwards) {
+    return;
+  }
+  prefetch_forwards_ = 0;
+  const PrefetchSnapshot snapshot = TakePrefetchSnapshot();
+  const double seconds =
+      std::max(snapshot.seconds - prefetch_adapt_snapshot_.seconds, 1e-9);
+  const double stall_ratio = (snapshot.consumer_wait_seconds
+      - prefetch_adapt_snapshot_.consumer_wait_seconds) / seconds;
+  const double loader_wait_ratio = (snapshot.loader_wait_seconds
+      - prefetch_adapt_snapshot_.loader_wait_seconds)
+      / (seconds * prefetch_threads_);
+  prefetch_adapt_snapshot_ = snapshot;
+
+  const int depth = prefetch_.size();
+  const size_t batch_bytes = sizeof(Dtype) * (prefetch_current_->data_.count()
+      + prefetch_current_->label_.count());
+  if (stall_ratio > kPrefetchStallRatio
+      && loader_wait_ratio > kPrefetchStallRatio) {
+    prefetch_quiet_periods_ = 0;
+    if (depth < prefetch_max_ && (depth + 1) * batch_bytes
+        <= prefetch_max_bytes_) {
+      AddPrefetchBatch();
+      LOG_IF(INFO, Caffe::root_solver()) << this->layer_param_.name()
+          << ": prefetching " << depth + 1 << " batches (Forward waited "
+          << 100 * stall_ratio << "% of the time)";
+    }
+  } else if (stall_ratio < kPrefetchQuietRatio) {
+    if (++prefetch_quiet_periods_ >= kPrefetchQuietPeriods
+        && depth > prefetch_min_) {
+      prefetch_quiet_periods_ = 0;
+      RemovePrefetchBatch();
+    }
+  } else {
+    prefetch_quiet_periods_ = 0;
+  }
+}
+
+// Called from Forward: prefetch_current_ is not being loaded
+template <typename Dtype>
+void BasePrefetchingDataLayer<Dtype>::AddPrefetchBatch() {
+  shared_ptr<Batch<Dtype> > batch(new Batch<Dtype>());
+  batch->data_.ReshapeLike(prefetch_current_->data_);
+  batch->data_.mutable_cpu_data();
+  if (this->output_labels_) {
+    batch->label_.ReshapeLike(prefetch_current_->label_);
+    batch->label_.mutable_cpu_data();
+  }
+#ifndef CPU_ONLY
+  if (Caffe::mode() == Caffe::GPU) {
+    batch->data_.mutable_gpu_data();
+    if (this->output_labels_) {
+      batch->label_.mutable_gpu_data();
+    }
+  }
+#endif
+  prefetch_.push_back(batch);
+  prefetch_free_.push(batch.get());
+}
+
+// Only a free batch can go. If all are loaded or being loaded (the queue
+// stays full when Forward is the slower side), prefetch_current_ goes
+// instead of being released.
+template <typename Dtype>
+void BasePrefetchingDataLayer<Dtype>::RemovePrefetchBatch() {
+  Batch<Dtype>* batch;
+  if (prefetch_free_.try_pop(&batch)) {
+    ErasePrefetchBatch(batch);
+  } else {
+    prefetch_remove_pending_ = true;
+  }
+}
+
+template <typename Dtype>
+void BasePrefetchingDataLayer<Dtype>::ErasePrefetchBatch(
+    Batch<Dtype>* batch) {
+  for (int i = 0; i < prefetch_.size(); ++i) {
+    if (prefetch_[i].get() == batch) {
+      prefetch_.erase(prefetch_.begin() + i);
+      break;
+    }
+  }
+  LOG_IF(INFO, Caffe::root_solver()) << this->layer_param_.name()
+      << ": prefetching " << prefetch_.size() << " batches";
+}
+
+// Batches finished out of order wait in prefetch_reorder_ for the previous
+// ones
+template <typename Dtype>
+void BasePrefetchingDataLayer<Dtype>::PublishBatch(uint64_t sequence,
+    Batch<Dtype>* batch) {
+  boost::mutex::scoped_lock lock(sync_->mutex_);
+  prefetch_reorder_[sequence] = batch;
+  typename std::map<uint64_t, Batch<Dtype>*>::iterator it;
+  while ((it = prefetch_reorder_.find(prefetch_published_))
+         != prefetch_reorder_.end()) {
+    prefetch_full_.push(it->second);
+    prefetch_reorder_.erase(it);
+    ++prefetch_published_;
+  }
+}
+
+// The net is done with the previous batch once Forward is called again:
+// the layers sharing it downstream (Split, Flatten, ...) move to the next
+// one during this pass, before reading their bottoms
+template <typename Dtype>
+void BasePrefetchingDataLayer<Dtype>::ReleaseCurrentBatch() {
+  if (!prefetch_current_) {
+    return;
+  }
+  if (prefetch_remove_pending_) {
+    prefetch_remove_pending_ = false;
+    ErasePrefetchBatch(prefetch_current_);
+  } else {
     prefetch_free_.push(prefetch_current_);
   }
-  prefetch_current_ = prefetch_full_.pop("Waiting for data");
-  // Reshape to loaded data.
-  top[0]->ReshapeLike(prefetch_current_->data_);
-  top[0]->set_cpu_data(prefetch_current_->data_.mutable_cpu_data());
+  prefetch_current_ = NULL;
+}
+
+// Only reshapes the tops when the batch shape changes
+template <typename Dtype>
+void BasePrefetchingDataLayer<Dtype>::ShareCurrentBatch(
+    const vector<Blob<Dtype>*>& top) {
+  if (top[0]->shape() != prefetch_current_->data_.shape()) {
+    top[0]->ReshapeLike(prefetch_current_->data_);
+  }
+  top[0]->ShareData(prefetch_current_->data_);
   if (this->output_labels_) {
-    // Reshape to loaded labels.
-    top[1]->ReshapeLike(prefetch_current_->label_);
-    top[1]->set_cpu_data(prefetch_current_->label_.mutable_cpu_data());
+    if (top[1]->shape() != prefetch_current_->label_.shape()) {
+      top[1]->ReshapeLike(prefetch_current_->label_);
+    }
+    top[1]->ShareData(prefetch_current_->label_);
   }
 }
 
+template <typename Dtype>
+void BasePrefetchingDataLayer<Dtype>::Forward_cpu(
+    const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top) {
+  ReleaseCurrentBatch();
+  prefetch_current_ = prefetch_full_.pop();
+  AdaptPrefetch();
+  ShareCurrentBatch(top);
+}
+
 #ifdef CPU_ONLY
 STUB_GPU_FORWARD(BasePrefetchingDataLayer, Forward);
 #endif
@@ -1,7 +1,9 @@
 #include <algorithm>
+#include <cmath>
 #include <vector>
 
 #include "caffe/layers/bnll_layer.hpp"
+#include "caffe/util/fast_math.hpp"
 
 namespace caffe {
 
@@ -13,10 +15,10 @@ void BNLLLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
   const Dtype* bottom_data = bottom[0]->cpu_data();
   Dtype* top_data = top[0]->mutable_cpu_data();
   const int count = bottom[0]->count();
+  CAFFE_PARALLEL_FOR(count)
   for (int i = 0; i < count; ++i) {
-    top_data[i] = bottom_data[i] > 0 ?
-        bottom_data[i] + log(1. + exp(-bottom_data[i])) :
-        log(1. + exp(bottom_data[i]));
+    top_data[i] = std::max(bottom_data[i], Dtype(0))
+        + fast_log(Dtype(1) + fast_exp(-std::fabs(bottom_data[i])));
   }
 }
 
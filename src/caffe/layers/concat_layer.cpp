@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <vector>
 
 #include "caffe/layers/concat_layer.hpp"
@@ -58,18 +59,43 @@ void ConcatLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
       const vector<Blob<Dtype>*>& top) {
   if (bottom.size() == 1) { return; }
   Dtype* top_data = top[0]->mutable_cpu_data();
-  int offset_concat_axis = 0;
   const int top_concat_axis = top[0]->shape(concat_axis_);
+  vector<const Dtype*> bottom_data(bottom.size());
+  vector<int> offset_concat_axis(bottom.size() + 1, 0);
   for (int i = 0; i < bottom.size(); ++i) {
-    const Dtype* bottom_data = bottom[i]->cpu_data();
-    const int bottom_concat_axis = bottom[i]->shape(concat_axis_);
-    for (int n = 0; n < num_concats_; ++n) {
-      caffe_copy(bottom_concat_axis * concat_input_size_,
-          bottom_data + n * bottom_concat_axis * concat_input_size_,
-          top_data + (n * top_concat_axis + offset_concat_axis)
-              * concat_input_size_);
+    bottom_data[i] = bottom[i]->cpu_data();
+    offset_concat_axis[i + 1] =
+        offset_concat_axis[i] + bottom[i]->shape(concat_axis_);
+  }
+  // Bottoms viewing the top (see Net::PlanActivationMemory) are in place. A
+  // reshape since the plan may have left the others inside the top: these
+  // are set aside before it is written.
+  const Dtype* top_end = top_data + top[0]->count();
+  vector<bool> in_place(bottom.size());
+  vector<vector<Dtype> > aside(bottom.size());
+  for (int i = 0; i < bottom.size(); ++i) {
+    in_place[i] = num_concats_ == 1 && bottom_data[i]
+        == top_data + offset_concat_axis[i] * concat_input_size_;
+    const Dtype* bottom_end = bottom_data[i] + bottom[i]->count();
+    if (!in_place[i] && bottom_data[i] < top_end && bottom_end > top_data) {
+      aside[i].assign(bottom_data[i], bottom_end);
+      bottom_data[i] = aside[i].data();
     }
-    offset_concat_axis += bottom_concat_axis;
+  }
+  // One copy per bottom and concatenation
+  CAFFE_PARALLEL_FOR(top[0]->count())
+  for (int in = 0; in < bottom.size() * num_concats_; ++in) {
+    const int i = in / num_concats_;
+    const int n = in % num_concats_;
+    if (in_place[i]) {
+      continue;
+    }
+    const int bottom_concat_size =
+        (offset_concat_axis[i + 1] - offset_concat_axis[i])
+        * concat_input_size_;
+    const Dtype* source = bottom_data[i] + n * bottom_concat_size;
+    std::copy(source, source + bottom_concat_size, top_data
+        + (n * top_concat_axis + offset_concat_axis[i]) * concat_input_size_);
   }
 }
 
@@ -1,9 +1,15 @@
+#include <algorithm>
+#include <cmath>
 #include <vector>
 
 #include "caffe/layers/conv_layer.hpp"
+#include "caffe/util/math_functions.hpp"
 
 namespace caffe {
 
+template <typename Dtype>
+const int ConvolutionLayer<Dtype>::kMaxGroupChannels;
+
 template <typename Dtype>
 void ConvolutionLayer<Dtype>::compute_output_shape() {
   const int* kernel_shape_data = this->kernel_shape_.cpu_data();
@@ -21,18 +27,228 @@ void ConvolutionLayer<Dtype>::compute_output_shape() {
   }
 }
 
+template <typename Dtype>
+bool ConvolutionLayer<Dtype>::FuseInference(Layer<Dtype>* batch_norm,
+    Layer<Dtype>* scale, Layer<Dtype>* relu) {
+  if (batch_norm) {
+    CHECK_EQ(batch_norm->blobs()[0]->count(), this->num_output_);
+  }
+  if (scale) {
+    CHECK_EQ(scale->blobs()[0]->count(), this->num_output_);
+  }
+  fused_batch_norm_ = batch_norm;
+  fused_scale_ = scale;
+  fused_relu_ = relu;
+  // Folded again by the next Forward
+  fused_versions_.clear();
+  if (batch_norm || scale) {
+    fused_weights_.ReshapeLike(*this->blobs_[0]);
+    fused_bias_.Reshape(vector<int>(1, this->num_output_));
+  }
+  return true;
+}
+
+template <typename Dtype>
+void ConvolutionLayer<Dtype>::FoldFusedLayers() {
+  vector<Blob<Dtype>*> sources;
+  for (int i = 0; i < this->blobs_.size(); ++i) {
+    sources.push_back(this->blobs_[i].get());
+  }
+  if (fused_batch_norm_) {
+    for (int i = 0; i < fused_batch_norm_->blobs().size(); ++i) {
+      sources.push_back(fused_batch_norm_->blobs()[i].get());
+    }
+  }
+  if (fused_scale_) {
+    for (int i = 0; i < fused_scale_->blobs().size(); ++i) {
+      sources.push_back(fused_scale_->blobs()[i].get());
+    }
+  }
+  vector<uint64_t> versions;
+  for (int i = 0; i < sources.size(); ++i) {
+    versions.push_back(sources[i]->data()->version());
+  }
+  if (versions == fused_versions_) {
+    return;
+  }
+  fused_versions_ = versions;
+  // Output channel c becomes a * (weight_c * x + bias_c) + b
+  const int num_output = this->num_output_;
+  const int weight_dim = this->blobs_[0]->count() / num_output;
+  const Dtype* weight = this->blobs_[0]->cpu_data();
+  const Dtype* bias = this->bias_term_ ? this->blobs_[1]->cpu_data() : NULL;
+  Dtype* fused_weight = fused_weights_.mutable_cpu_data();
+  Dtype* fused_bias = fused_bias_.mutable_cpu_data();
+  for (int c = 0; c < num_output; ++c) {
+    Dtype a = 1;
+    Dtype b = 0;
+    if (fused_batch_norm_) {
+      const vector<shared_ptr<Blob<Dtype> > >& stats =
+          fused_batch_norm_->blobs();
+      const Dtype scale_factor = stats[2]->cpu_data()[0] == 0 ?
+          0 : 1 / stats[2]->cpu_data()[0];
+      const Dtype eps =
+          fused_batch_norm_->layer_param().batch_norm_param().eps();
+      a = 1 / std::sqrt(scale_factor * stats[1]->cpu_data()[c] + eps);
+      b = -a * scale_factor * stats[0]->cpu_data()[c];
+    }
+    if (fused_scale_) {
+      const Dtype gamma = fused_scale_->blobs()[0]->cpu_data()[c];
+      a *= gamma;
+      b *= gamma;
+      if (fused_scale_->layer_param().scale_param().bias_term()) {
+        b += fused_scale_->blobs()[1]->cpu_data()[c];
+      }
+    }
+    caffe_cpu_scale(weight_dim, a, weight + c * weight_dim,
+        fused_weight + c * weight_dim);
+    fused_bias[c] = (bias ? a * bias[c] : Dtype(0)) + b;
+  }
+}
+
+template <typename Dtype>
+void ConvolutionLayer<Dtype>::forward_cpu_bias_relu(Dtype* output,
+    const Dtype* bias) {
+  // Without ReLU the slope is 1, only adding the bias
+  const Dtype negative_slope = fused_relu_ ?
+      fused_relu_->layer_param().relu_param().negative_slope() : Dtype(1);
+  const int spatial_dim = this->out_spatial_dim_;
+  for (int c = 0; c < this->num_output_; ++c) {
+    const Dtype bias_value = bias ? bias[c] : Dtype(0);
+    Dtype* out = output + c * spatial_dim;
+    for (int j = 0; j < spatial_dim; ++j) {
+      const Dtype value = out[j] + bias_value;
+      out[j] = value > 0 ? value : negative_slope * value;
+    }
+  }
+}
+
+template <typename Dtype>
+bool ConvolutionLayer<Dtype>::use_grouped_kernel() {
+  return this->group_ > 1 && this->num_spatial_axes_ == 2
+      && !this->force_nd_im2col_
+      && this->channels_ / this->group_ <= kMaxGroupChannels;
+}
+
+template <typename Dtype>
+void ConvolutionLayer<Dtype>::forward_cpu_grouped(const Dtype* input,
+    const Dtype* weights, Dtype* output) {
+  const int kernel_h = this->kernel_shape_.cpu_data()[0];
+  const int kernel_w = this->kernel_shape_.cpu_data()[1];
+  const int stride_h = this->stride_.cpu_data()[0];
+  const int stride_w = this->stride_.cpu_data()[1];
+  const int dilation_h = this->dilation_.cpu_data()[0];
+  const int dilation_w = this->dilation_.cpu_data()[1];
+  const int pad_h = this->pad_.cpu_data()[0];
+  const int pad_w = this->pad_.cpu_data()[1];
+  const int height = this->input_shape(1);
+  const int width = this->input_shape(2);
+  const int output_h = this->output_shape_[0];
+  const int output_w = this->output_shape_[1];
+  const int group_channels = this->channels_ / this->group_;
+  const int group_outputs = this->num_output_ / this->group_;
+  const int kernel_dim = group_channels * kernel_h * kernel_w;
+  CAFFE_PARALLEL_FOR(this->top_dim_)
+  for (int k = 0; k < this->num_output_; ++k) {
+    Dtype* out = output + k * output_h * output_w;
+    std::fill(out, out + output_h * output_w, Dtype(0));
+    const Dtype* weight = weights + k * kernel_dim;
+    const int first_channel = (k / group_outputs) * group_channels;
+    for (int c = 0; c < group_channels; ++c) {
+      const Dtype* channel = input + (first_channel + c) * height * width;
+      for (int kh = 0; kh < kernel_h; ++kh) {
+        for (int kw = 0; kw < kernel_w; ++kw, ++weight) {
+          const Dtype w = *weight;
+          // The outputs [ow_begin, ow_end) of a row read inside the input
+          const int offset_w = kw * dilation_w - pad_w;
+          const int ow_begin = offset_w >= 0 ? 0
+              : std::min(output_w, (stride_w - 1 - offset_w) / stride_w);
+          const int ow_end = std::max(ow_begin, std::min(output_w,
+              (width - 1 - offset_w + stride_w) / stride_w));
+          for (int oh = 0; oh < output_h; ++oh) {
+            const int h = oh * stride_h + kh * dilation_h - pad_h;
+            if (h < 0 || h >= height) {
+              continue;
+            }
+            const Dtype* in = channel + h * width;
+            Dtype* out_row = out + oh * output_w;
+            for (int ow = ow_begin; ow < ow_end; ++ow) {
+              out_row[ow] += w * in[ow * stride_w + offset_w];
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+template <typename Dtype>
+bool ConvolutionLayer<Dtype>::use_int8() {
+  return this->phase_ == TEST && this->layer_param_.has_quantization_param()
+      && !use_grouped_kernel();
+}
+
+template <typename Dtype>
+void ConvolutionLayer<Dtype>::QuantizeWeights() {
+  if (!use_int8()) {
+    return;
+  }
+  const Blob<Dtype>* weights = this->blobs_[0].get();
+  if (fused_batch_norm_ || fused_scale_) {
+    FoldFusedLayers();
+    weights = &fused_weights_;
+  }
+  int8_gemm_.SetInputRange(this->layer_param_.quantization_param());
+  int8_gemm_.QuantizeWeights(this->num_output_,
+      weights->count() / this->num_output_, weights->cpu_data(),
+      weights->data()->version());
+}
+
 template <typename Dtype>
 void ConvolutionLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
       const vector<Blob<Dtype>*>& top) {
   const Dtype* weight = this->blobs_[0]->cpu_data();
+  const Dtype* bias = this->bias_term_ ? this->blobs_[1]->cpu_data() : NULL;
+  const bool fused = fused_batch_norm_ || fused_scale_ || fused_relu_;
+  if (fused_batch_norm_ || fused_scale_) {
+    FoldFusedLayers();
+    weight = fused_weights_.cpu_data();
+    bias = fused_bias_.cpu_data();
+  }
+  const bool grouped = use_grouped_kernel();
+  const bool int8 = use_int8();
+  if (int8) {
+    QuantizeWeights();
+  }
   for (int i = 0; i < bottom.size(); ++i) {
     const Dtype* bottom_data = bottom[i]->cpu_data();
     Dtype* top_data = top[i]->mutable_cpu_data();
-    for (int n = 0; n < this->num_; ++n) {
-      this->forward_cpu_gemm(bottom_data + n * this->bottom_dim_, weight,
-          top_data + n * this->top_dim_);
-      if (this->bias_term_) {
-        const Dtype* bias = this->blobs_[1]->cpu_data();
+    for (int n = 0; n < this->num_; n += this->col_batch_) {
+      const int batch = std::min(this->col_batch_, this->num_ - n);
+      if (int8) {
+        for (int m = n; m < n + batch; ++m) {
+          this->forward_cpu_gemm_int8(bottom_data + m * this->bottom_dim_,
+              &int8_gemm_, top_data + m * this->top_dim_);
+        }
+      } else if (grouped) {
+        for (int m = n; m < n + batch; ++m) {
+          forward_cpu_grouped(bottom_data + m * this->bottom_dim_, weight,
+              top_data + m * this->top_dim_);
+        }
+      } else if (this->col_batch_ > 1) {
+        this->forward_cpu_gemm_batch(bottom_data + n * this->bottom_dim_,
+            weight, top_data + n * this->top_dim_, batch);
+      } else {
+        this->forward_cpu_gemm(bottom_data + n * this->bottom_dim_, weight,
+            top_data + n * this->top_dim_);
+      }
+      // Epilogue of the fused layers, while the output is still in cache
+      for (int m = n; fused && m < n + batch; ++m) {
+        forward_cpu_bias_relu(top_data + m * this->top_dim_, bias);
+      }
+    }
+    if (bias && !fused) {
+      for (int n = 0; n < this->num_; ++n) {
         this->forward_cpu_bias(top_data + n * this->top_dim_, bias);
       }
     }
@@ -55,7 +271,16 @@ void ConvolutionLayer<Dtype>::Backward_cpu(const vector<Blob<Dtype>*>& top,
         this->backward_cpu_bias(bias_diff, top_diff + n * this->top_dim_);
       }
     }
-    if (this->param_propagate_down_[0] || propagate_down[i]) {
+    if (this->col_batch_ > 1
+        && (this->param_propagate_down_[0] || propagate_down[i])) {
+      for (int n = 0; n < this->num_; n += this->col_batch_) {
+        this->backward_cpu_gemm_batch(bottom_data + n * this->bottom_dim_,
+            top_diff + n * this->top_dim_, weight,
+            this->param_propagate_down_[0] ? weight_diff : NULL,
+            propagate_down[i] ? bottom_diff + n * this->bottom_dim_ : NULL,
+            std::min(this->col_batch_, this->num_ - n));
+      }
+    } else if (this->param_propagate_down_[0] || propagate_down[i]) {
       for (int n = 0; n < this->num_; ++n) {
         // gradient w.r.t. weight. Note that we will accumulate diffs.
         if (this->param_propagate_down_[0]) {
@@ -4,21 +4,49 @@
 
 namespace caffe {
 
+template <typename Dtype>
+__global__ void BiasReLUForward(const int n, const Dtype* bias,
+    const int channels, const int spatial_dim, const Dtype negative_slope,
+    Dtype* out) {
+  CUDA_KERNEL_LOOP(index, n) {
+    const Dtype value =
+        out[index] + (bias ? bias[(index / spatial_dim) % channels] : 0);
+    out[index] = value > 0 ? value : negative_slope * value;
+  }
+}
+
 template <typename Dtype>
 void ConvolutionLayer<Dtype>::Forward_gpu(const vector<Blob<Dtype>*>& bottom,
       const vector<Blob<Dtype>*>& top) {
   const Dtype* weight = this->blobs_[0]->gpu_data();
+  const Dtype* bias = this->bias_term_ ? this->blobs_[1]->gpu_data() : NULL;
+  const bool fused = fused_batch_norm_ || fused_scale_ || fused_relu_;
+  if (fused_batch_norm_ || fused_scale_) {
+    FoldFusedLayers();
+    weight = fused_weights_.gpu_data();
+    bias = fused_bias_.gpu_data();
+  }
   for (int i = 0; i < bottom.size(); ++i) {
     const Dtype* bottom_data = bottom[i]->gpu_data();
     Dtype* top_data = top[i]->mutable_gpu_data();
     for (int n = 0; n < this->num_; ++n) {
       this->forward_gpu_gemm(bottom_data + n * this->bottom_dim_, weight,
           top_data + n * this->top_dim_);
-      if (this->bias_term_) {
-        const Dtype* bias = this->blobs_[1]->gpu_data();
+      if (bias && !fused) {
         this->forward_gpu_bias(top_data + n * this->top_dim_, bias);
       }
     }
+    if (fused) {
+      // Without ReLU the slope is 1, only adding the bias
+      const Dtype negative_slope = fused_relu_ ?
+          fused_relu_->layer_param().relu_param().negative_slope() : Dtype(1);
+      const int count = top[i]->count();
+      // NOLINT_NEXT_LINE(whitespace/operators)
+      BiasReLUForward<Dtype><<<CAFFE_GET_BLOCKS(count),
+          CAFFE_CUDA_NUM_THREADS>>>(count, bias, this->num_output_,
+          this->out_spatial_dim_, negative_slope, top_data);
+      CUDA_POST_KERNEL_CHECK;
+    }
   }
 }
 
@@ -86,42 +86,44 @@ void DataLayer<Dtype>::load_batch(Batch<Dtype>* batch) {
   double trans_time = 0;
   CPUTimer timer;
   CHECK(batch->data_.count());
-  CHECK(this->transformed_data_.count());
   const int batch_size = this->layer_param_.data_param().batch_size();
 
-  Datum datum;
+  // Read the whole batch first, so the next prefetch worker can move on to
+  // the next batch while this one is transformed
+  vector<Datum> datums(batch_size);
   for (int item_id = 0; item_id < batch_size; ++item_id) {
     timer.Start();
     while (Skip()) {
       Next();
     }
-    datum.ParseFromString(cursor_->value());
+    datums[item_id].ParseFromString(cursor_->value());
     read_time += timer.MicroSeconds();
+    Next();
+  }
+  this->EndOrderedRead();
 
-    if (item_id == 0) {
-      // Reshape according to the first datum of each batch
-      // on single input batches allows for inputs of varying dimension.
-      // Use data_transformer to infer the expected blob shape from datum.
-      vector<int> top_shape = this->data_transformer_->InferBlobShape(datum);
-      this->transformed_data_.Reshape(top_shape);
-      // Reshape batch according to the batch_size.
-      top_shape[0] = batch_size;
-      batch->data_.Reshape(top_shape);
-    }
-
+  DataTransformer<Dtype>* data_transformer = this->prefetch_transformer();
+  // Reshape according to the first datum of each batch
+  // on single input batches allows for inputs of varying dimension.
+  // Use data_transformer to infer the expected blob shape from datum.
+  vector<int> top_shape = data_transformer->InferBlobShape(datums[0]);
+  Blob<Dtype> transformed_data(top_shape);
+  // Reshape batch according to the batch_size.
+  top_shape[0] = batch_size;
+  batch->data_.Reshape(top_shape);
+  Dtype* top_data = batch->data_.mutable_cpu_data();
+  for (int item_id = 0; item_id < batch_size; ++item_id) {
     // Apply data transformations (mirror, scale, crop...)
     timer.Start();
     int offset = batch->data_.offset(item_id);
-    Dtype* top_data = batch->data_.mutable_cpu_data();
-    this->transformed_data_.set_cpu_data(top_data + offset);
-    this->data_transformer_->Transform(datum, &(this->transformed_data_));
+    transformed_data.set_cpu_data(top_data + offset);
+    data_transformer->Transform(datums[item_id], &transformed_data);
     // Copy label.
     if (this->output_labels_) {
       Dtype* top_label = batch->label_.mutable_cpu_data();
-      top_label[item_id] = datum.label();
+      top_label[item_id] = datums[item_id].label();
     }
     trans_time += timer.MicroSeconds();
-    Next();
   }
   timer.Stop();
   batch_timer.Stop();
@@ -0,0 +1,163 @@
+#include <algorithm>
+#include <vector>
+
+#include "caffe/layers/direct_conv_layer.hpp"
+#include "caffe/util/math_functions.hpp"
+
+namespace caffe {
+
+template <typename Dtype>
+const int DirectConvolutionLayer<Dtype>::kBlock;
+template <typename Dtype>
+const int DirectConvolutionLayer<Dtype>::kTileWidth;
+
+template <typename Dtype>
+void DirectConvolutionLayer<Dtype>::LayerSetUp(
+    const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top) {
+  ConvolutionLayer<Dtype>::LayerSetUp(bottom, top);
+  use_direct_ = this->num_spatial_axes_ == 2 && !this->force_nd_im2col_;
+  LOG_IF(INFO, !use_direct_) << "Layer " << this->layer_param_.name()
+      << ": the direct convolution needs 2D filters, using im2col.";
+}
+
+template <typename Dtype>
+void DirectConvolutionLayer<Dtype>::Reshape(
+    const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top) {
+  ConvolutionLayer<Dtype>::Reshape(bottom, top);
+  if (!use_direct_ || this->use_int8()) {
+    return;
+  }
+  const int* kernel_shape = this->kernel_shape_.cpu_data();
+  const int group_outputs = this->num_output_ / this->group_;
+  vector<int> shape(4);
+  shape[0] = this->group_ * ((group_outputs + kBlock - 1) / kBlock);
+  shape[1] = this->channels_ / this->group_;
+  shape[2] = kernel_shape[0] * kernel_shape[1];
+  shape[3] = kBlock;
+  filters_.Reshape(shape);
+  shape.resize(3);
+  shape[0] = this->channels_;
+  shape[1] = this->input_shape(1) + 2 * this->pad_.cpu_data()[0];
+  shape[2] = this->input_shape(2) + 2 * this->pad_.cpu_data()[1];
+  padded_input_.Reshape(shape);
+}
+
+template <typename Dtype>
+void DirectConvolutionLayer<Dtype>::BlockFilters() {
+  const Blob<Dtype>& weights = *this->blobs_[0];
+  if (weights.data()->version() == weights_version_) {
+    return;
+  }
+  weights_version_ = weights.data()->version();
+  const int group_outputs = this->num_output_ / this->group_;
+  const int group_blocks = filters_.shape(0) / this->group_;
+  const int filter_dim = filters_.count(1, 3);
+  const Dtype* weight = weights.cpu_data();
+  Dtype* filters = filters_.mutable_cpu_data();
+  caffe_set(filters_.count(), Dtype(0), filters);
+  for (int g = 0; g < this->group_; ++g) {
+    for (int k = 0; k < group_outputs; ++k) {
+      Dtype* block = filters + (g * group_blocks + k / kBlock) * filter_dim
+          * kBlock + k % kBlock;
+      const Dtype* filter = weight + (g * group_outputs + k) * filter_dim;
+      for (int i = 0; i < filter_dim; ++i) {
+        block[i * kBlock] = filter[i];
+      }
+    }
+  }
+}
+
+template <typename Dtype>
+void DirectConvolutionLayer<Dtype>::Forward_cpu(
+    const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top) {
+  if (!use_direct_ || this->use_int8()) {
+    ConvolutionLayer<Dtype>::Forward_cpu(bottom, top);
+    return;
+  }
+  BlockFilters();
+  const int kernel_h = this->kernel_shape_.cpu_data()[0];
+  const int kernel_w = this->kernel_shape_.cpu_data()[1];
+  const int stride_h = this->stride_.cpu_data()[0];
+  const int stride_w = this->stride_.cpu_data()[1];
+  const int dilation_h = this->dilation_.cpu_data()[0];
+  const int dilation_w = this->dilation_.cpu_data()[1];
+  const int pad_h = this->pad_.cpu_data()[0];
+  const int pad_w = this->pad_.cpu_data()[1];
+  const int height = this->input_shape(1);
+  const int width = this->input_shape(2);
+  const int padded_h = padded_input_.shape(1);
+  const int padded_w = padded_input_.shape(2);
+  const int output_h = this->output_shape_[0];
+  const int output_w = this->output_shape_[1];
+  const int output_dim = output_h * output_w;
+  const int group_channels = this->channels_ / this->group_;
+  const int group_outputs = this->num_output_ / this->group_;
+  const int group_blocks = filters_.shape(0) / this->group_;
+  const int filter_dim = filters_.count(1, 3);
+  const Dtype* filters = filters_.cpu_data();
+  const Dtype* bias = this->bias_term_ ? this->blobs_[1]->cpu_data() : NULL;
+  Dtype* padded = padded_input_.mutable_cpu_data();
+  // The padding stays zero
+  caffe_set(padded_input_.count(), Dtype(0), padded);
+  for (int i = 0; i < bottom.size(); ++i) {
+    const Dtype* bottom_data = bottom[i]->cpu_data();
+    Dtype* top_data = top[i]->mutable_cpu_data();
+    for (int n = 0; n < this->num_; ++n) {
+      const Dtype* input = bottom_data + n * this->bottom_dim_;
+      Dtype* output = top_data + n * this->top_dim_;
+      for (int c = 0; c < this->channels_; ++c) {
+        for (int h = 0; h < height; ++h) {
+          caffe_copy(width, input + (c * height + h) * width,
+              padded + (c * padded_h + pad_h + h) * padded_w + pad_w);
+        }
+      }
+      for (int g = 0; g < this->group_; ++g) {
+        const Dtype* group_input =
+            padded + g * group_channels * padded_h * padded_w;
+        for (int b = 0; b < group_blocks; ++b) {
+          const Dtype* block_filters =
+              filters + (g * group_blocks + b) * filter_dim * kBlock;
+          const int first_output = g * group_outputs + b * kBlock;
+          const int block_outputs =
+              std::min(kBlock, group_outputs - b * kBlock);
+          for (int oh = 0; oh < output_h; ++oh) {
+            for (int ow = 0; ow < output_w; ow += kTileWidth) {
+              const int tile_width = std::min(kTileWidth, output_w - ow);
+              Dtype sum[kTileWidth][kBlock] = {};
+              const Dtype* filter = block_filters;
+              for (int c = 0; c < group_channels; ++c) {
+                for (int kh = 0; kh < kernel_h; ++kh) {
+                  const Dtype* row = group_input
+                      + (c * padded_h + oh * stride_h + kh * dilation_h)
+                      * padded_w + ow * stride_w;
+                  for (int kw = 0; kw < kernel_w; ++kw, filter += kBlock) {
+                    const Dtype* x = row + kw * dilation_w;
+                    for (int t = 0; t < tile_width; ++t) {
+                      const Dtype value = x[t * stride_w];
+                      for (int v = 0; v < kBlock; ++v) {
+                        sum[t][v] += value * filter[v];
+                      }
+                    }
+                  }
+                }
+              }
+              for (int v = 0; v < block_outputs; ++v) {
+                const Dtype bias_value =
+                    bias ? bias[first_output + v] : Dtype(0);
+                Dtype* out = output + (first_output + v) * output_dim
+                    + oh * output_w + ow;
+                for (int t = 0; t < tile_width; ++t) {
+                  out[t] = sum[t][v] + bias_value;
+                }
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+INSTANTIATE_CLASS(DirectConvolutionLayer);
+
+}  // namespace caffe
@@ -59,9 +59,17 @@ void EltwiseLayer<Dtype>::Forward_cpu(
     }
     break;
   case EltwiseParameter_EltwiseOp_SUM:
-    caffe_set(count, Dtype(0), top_data);
-    // TODO(shelhamer) does BLAS optimize to sum for coeff = 1?
-    for (int i = 0; i < bottom.size(); ++i) {
+    if (top[0] == bottom[0]) {
+      // In place (optimize_in_place): the top already holds bottom 0
+      if (coeffs_[0] != Dtype(1)) {
+        caffe_scal(count, coeffs_[0], top_data);
+      }
+    } else {
+      caffe_set(count, Dtype(0), top_data);
+      // TODO(shelhamer) does BLAS optimize to sum for coeff = 1?
+      caffe_axpy(count, coeffs_[0], bottom[0]->cpu_data(), top_data);
+    }
+    for (int i = 1; i < bottom.size(); ++i) {
       caffe_axpy(count, coeffs_[i], bottom[i]->cpu_data(), top_data);
     }
     break;
@@ -73,6 +81,7 @@ void EltwiseLayer<Dtype>::Forward_cpu(
     // bottom 0 & 1
     bottom_data_a = bottom[0]->cpu_data();
     bottom_data_b = bottom[1]->cpu_data();
+    CAFFE_PARALLEL_FOR(count)
     for (int idx = 0; idx < count; ++idx) {
       if (bottom_data_a[idx] > bottom_data_b[idx]) {
         top_data[idx] = bottom_data_a[idx];  // maxval
@@ -85,6 +94,7 @@ void EltwiseLayer<Dtype>::Forward_cpu(
     // bottom 2++
     for (int blob_idx = 2; blob_idx < bottom.size(); ++blob_idx) {
       bottom_data_b = bottom[blob_idx]->cpu_data();
+      CAFFE_PARALLEL_FOR(count)
       for (int idx = 0; idx < count; ++idx) {
         if (bottom_data_b[idx] > top_data[idx]) {
           top_data[idx] = bottom_data_b[idx];  // maxval
@@ -105,7 +115,8 @@ void EltwiseLayer<Dtype>::Backward_cpu(const vector<Blob<Dtype>*>& top,
   const int count = top[0]->count();
   const Dtype* top_data = top[0]->cpu_data();
   const Dtype* top_diff = top[0]->cpu_diff();
-  for (int i = 0; i < bottom.size(); ++i) {
+  // Last bottom first: in place, the diff of bottom 0 is the top diff
+  for (int i = bottom.size() - 1; i >= 0; --i) {
     if (propagate_down[i]) {
       const Dtype* bottom_data = bottom[i]->cpu_data();
       Dtype* bottom_diff = bottom[i]->mutable_cpu_diff();
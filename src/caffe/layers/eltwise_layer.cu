@@ -45,9 +45,17 @@ void EltwiseLayer<Dtype>::Forward_gpu(const vector<Blob<Dtype>*>& bottom,
     }
     break;
   case EltwiseParameter_EltwiseOp_SUM:
-    caffe_gpu_set(count, Dtype(0.), top_data);
-    // TODO(shelhamer) does cuBLAS optimize to sum for coeff = 1?
-    for (int i = 0; i < bottom.size(); ++i) {
+    if (top[0] == bottom[0]) {
+      // In place (optimize_in_place): the top already holds bottom 0
+      if (coeffs_[0] != Dtype(1.)) {
+        caffe_gpu_scal(count, coeffs_[0], top_data);
+      }
+    } else {
+      caffe_gpu_set(count, Dtype(0.), top_data);
+      // TODO(shelhamer) does cuBLAS optimize to sum for coeff = 1?
+      caffe_gpu_axpy(count, coeffs_[0], bottom[0]->gpu_data(), top_data);
+    }
+    for (int i = 1; i < bottom.size(); ++i) {
       caffe_gpu_axpy(count, coeffs_[i], bottom[i]->gpu_data(), top_data);
     }
     break;
@@ -86,7 +94,8 @@ void EltwiseLayer<Dtype>::Backward_gpu(const vector<Blob<Dtype>*>& top,
   const int count = top[0]->count();
   const Dtype* top_data = top[0]->gpu_data();
   const Dtype* top_diff = top[0]->gpu_diff();
-  for (int i = 0; i < bottom.size(); ++i) {
+  // Last bottom first: in place, the diff of bottom 0 is the top diff
+  for (int i = bottom.size() - 1; i >= 0; --i) {
     if (propagate_down[i]) {
       const Dtype* bottom_data = bottom[i]->gpu_data();
       Dtype* bottom_diff = bottom[i]->mutable_gpu_diff();
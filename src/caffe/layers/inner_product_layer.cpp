@@ -80,15 +80,38 @@ void InnerProductLayer<Dtype>::Reshape(const vector<Blob<Dtype>*>& bottom,
   }
 }
 
+template <typename Dtype>
+bool InnerProductLayer<Dtype>::use_int8() {
+  return this->phase_ == TEST && this->layer_param_.has_quantization_param();
+}
+
+template <typename Dtype>
+void InnerProductLayer<Dtype>::QuantizeWeights() {
+  if (!use_int8()) {
+    return;
+  }
+  int8_gemm_.SetInputRange(this->layer_param_.quantization_param());
+  int8_gemm_.QuantizeWeights(N_, K_, this->blobs_[0]->cpu_data(),
+      this->blobs_[0]->data()->version(), transpose_);
+}
+
 template <typename Dtype>
 void InnerProductLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
     const vector<Blob<Dtype>*>& top) {
   const Dtype* bottom_data = bottom[0]->cpu_data();
   Dtype* top_data = top[0]->mutable_cpu_data();
   const Dtype* weight = this->blobs_[0]->cpu_data();
-  caffe_cpu_gemm<Dtype>(CblasNoTrans, transpose_ ? CblasNoTrans : CblasTrans,
-      M_, N_, K_, (Dtype)1.,
-      bottom_data, weight, (Dtype)0., top_data);
+  if (use_int8()) {
+    // The N_ x M_ products of the weights with the rows of the input, written
+    // transposed
+    QuantizeWeights();
+    const uint8_t* input = int8_gemm_.QuantizeInput(M_ * K_, bottom_data);
+    int8_gemm_.Forward(CblasTrans, 0, N_, M_, input, top_data, 1, N_);
+  } else {
+    caffe_cpu_gemm<Dtype>(CblasNoTrans, transpose_ ? CblasNoTrans : CblasTrans,
+        M_, N_, K_, (Dtype)1.,
+        bottom_data, weight, (Dtype)0., top_data);
+  }
   if (bias_term_) {
     caffe_cpu_gemm<Dtype>(CblasNoTrans, CblasNoTrans, M_, N_, 1, (Dtype)1.,
         bias_multiplier_.cpu_data(),
@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <cmath>
 #include <vector>
 
 #include "caffe/layers/lrn_layer.hpp"
@@ -110,45 +112,62 @@ void LRNLayer<Dtype>::CrossChannelForward_cpu(
   const Dtype* bottom_data = bottom[0]->cpu_data();
   Dtype* top_data = top[0]->mutable_cpu_data();
   Dtype* scale_data = scale_.mutable_cpu_data();
-  // start with the constant value
-  for (int i = 0; i < scale_.count(); ++i) {
-    scale_data[i] = k_;
-  }
-  Blob<Dtype> padded_square(1, channels_ + size_ - 1, height_, width_);
-  Dtype* padded_square_data = padded_square.mutable_cpu_data();
-  caffe_set(padded_square.count(), Dtype(0), padded_square_data);
+  const int spatial_dim = height_ * width_;
   Dtype alpha_over_size = alpha_ / size_;
-  // go through the images
-  for (int n = 0; n < num_; ++n) {
-    // compute the padded square
-    caffe_sqr(channels_ * height_ * width_,
-        bottom_data + bottom[0]->offset(n),
-        padded_square_data + padded_square.offset(0, pre_pad_));
-    // Create the first channel scale
-    for (int c = 0; c < size_; ++c) {
-      caffe_axpy<Dtype>(height_ * width_, alpha_over_size,
-          padded_square_data + padded_square.offset(0, c),
-          scale_data + scale_.offset(n, 0));
+  // go through the rows of the images, which are independent: the window of
+  // channel c spans channels c - pre_pad_ to c - pre_pad_ + size_ - 1, the
+  // channels outside of the image being zero
+  CAFFE_PARALLEL_FOR(scale_.count())
+  for (int nh = 0; nh < num_ * height_; ++nh) {
+    const int offset = scale_.offset(nh / height_, 0, nh % height_);
+    const Dtype* bottom_row = bottom_data + offset;
+    Dtype* scale_row = scale_data + offset;
+    Dtype* top_row = top_data + offset;
+    // Create the first channel scale, starting with the constant value
+    for (int w = 0; w < width_; ++w) {
+      scale_row[w] = k_;
+    }
+    for (int c = std::max(0, -pre_pad_);
+         c < std::min(channels_, size_ - pre_pad_); ++c) {
+      const Dtype* x = bottom_row + c * spatial_dim;
+      for (int w = 0; w < width_; ++w) {
+        scale_row[w] += alpha_over_size * (x[w] * x[w]);
+      }
     }
     for (int c = 1; c < channels_; ++c) {
       // copy previous scale
-      caffe_copy<Dtype>(height_ * width_,
-          scale_data + scale_.offset(n, c - 1),
-          scale_data + scale_.offset(n, c));
+      const Dtype* previous = scale_row + (c - 1) * spatial_dim;
+      Dtype* scale = scale_row + c * spatial_dim;
+      for (int w = 0; w < width_; ++w) {
+        scale[w] = previous[w];
+      }
       // add head
-      caffe_axpy<Dtype>(height_ * width_, alpha_over_size,
-          padded_square_data + padded_square.offset(0, c + size_ - 1),
-          scale_data + scale_.offset(n, c));
+      const int head = c - pre_pad_ + size_ - 1;
+      if (head < channels_) {
+        const Dtype* x = bottom_row + head * spatial_dim;
+        for (int w = 0; w < width_; ++w) {
+          scale[w] += alpha_over_size * (x[w] * x[w]);
+        }
+      }
       // subtract tail
-      caffe_axpy<Dtype>(height_ * width_, -alpha_over_size,
-          padded_square_data + padded_square.offset(0, c - 1),
-          scale_data + scale_.offset(n, c));
+      const int tail = c - 1 - pre_pad_;
+      if (tail >= 0) {
+        const Dtype* x = bottom_row + tail * spatial_dim;
+        for (int w = 0; w < width_; ++w) {
+          scale[w] -= alpha_over_size * (x[w] * x[w]);
+        }
+      }
+    }
+    // In the end, compute output
+    for (int c = 0; c < channels_; ++c) {
+      const int channel_offset = c * spatial_dim;
+      for (int w = 0; w < width_; ++w) {
+        top_row[channel_offset + w] =
+            std::pow(scale_row[channel_offset + w], -beta_)
+            * bottom_row[channel_offset + w];
+      }
     }
   }
-
-  // In the end, compute output
-  caffe_powx<Dtype>(scale_.count(), scale_data, -beta_, top_data);
-  caffe_mul<Dtype>(scale_.count(), top_data, bottom_data, top_data);
 }
 
 template <typename Dtype>
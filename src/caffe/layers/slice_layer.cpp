@@ -81,9 +81,34 @@ void SliceLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
   int offset_slice_axis = 0;
   const Dtype* bottom_data = bottom[0]->cpu_data();
   const int bottom_slice_axis = bottom[0]->shape(slice_axis_);
+  // Tops viewing the bottom (see Net::PlanActivationMemory) are in place. A
+  // reshape since the plan may have left the others inside the bottom, which
+  // is then read from a copy.
+  const Dtype* bottom_end = bottom_data + bottom[0]->count();
+  vector<bool> in_place(top.size());
+  vector<Dtype> bottom_copy;
+  for (int i = 0; i < top.size(); ++i) {
+    const Dtype* top_data = top[i]->cpu_data();
+    in_place[i] = num_slices_ == 1
+        && top_data == bottom_data + offset_slice_axis * slice_size_;
+    const Dtype* top_end = top_data + top[i]->count();
+    if (!in_place[i] && top_data < bottom_end && top_end > bottom_data
+        && bottom_copy.empty()) {
+      bottom_copy.assign(bottom_data, bottom_end);
+    }
+    offset_slice_axis += top[i]->shape(slice_axis_);
+  }
+  if (!bottom_copy.empty()) {
+    bottom_data = bottom_copy.data();
+  }
+  offset_slice_axis = 0;
   for (int i = 0; i < top.size(); ++i) {
-    Dtype* top_data = top[i]->mutable_cpu_data();
     const int top_slice_axis = top[i]->shape(slice_axis_);
+    if (in_place[i]) {
+      offset_slice_axis += top_slice_axis;
+      continue;
+    }
+    Dtype* top_data = top[i]->mutable_cpu_data();
     for (int n = 0; n < num_slices_; ++n) {
       const int top_offset = n * top_slice_axis * slice_size_;
       const int bottom_offset =
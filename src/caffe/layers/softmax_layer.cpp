@@ -2,6 +2,7 @@
 #include <vector>
 
 #include "caffe/layers/softmax_layer.hpp"
+#include "caffe/util/fast_math.hpp"
 #include "caffe/util/math_functions.hpp"
 
 namespace caffe {
@@ -31,30 +32,49 @@ void SoftmaxLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
   Dtype* scale_data = scale_.mutable_cpu_data();
   int channels = bottom[0]->shape(softmax_axis_);
   int dim = bottom[0]->count() / outer_num_;
-  caffe_copy(bottom[0]->count(), bottom_data, top_data);
   // We need to subtract the max to avoid numerical issues, compute the exp,
-  // and then normalize.
-  for (int i = 0; i < outer_num_; ++i) {
+  // and then normalize. Blocks of inner positions are independent.
+  const int block_size = 256;
+  const int blocks = (inner_num_ + block_size - 1) / block_size;
+  CAFFE_PARALLEL_FOR(bottom[0]->count())
+  for (int b = 0; b < outer_num_ * blocks; ++b) {
+    const int i = b / blocks;
+    const int begin = (b % blocks) * block_size;
+    const int end = std::min(inner_num_, begin + block_size);
+    const Dtype* bottom_block = bottom_data + i * dim;
+    Dtype* top_block = top_data + i * dim;
+    Dtype* scale_block = scale_data + i * inner_num_;
     // initialize scale_data to the first plane
-    caffe_copy(inner_num_, bottom_data + i * dim, scale_data);
+    for (int k = begin; k < end; ++k) {
+      scale_block[k] = bottom_block[k];
+    }
     for (int j = 0; j < channels; j++) {
-      for (int k = 0; k < inner_num_; k++) {
-        scale_data[k] = std::max(scale_data[k],
-            bottom_data[i * dim + j * inner_num_ + k]);
+      for (int k = begin; k < end; k++) {
+        scale_block[k] = std::max(scale_block[k],
+            bottom_block[j * inner_num_ + k]);
+      }
+    }
+    // subtraction and exponentiation
+    for (int j = 0; j < channels; j++) {
+      for (int k = begin; k < end; k++) {
+        top_block[j * inner_num_ + k] =
+            fast_exp(bottom_block[j * inner_num_ + k] - scale_block[k]);
       }
     }
-    // subtraction
-    caffe_cpu_gemm<Dtype>(CblasNoTrans, CblasNoTrans, channels, inner_num_,
-        1, -1., sum_multiplier_.cpu_data(), scale_data, 1., top_data);
-    // exponentiation
-    caffe_exp<Dtype>(dim, top_data, top_data);
     // sum after exp
-    caffe_cpu_gemv<Dtype>(CblasTrans, channels, inner_num_, 1.,
-        top_data, sum_multiplier_.cpu_data(), 0., scale_data);
+    for (int k = begin; k < end; ++k) {
+      scale_block[k] = 0;
+    }
+    for (int j = 0; j < channels; j++) {
+      for (int k = begin; k < end; k++) {
+        scale_block[k] += top_block[j * inner_num_ + k];
+      }
+    }
     // division
     for (int j = 0; j < channels; j++) {
-      caffe_div(inner_num_, top_data, scale_data, top_data);
-      top_data += inner_num_;
+      for (int k = begin; k < end; k++) {
+        top_block[j * inner_num_ + k] /= scale_block[k];
+      }
     }
   }
 }
@@ -0,0 +1,240 @@
+#include <algorithm>
+#include <vector>
+
+#include "caffe/layers/winograd_conv_layer.hpp"
+#include "caffe/util/math_functions.hpp"
+
+namespace caffe {
+
+namespace {
+
+// Transform matrices of F(2x2, 3x3): input B^T (4 x 4), filter G (4 x 3) and
+// output A^T (2 x 4)
+const double kInputTransform2[] = {
+  1,  0, -1,  0,
+  0,  1,  1,  0,
+  0, -1,  1,  0,
+  0,  1,  0, -1};
+const double kFilterTransform2[] = {
+  1,    0,   0,
+  0.5,  0.5, 0.5,
+  0.5, -0.5, 0.5,
+  0,    0,   1};
+const double kOutputTransform2[] = {
+  1, 1,  1,  0,
+  0, 1, -1, -1};
+
+// Transform matrices of F(4x4, 3x3): input B^T (6 x 6), filter G (6 x 3) and
+// output A^T (4 x 6)
+const double kInputTransform4[] = {
+  4,  0, -5,  0, 1, 0,
+  0, -4, -4,  1, 1, 0,
+  0,  4, -4, -1, 1, 0,
+  0, -2, -1,  2, 1, 0,
+  0,  2, -1, -2, 1, 0,
+  0,  4,  0, -5, 0, 1};
+const double kFilterTransform4[] = {
+  1. / 4,   0,        0,
+  -1. / 6,  -1. / 6,  -1. / 6,
+  -1. / 6,  1. / 6,   -1. / 6,
+  1. / 24,  1. / 12,  1. / 6,
+  1. / 24,  -1. / 12, 1. / 6,
+  0,        0,        1};
+const double kOutputTransform4[] = {
+  1, 1,  1, 1,  1, 0,
+  0, 1, -1, 2, -2, 0,
+  0, 1,  1, 4,  4, 0,
+  0, 1, -1, 8, -8, 1};
+
+// Computes left * in * right^T, left being rows x n, in n x n2 and right
+// cols x n2
+template <typename Dtype>
+inline void Transform(const double* left, const Dtype* in,
+    const double* right, const int rows, const int n, const int n2,
+    const int cols, Dtype* out) {
+  Dtype tmp[6 * 6];
+  for (int i = 0; i < rows; ++i) {
+    for (int j = 0; j < n2; ++j) {
+      Dtype sum = 0;
+      for (int r = 0; r < n; ++r) {
+        sum += left[i * n + r] * in[r * n2 + j];
+      }
+      tmp[i * n2 + j] = sum;
+    }
+  }
+  for (int i = 0; i < rows; ++i) {
+    for (int j = 0; j < cols; ++j) {
+      Dtype sum = 0;
+      for (int s = 0; s < n2; ++s) {
+        sum += tmp[i * n2 + s] * right[j * n2 + s];
+      }
+      out[i * cols + j] = sum;
+    }
+  }
+}
+
+}  // namespace
+
+template <typename Dtype>
+void WinogradConvolutionLayer<Dtype>::LayerSetUp(
+    const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top) {
+  ConvolutionLayer<Dtype>::LayerSetUp(bottom, top);
+  tile_ = this->layer_param_.convolution_param().winograd_tile();
+  CHECK(tile_ == 2 || tile_ == 4) << "winograd_tile must be 2 or 4.";
+  alpha_ = tile_ + 2;
+  use_winograd_ = this->num_spatial_axes_ == 2 && !this->force_nd_im2col_;
+  for (int i = 0; i < this->num_spatial_axes_ && use_winograd_; ++i) {
+    use_winograd_ = this->kernel_shape_.cpu_data()[i] == 3
+        && this->stride_.cpu_data()[i] == 1
+        && this->dilation_.cpu_data()[i] == 1;
+  }
+  LOG_IF(INFO, !use_winograd_) << "Layer " << this->layer_param_.name()
+      << ": Winograd needs 2D 3x3 filters with stride 1 and no dilation, "
+      << "using im2col.";
+}
+
+template <typename Dtype>
+void WinogradConvolutionLayer<Dtype>::Reshape(
+    const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top) {
+  ConvolutionLayer<Dtype>::Reshape(bottom, top);
+  if (!use_winograd_ || this->use_int8()) {
+    return;
+  }
+  tiles_h_ = (this->output_shape_[0] + tile_ - 1) / tile_;
+  tiles_w_ = (this->output_shape_[1] + tile_ - 1) / tile_;
+  vector<int> shape(3);
+  shape[0] = alpha_ * alpha_;
+  shape[1] = this->num_output_;
+  shape[2] = this->channels_ / this->group_;
+  filters_.Reshape(shape);
+  shape[1] = this->channels_;
+  shape[2] = tiles_h_ * tiles_w_;
+  input_tiles_.Reshape(shape);
+  shape[1] = this->num_output_;
+  output_tiles_.Reshape(shape);
+}
+
+template <typename Dtype>
+void WinogradConvolutionLayer<Dtype>::TransformFilters() {
+  const Blob<Dtype>& weights = *this->blobs_[0];
+  if (weights.data()->version() == weights_version_) {
+    return;
+  }
+  weights_version_ = weights.data()->version();
+  const double* filter_transform =
+      (tile_ == 2) ? kFilterTransform2 : kFilterTransform4;
+  const int num_output = this->num_output_;
+  const int channels = this->channels_ / this->group_;
+  const int tile_size = alpha_ * alpha_;
+  const Dtype* weight = weights.cpu_data();
+  Dtype* filters = filters_.mutable_cpu_data();
+  Dtype transformed[6 * 6];
+  for (int k = 0; k < num_output; ++k) {
+    for (int c = 0; c < channels; ++c) {
+      Transform(filter_transform, weight + (k * channels + c) * 9,
+          filter_transform, alpha_, 3, 3, alpha_, transformed);
+      for (int e = 0; e < tile_size; ++e) {
+        filters[(e * num_output + k) * channels + c] = transformed[e];
+      }
+    }
+  }
+}
+
+template <typename Dtype>
+void WinogradConvolutionLayer<Dtype>::Forward_cpu(
+    const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top) {
+  if (!use_winograd_ || this->use_int8()) {
+    ConvolutionLayer<Dtype>::Forward_cpu(bottom, top);
+    return;
+  }
+  TransformFilters();
+  const double* input_transform =
+      (tile_ == 2) ? kInputTransform2 : kInputTransform4;
+  const double* output_transform =
+      (tile_ == 2) ? kOutputTransform2 : kOutputTransform4;
+  const int height = this->input_shape(1);
+  const int width = this->input_shape(2);
+  const int pad_h = this->pad_.cpu_data()[0];
+  const int pad_w = this->pad_.cpu_data()[1];
+  const int output_h = this->output_shape_[0];
+  const int output_w = this->output_shape_[1];
+  const int channels = this->channels_;
+  const int num_output = this->num_output_;
+  const int group_channels = channels / this->group_;
+  const int group_outputs = num_output / this->group_;
+  const int tiles = tiles_h_ * tiles_w_;
+  const int tile_size = alpha_ * alpha_;
+  const Dtype* filters = filters_.cpu_data();
+  Dtype* input_tiles = input_tiles_.mutable_cpu_data();
+  Dtype* output_tiles = output_tiles_.mutable_cpu_data();
+  Dtype in[6 * 6];
+  Dtype transformed[6 * 6];
+  for (int i = 0; i < bottom.size(); ++i) {
+    const Dtype* bottom_data = bottom[i]->cpu_data();
+    Dtype* top_data = top[i]->mutable_cpu_data();
+    for (int n = 0; n < this->num_; ++n) {
+      const Dtype* input = bottom_data + n * this->bottom_dim_;
+      Dtype* output = top_data + n * this->top_dim_;
+      // Input tiles, overlapping by 2, zero outside of the image
+      for (int c = 0; c < channels; ++c) {
+        const Dtype* channel = input + c * height * width;
+        for (int t = 0; t < tiles; ++t) {
+          const int y0 = (t / tiles_w_) * tile_ - pad_h;
+          const int x0 = (t % tiles_w_) * tile_ - pad_w;
+          for (int y = 0; y < alpha_; ++y) {
+            for (int x = 0; x < alpha_; ++x) {
+              const bool inside = y0 + y >= 0 && y0 + y < height
+                  && x0 + x >= 0 && x0 + x < width;
+              in[y * alpha_ + x] =
+                  inside ? channel[(y0 + y) * width + x0 + x] : Dtype(0);
+            }
+          }
+          Transform(input_transform, in, input_transform, alpha_, alpha_,
+              alpha_, alpha_, transformed);
+          for (int e = 0; e < tile_size; ++e) {
+            input_tiles[(e * channels + c) * tiles + t] = transformed[e];
+          }
+        }
+      }
+      // One GEMM per tile element and group
+      for (int e = 0; e < tile_size; ++e) {
+        for (int g = 0; g < this->group_; ++g) {
+          caffe_cpu_gemm<Dtype>(CblasNoTrans, CblasNoTrans, group_outputs,
+              tiles, group_channels, (Dtype)1.,
+              filters + (e * num_output + g * group_outputs) * group_channels,
+              input_tiles + (e * channels + g * group_channels) * tiles,
+              (Dtype)0.,
+              output_tiles + (e * num_output + g * group_outputs) * tiles);
+        }
+      }
+      // Output tiles, cropped to the output
+      for (int k = 0; k < num_output; ++k) {
+        Dtype* output_channel = output + k * output_h * output_w;
+        for (int t = 0; t < tiles; ++t) {
+          for (int e = 0; e < tile_size; ++e) {
+            in[e] = output_tiles[(e * num_output + k) * tiles + t];
+          }
+          Transform(output_transform, in, output_transform, tile_, alpha_,
+              alpha_, tile_, transformed);
+          const int y0 = (t / tiles_w_) * tile_;
+          const int x0 = (t % tiles_w_) * tile_;
+          const int rows = std::min(tile_, output_h - y0);
+          const int cols = std::min(tile_, output_w - x0);
+          for (int y = 0; y < rows; ++y) {
+            for (int x = 0; x < cols; ++x) {
+              output_channel[(y0 + y) * output_w + x0 + x] =
+                  transformed[y * tile_ + x];
+            }
+          }
+        }
+      }
+      if (this->bias_term_) {
+        this->forward_cpu_bias(output, this->blobs_[1]->cpu_data());
+      }
+    }
+  }
+}
+
+INSTANTIATE_CLASS(WinogradConvolutionLayer);
+
+}  // namespace caffe
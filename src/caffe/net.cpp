@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <functional>
 #include <map>
 #include <set>
 #include <string>
@@ -9,6 +10,10 @@
 
 #include "caffe/common.hpp"
 #include "caffe/layer.hpp"
+#include "caffe/layers/concat_layer.hpp"
+#include "caffe/layers/conv_layer.hpp"
+#include "caffe/layers/inner_product_layer.hpp"
+#include "caffe/layers/slice_layer.hpp"
 #include "caffe/net.hpp"
 #include "caffe/parallel.hpp"
 #include "caffe/proto/caffe.pb.h"
@@ -26,7 +31,8 @@ Net<Dtype>::Net(const NetParameter& param) {
 
 template <typename Dtype>
 Net<Dtype>::Net(const string& param_file, Phase phase,
-    const int level, const vector<string>* stages) {
+    const int level, const vector<string>* stages,
+    const bool inference_only) {
   NetParameter param;
   ReadNetParamsFromTextFileOrDie(param_file, &param);
   // Set phase, stages and level
@@ -37,6 +43,9 @@ Net<Dtype>::Net(const string& param_file, Phase phase,
     }
   }
   param.mutable_state()->set_level(level);
+  if (inference_only) {
+    param.set_inference_only(true);
+  }
   Init(param);
 }
 
@@ -44,6 +53,12 @@ template <typename Dtype>
 void Net<Dtype>::Init(const NetParameter& in_param) {
   // Set phase from the state.
   phase_ = in_param.state().phase();
+  inference_only_ = in_param.inference_only();
+  if (inference_only_) {
+    CHECK_EQ(phase_, TEST) << "inference_only requires the TEST phase";
+    LOG_IF(WARNING, in_param.force_backward() && Caffe::root_solver())
+        << "force_backward ignored by the inference_only net";
+  }
   // Filter layers based on their include/exclude rules and
   // the current NetState.
   NetParameter filtered_param;
@@ -58,6 +73,8 @@ void Net<Dtype>::Init(const NetParameter& in_param) {
   name_ = param.name();
   map<string, int> blob_name_to_idx;
   set<string> available_blobs;
+  // Tops renamed by optimize_in_place, and the blob computing them
+  map<string, string> in_place_aliases;
   memory_used_ = 0;
   // For each layer, set up its input and output
   bottom_vecs_.resize(param.layer_size());
@@ -83,6 +100,9 @@ void Net<Dtype>::Init(const NetParameter& in_param) {
     layer_names_.push_back(layer_param.name());
     LOG_IF(INFO, Caffe::root_solver())
         << "Creating Layer " << layer_param.name();
+    if (param.optimize_in_place()) {
+      PlanInPlace(layer_id, blob_name_to_idx, &param, &in_place_aliases);
+    }
     bool need_backward = false;
 
     // Figure out this layer's input and output
@@ -144,7 +164,8 @@ void Net<Dtype>::Init(const NetParameter& in_param) {
     for (int param_id = 0; param_id < num_param_blobs; ++param_id) {
       const ParamSpec* param_spec = (param_id < param_size) ?
           &layer_param.param(param_id) : &default_param_spec;
-      const bool param_need_backward = param_spec->lr_mult() != 0;
+      const bool param_need_backward =
+          !inference_only_ && param_spec->lr_mult() != 0;
       need_backward |= param_need_backward;
       layers_[layer_id]->set_param_propagate_down(param_id,
                                                   param_need_backward);
@@ -160,6 +181,78 @@ void Net<Dtype>::Init(const NetParameter& in_param) {
       }
     }
   }
+  MarkBackwardUnderLoss();
+  // Handle force_backward if needed.
+  if (param.force_backward() && !inference_only_) {
+    for (int layer_id = 0; layer_id < layers_.size(); ++layer_id) {
+      layer_need_backward_[layer_id] = true;
+      for (int bottom_id = 0;
+           bottom_id < bottom_need_backward_[layer_id].size(); ++bottom_id) {
+        bottom_need_backward_[layer_id][bottom_id] =
+            bottom_need_backward_[layer_id][bottom_id] ||
+            layers_[layer_id]->AllowForceBackward(bottom_id);
+        blob_need_backward_[bottom_id_vecs_[layer_id][bottom_id]] =
+            blob_need_backward_[bottom_id_vecs_[layer_id][bottom_id]] ||
+            bottom_need_backward_[layer_id][bottom_id];
+      }
+      for (int param_id = 0; param_id < layers_[layer_id]->blobs().size();
+           ++param_id) {
+        layers_[layer_id]->set_param_propagate_down(param_id, true);
+      }
+    }
+  }
+  // In the end, all remaining blobs are considered output blobs.
+  for (set<string>::iterator it = available_blobs.begin();
+      it != available_blobs.end(); ++it) {
+    LOG_IF(INFO, Caffe::root_solver())
+        << "This network produces output " << *it;
+    net_output_blobs_.push_back(blobs_[blob_name_to_idx[*it]].get());
+    net_output_blob_indices_.push_back(blob_name_to_idx[*it]);
+  }
+  for (size_t blob_id = 0; blob_id < blob_names_.size(); ++blob_id) {
+    blob_names_index_[blob_names_[blob_id]] = blob_id;
+  }
+  for (map<string, string>::const_iterator it = in_place_aliases.begin();
+       it != in_place_aliases.end(); ++it) {
+    blob_names_index_[it->first] = blob_names_index_[it->second];
+  }
+  for (size_t layer_id = 0; layer_id < layer_names_.size(); ++layer_id) {
+    layer_names_index_[layer_names_[layer_id]] = layer_id;
+  }
+  ShareWeights();
+  FuseInferenceLayers(param);
+  debug_info_ = param.debug_info();
+  optimize_activation_memory_ = param.optimize_activation_memory();
+  if (optimize_activation_memory_ && (phase_ != TEST || BackwardNeeded())) {
+    LOG_IF(WARNING, Caffe::root_solver())
+        << "optimize_activation_memory ignored: Backward needs every "
+        << "activation, it only applies to TEST nets without backward.";
+    optimize_activation_memory_ = false;
+  }
+  PlanActivationMemory();
+  LOG_IF(INFO, Caffe::root_solver()) << "Network initialization done.";
+}
+
+template <typename Dtype>
+bool Net<Dtype>::BackwardNeeded() const {
+  if (inference_only_) {
+    return false;
+  }
+  // force_backward set every entry
+  for (int layer_id = 0; layer_id < layers_.size(); ++layer_id) {
+    if (layer_need_backward_[layer_id]) {
+      return true;
+    }
+  }
+  return false;
+}
+
+template <typename Dtype>
+void Net<Dtype>::MarkBackwardUnderLoss() {
+  // Forward-only nets need no backward bookkeeping (nothing needs backward)
+  if (inference_only_) {
+    return;
+  }
   // Go through the net backwards to determine which blobs contribute to the
   // loss.  We can skip backward computation for blobs that don't contribute
   // to the loss.
@@ -217,42 +310,301 @@ void Net<Dtype>::Init(const NetParameter& in_param) {
       }
     }
   }
-  // Handle force_backward if needed.
-  if (param.force_backward()) {
-    for (int layer_id = 0; layer_id < layers_.size(); ++layer_id) {
-      layer_need_backward_[layer_id] = true;
-      for (int bottom_id = 0;
-           bottom_id < bottom_need_backward_[layer_id].size(); ++bottom_id) {
-        bottom_need_backward_[layer_id][bottom_id] =
-            bottom_need_backward_[layer_id][bottom_id] ||
-            layers_[layer_id]->AllowForceBackward(bottom_id);
-        blob_need_backward_[bottom_id_vecs_[layer_id][bottom_id]] =
-            blob_need_backward_[bottom_id_vecs_[layer_id][bottom_id]] ||
-            bottom_need_backward_[layer_id][bottom_id];
+}
+
+template <typename Dtype>
+void Net<Dtype>::FuseInferenceLayers(const NetParameter& param) {
+  layer_fused_.assign(layers_.size(), false);
+  if (!param.fuse_inference_layers()) {
+    return;
+  }
+  if (phase_ != TEST || BackwardNeeded()) {
+    LOG_IF(WARNING, Caffe::root_solver())
+        << "fuse_inference_layers ignored: the fused layers have no Backward, "
+        << "it only applies to TEST nets without backward.";
+    return;
+  }
+  for (int layer_id = 0; layer_id < layers_.size(); ++layer_id) {
+    ConvolutionLayer<Dtype>* conv =
+        dynamic_cast<ConvolutionLayer<Dtype>*>(layers_[layer_id].get());
+    if (!conv || top_id_vecs_[layer_id].size() != 1) {
+      continue;
+    }
+    const int blob_id = top_id_vecs_[layer_id][0];
+    const int channels = blobs_[blob_id]->shape(1);
+    // BatchNorm, Scale and ReLU, in this order, each in place on the output
+    Layer<Dtype>* fused[3] = {NULL, NULL, NULL};
+    int stage = 0;
+    int next_id = layer_id + 1;
+    for (; next_id < layers_.size(); ++next_id) {
+      if (bottom_id_vecs_[next_id].size() != 1
+          || top_id_vecs_[next_id].size() != 1
+          || bottom_id_vecs_[next_id][0] != blob_id
+          || top_id_vecs_[next_id][0] != blob_id) {
+        break;
       }
-      for (int param_id = 0; param_id < layers_[layer_id]->blobs().size();
-           ++param_id) {
-        layers_[layer_id]->set_param_propagate_down(param_id, true);
+      Layer<Dtype>* layer = layers_[next_id].get();
+      const LayerParameter& layer_param = layer->layer_param();
+      const string type = layer->type();
+      if (stage <= 0 && type == "BatchNorm"
+          && (!layer_param.batch_norm_param().has_use_global_stats()
+              || layer_param.batch_norm_param().use_global_stats())) {
+        stage = 1;
+      } else if (stage <= 1 && type == "Scale"
+          && layer_param.scale_param().axis() == 1
+          && layer->blobs()[0]->count() == channels) {
+        stage = 2;
+      } else if (stage <= 2 && type == "ReLU") {
+        stage = 3;
+      } else {
+        break;
       }
+      fused[stage - 1] = layer;
+    }
+    if (next_id == layer_id + 1
+        || !conv->FuseInference(fused[0], fused[1], fused[2])) {
+      continue;
+    }
+    for (int fused_id = layer_id + 1; fused_id < next_id; ++fused_id) {
+      layer_fused_[fused_id] = true;
+      LOG_IF(INFO, Caffe::root_solver()) << layer_names_[fused_id]
+          << " fused into " << layer_names_[layer_id];
     }
+    layer_id = next_id - 1;
   }
-  // In the end, all remaining blobs are considered output blobs.
-  for (set<string>::iterator it = available_blobs.begin();
-      it != available_blobs.end(); ++it) {
-    LOG_IF(INFO, Caffe::root_solver())
-        << "This network produces output " << *it;
-    net_output_blobs_.push_back(blobs_[blob_name_to_idx[*it]].get());
-    net_output_blob_indices_.push_back(blob_name_to_idx[*it]);
+}
+
+template <typename Dtype>
+void Net<Dtype>::PlanActivationMemory() {
+  if (!optimize_activation_memory_) {
+    return;
   }
-  for (size_t blob_id = 0; blob_id < blob_names_.size(); ++blob_id) {
-    blob_names_index_[blob_names_[blob_id]] = blob_id;
+  // The host copies of a GPU net would overwrite each other
+  if (Caffe::mode() != Caffe::CPU) {
+    LOG_IF(WARNING, Caffe::root_solver())
+        << "optimize_activation_memory ignored: it requires CPU mode.";
+    return;
   }
-  for (size_t layer_id = 0; layer_id < layer_names_.size(); ++layer_id) {
-    layer_names_index_[layer_names_[layer_id]] = layer_id;
+  // Blobs sharing their data share a SyncedMemory (e.g. reshape tops), or
+  // will share it once Forward runs (ForwardSharesBottomData), so lifetimes
+  // are computed per group of SyncedMemory (union-find).
+  vector<SyncedMemory*> memories;
+  vector<int> parents;
+  map<SyncedMemory*, int> memory_ids;
+  vector<vector<int> > layer_memory_ids(layers_.size());
+  for (int layer_id = 0; layer_id < layers_.size(); ++layer_id) {
+    for (int i = 0; i < top_id_vecs_[layer_id].size(); ++i) {
+      const Blob<Dtype>& blob = *blobs_[top_id_vecs_[layer_id][i]];
+      int memory_id = -1;
+      if (blob.count() > 0) {
+        SyncedMemory* memory = blob.data().get();
+        map<SyncedMemory*, int>::iterator it = memory_ids.find(memory);
+        if (it == memory_ids.end()) {
+          it = memory_ids.insert(std::make_pair(
+              memory, static_cast<int>(memories.size()))).first;
+          memories.push_back(memory);
+          parents.push_back(it->second);
+        }
+        memory_id = it->second;
+      }
+      layer_memory_ids[layer_id].push_back(memory_id);
+    }
   }
-  ShareWeights();
-  debug_info_ = param.debug_info();
-  LOG_IF(INFO, Caffe::root_solver()) << "Network initialization done.";
+  for (int layer_id = 0; layer_id < layers_.size(); ++layer_id) {
+    if (!layers_[layer_id]->ForwardSharesBottomData()
+        || bottom_vecs_[layer_id].empty()
+        || bottom_vecs_[layer_id][0]->count() == 0) {
+      continue;
+    }
+    int bottom_root = memory_ids[bottom_vecs_[layer_id][0]->data().get()];
+    while (parents[bottom_root] != bottom_root) {
+      bottom_root = parents[bottom_root];
+    }
+    for (int i = 0; i < layer_memory_ids[layer_id].size(); ++i) {
+      int top_root = layer_memory_ids[layer_id][i];
+      if (top_root < 0) {
+        continue;
+      }
+      while (parents[top_root] != top_root) {
+        top_root = parents[top_root];
+      }
+      parents[top_root] = bottom_root;
+    }
+  }
+  struct Group {
+    int first;
+    int last;
+    bool pinned;
+    size_t size;
+    size_t offset;
+  };
+  vector<Group> groups(memories.size());
+  vector<int> memory_groups(memories.size());
+  for (int i = 0; i < memories.size(); ++i) {
+    int root = i;
+    while (parents[root] != root) {
+      root = parents[root];
+    }
+    memory_groups[i] = root;
+    Group group = {static_cast<int>(layers_.size()), -1, false, 0, 0};
+    groups[i] = group;
+  }
+  set<int> output_ids(net_output_blob_indices_.begin(),
+                      net_output_blob_indices_.end());
+  for (int layer_id = 0; layer_id < layers_.size(); ++layer_id) {
+    for (int is_top = 0; is_top < 2; ++is_top) {
+      const vector<int>& blob_ids =
+          (is_top ? top_id_vecs_[layer_id] : bottom_id_vecs_[layer_id]);
+      for (int i = 0; i < blob_ids.size(); ++i) {
+        Blob<Dtype>& blob = *blobs_[blob_ids[i]];
+        if (blob.count() == 0) {
+          continue;
+        }
+        const int memory_id = memory_ids[blob.data().get()];
+        Group& group = groups[memory_groups[memory_id]];
+        group.first = std::min(group.first, layer_id);
+        group.last = std::max(group.last, layer_id);
+        group.size = std::max(group.size, memories[memory_id]->size());
+        // Written outside of Forward (inputs) or read after it (outputs)
+        group.pinned = group.pinned || output_ids.count(blob_ids[i]) ||
+            (is_top && bottom_id_vecs_[layer_id].empty());
+      }
+    }
+  }
+  // A Concat with a single concatenation (or a Slice with a single slice)
+  // needs no copy when its bottoms are views of its top (its tops views of its
+  // bottom): the group of each part joins the group of the combined blob, at
+  // the offset of the part. The parts must fit their slot, and nothing may
+  // write the blobs in place afterwards, as the parts would see it.
+  vector<size_t> memory_offsets(memories.size(), 0);
+  int views = 0;
+  for (int layer_id = 0; layer_id < layers_.size(); ++layer_id) {
+    const Layer<Dtype>* layer = layers_[layer_id].get();
+    const ConcatLayer<Dtype>* concat =
+        dynamic_cast<const ConcatLayer<Dtype>*>(layer);
+    const SliceLayer<Dtype>* slice =
+        dynamic_cast<const SliceLayer<Dtype>*>(layer);
+    if (!(concat && concat->num_concats() == 1)
+        && !(slice && slice->num_slices() == 1)) {
+      continue;
+    }
+    const Blob<Dtype>* combined =
+        concat ? top_vecs_[layer_id][0] : bottom_vecs_[layer_id][0];
+    const vector<Blob<Dtype>*>& parts =
+        concat ? bottom_vecs_[layer_id] : top_vecs_[layer_id];
+    bool viewable = parts.size() > 1 && combined->count() > 0;
+    for (int i = 0; i < parts.size() && viewable; ++i) {
+      viewable = parts[i]->count() > 0;
+    }
+    if (!viewable) {
+      continue;
+    }
+    const int combined_id = memory_ids[combined->data().get()];
+    const int combined_group = memory_groups[combined_id];
+    viewable = !groups[combined_group].pinned;
+    set<int> part_groups;
+    size_t offset = memory_offsets[combined_id];
+    vector<size_t> part_offsets;
+    for (int i = 0; i < parts.size() && viewable; ++i) {
+      const size_t size = parts[i]->count() * sizeof(Dtype);
+      const int part_id = memory_ids[parts[i]->data().get()];
+      const int part_group = memory_groups[part_id];
+      viewable = part_group != combined_group
+          && part_groups.insert(part_group).second
+          && !groups[part_group].pinned && memory_offsets[part_id] == 0;
+      for (int j = 0; j < memories.size() && viewable; ++j) {
+        viewable = memory_groups[j] != part_group
+            || memory_offsets[j] + memories[j]->size() <= size;
+      }
+      part_offsets.push_back(offset);
+      offset += size;
+    }
+    part_groups.insert(combined_group);
+    for (int i = layer_id + 1; i < layers_.size() && viewable; ++i) {
+      for (int j = 0; j < top_vecs_[i].size() && viewable; ++j) {
+        const Blob<Dtype>* top = top_vecs_[i][j];
+        if (top->count() > 0 && std::find(bottom_vecs_[i].begin(),
+            bottom_vecs_[i].end(), top) != bottom_vecs_[i].end()) {
+          const int top_id = memory_ids[top->data().get()];
+          viewable = !part_groups.count(memory_groups[top_id]);
+        }
+      }
+    }
+    if (!viewable) {
+      continue;
+    }
+    Group& group = groups[combined_group];
+    for (int i = 0; i < parts.size(); ++i) {
+      const int part_group = memory_groups[memory_ids[parts[i]->data().get()]];
+      group.first = std::min(group.first, groups[part_group].first);
+      group.last = std::max(group.last, groups[part_group].last);
+      for (int j = 0; j < memories.size(); ++j) {
+        if (memory_groups[j] == part_group) {
+          memory_groups[j] = combined_group;
+          memory_offsets[j] += part_offsets[i];
+        }
+      }
+    }
+    ++views;
+  }
+  // Largest groups first, each one at the lowest offset that does not
+  // overlap any placed group alive at the same time.
+  const size_t kAlignment = 64;
+  vector<pair<size_t, int> > order;
+  size_t unplanned_size = 0;
+  for (int i = 0; i < memories.size(); ++i) {
+    unplanned_size += memories[i]->size();
+    if (memory_groups[i] == i && !groups[i].pinned && groups[i].size > 0) {
+      order.push_back(std::make_pair(groups[i].size, i));
+    }
+  }
+  std::stable_sort(order.begin(), order.end(),
+                   std::greater<pair<size_t, int> >());
+  vector<int> placed;
+  size_t arena_size = 0;
+  for (int i = 0; i < order.size(); ++i) {
+    Group& group = groups[order[i].second];
+    const size_t size =
+        (group.size + kAlignment - 1) / kAlignment * kAlignment;
+    vector<pair<size_t, size_t> > used;
+    for (int j = 0; j < placed.size(); ++j) {
+      const Group& other = groups[placed[j]];
+      if (other.first <= group.last && group.first <= other.last) {
+        used.push_back(std::make_pair(other.offset,
+                                      other.offset + other.size));
+      }
+    }
+    std::sort(used.begin(), used.end());
+    size_t offset = 0;
+    for (int j = 0; j < used.size(); ++j) {
+      if (offset + size <= used[j].first) {
+        break;
+      }
+      offset = std::max(offset,
+          (used[j].second + kAlignment - 1) / kAlignment * kAlignment);
+    }
+    group.offset = offset;
+    arena_size = std::max(arena_size, offset + size);
+    placed.push_back(order[i].second);
+  }
+  if (arena_size == 0) {
+    return;
+  }
+  // The previous arena (if any) is released once no blob points to it
+  shared_ptr<SyncedMemory> activation_memory(new SyncedMemory(arena_size));
+  char* arena = static_cast<char*>(activation_memory->mutable_cpu_data());
+  for (int i = 0; i < memories.size(); ++i) {
+    const Group& group = groups[memory_groups[i]];
+    if (!group.pinned) {
+      memories[i]->set_cpu_data(arena + group.offset + memory_offsets[i]);
+    }
+  }
+  activation_memory_ = activation_memory;
+  LOG_IF(INFO, Caffe::root_solver())
+      << "Activation memory: " << arena_size << " bytes shared by "
+      << placed.size() << " blob groups (" << unplanned_size
+      << " bytes without sharing), " << views
+      << " Concat and Slice layers without copies";
 }
 
 template <typename Dtype>
@@ -380,6 +732,7 @@ void Net<Dtype>::AppendTop(const NetParameter& param, const int layer_id,
       LOG(INFO) << layer_param->name() << " -> " << blob_name;
     }
     shared_ptr<Blob<Dtype> > blob_pointer(new Blob<Dtype>());
+    blob_pointer->set_lazy_diff(inference_only_);
     const int blob_id = blobs_.size();
     blobs_.push_back(blob_pointer);
     blob_names_.push_back(blob_name);
@@ -417,6 +770,88 @@ int Net<Dtype>::AppendBottom(const NetParameter& param, const int layer_id,
   return blob_id;
 }
 
+// The top can be renamed like the bottom when the bottom is only used by this
+// layer, and the layer producing it (the last one, if computed in place)
+// neither shares its memory with its own bottoms nor reads it in Backward.
+// Inputs and data layer tops keep their values, as the net outputs keep their
+// names.
+template <typename Dtype>
+void Net<Dtype>::PlanInPlace(const int layer_id,
+    const map<string, int>& blob_name_to_idx, NetParameter* param,
+    map<string, string>* aliases) {
+  LayerParameter* layer_param = param->mutable_layer(layer_id);
+  if (!layers_[layer_id]->AllowInPlace() || layer_param->bottom_size() == 0
+      || layer_param->top_size() != 1 || layer_param->loss_weight_size() > 0
+      || layer_param->propagate_down_size() > 0) {
+    return;
+  }
+  const string bottom_name = layer_param->bottom(0);
+  const string top_name = layer_param->top(0);
+  map<string, int>::const_iterator blob_it =
+      blob_name_to_idx.find(bottom_name);
+  if (top_name == bottom_name || blob_it == blob_name_to_idx.end()) {
+    return;
+  }
+  const int blob_id = blob_it->second;
+  int producer_id = layer_id - 1;
+  while (producer_id >= 0 && std::find(top_id_vecs_[producer_id].begin(),
+      top_id_vecs_[producer_id].end(), blob_id)
+      == top_id_vecs_[producer_id].end()) {
+    --producer_id;
+  }
+  if (producer_id < 0 || bottom_vecs_[producer_id].empty()) {
+    return;
+  }
+  int bottom_uses = 0;
+  int top_uses = 0;
+  int top_writes = 0;
+  for (int i = producer_id + 1; i < param->layer_size(); ++i) {
+    const LayerParameter& other = param->layer(i);
+    for (int j = 0; j < other.bottom_size(); ++j) {
+      bottom_uses += (other.bottom(j) == bottom_name);
+      top_uses += (i > layer_id && other.bottom(j) == top_name);
+    }
+    for (int j = 0; j < other.top_size(); ++j) {
+      top_writes += (i > layer_id && other.top(j) == top_name);
+    }
+  }
+  // Later layers may only write the top in place, i.e. read it first
+  if (bottom_uses != 1 || top_uses == 0 || top_writes > top_uses) {
+    return;
+  }
+  const Layer<Dtype>& producer = *layers_[producer_id];
+  if (producer.ForwardSharesBottomData()) {
+    return;
+  }
+  const Blob<Dtype>& blob = *blobs_[blob_id];
+  for (int i = 0; i < bottom_vecs_[producer_id].size(); ++i) {
+    const Blob<Dtype>& producer_bottom = *bottom_vecs_[producer_id][i];
+    if (&producer_bottom != &blob && blob.count() > 0
+        && producer_bottom.count() > 0
+        && blob.data() == producer_bottom.data()) {
+      return;
+    }
+  }
+  const bool producer_backward = !inference_only_
+      && (layer_need_backward_[producer_id] || param->force_backward());
+  if (producer_backward && producer.BackwardUsesTopData()) {
+    return;
+  }
+  layer_param->set_top(0, bottom_name);
+  for (int i = layer_id + 1; i < param->layer_size(); ++i) {
+    LayerParameter* other = param->mutable_layer(i);
+    for (int j = 0; j < other->bottom_size(); ++j) {
+      if (other->bottom(j) == top_name) { other->set_bottom(j, bottom_name); }
+    }
+    for (int j = 0; j < other->top_size(); ++j) {
+      if (other->top(j) == top_name) { other->set_top(j, bottom_name); }
+    }
+  }
+  (*aliases)[top_name] = bottom_name;
+  LOG_IF(INFO, Caffe::root_solver()) << layer_param->name()
+      << ": computing " << top_name << " in place in " << bottom_name;
+}
+
 template <typename Dtype>
 void Net<Dtype>::AppendParam(const NetParameter& param, const int layer_id,
                              const int param_id) {
@@ -518,6 +953,10 @@ Dtype Net<Dtype>::ForwardFromTo(int start, int end) {
   CHECK_LT(end, layers_.size());
   Dtype loss = 0;
   for (int i = start; i <= end; ++i) {
+    // Computed by a previous layer
+    if (layer_fused_[i]) {
+      continue;
+    }
     for (int c = 0; c < before_forward_.size(); ++c) {
       before_forward_[c]->run(i);
     }
@@ -565,6 +1004,7 @@ const vector<Blob<Dtype>*>& Net<Dtype>::Forward(
 
 template <typename Dtype>
 void Net<Dtype>::BackwardFromTo(int start, int end) {
+  CHECK(!inference_only_) << "Backward called on an inference_only net";
   CHECK_GE(end, 0);
   CHECK_LT(start, layers_.size());
   for (int i = start; i >= end; --i) {
@@ -727,6 +1167,7 @@ void Net<Dtype>::Reshape() {
   for (int i = 0; i < layers_.size(); ++i) {
     layers_[i]->Reshape(bottom_vecs_[i], top_vecs_[i]);
   }
+  PlanActivationMemory();
 }
 
 template <typename Dtype>
@@ -765,6 +1206,7 @@ void Net<Dtype>::CopyTrainedLayersFrom(const NetParameter& param) {
       target_blobs[j]->FromProto(source_layer.blobs(j), kReshape);
     }
   }
+  QuantizeLayers();
 }
 
 template <typename Dtype>
@@ -832,6 +1274,28 @@ void Net<Dtype>::CopyTrainedLayersFromHDF5(const string trained_filename) {
   }
   H5Gclose(data_hid);
   H5Fclose(file_hid);
+  QuantizeLayers();
+}
+
+template <typename Dtype>
+void Net<Dtype>::QuantizeLayers() {
+  for (int layer_id = 0; layer_id < layers_.size(); ++layer_id) {
+    Layer<Dtype>* layer = layers_[layer_id].get();
+    if (!layer->layer_param().has_quantization_param()) {
+      continue;
+    }
+    if (ConvolutionLayer<Dtype>* conv =
+        dynamic_cast<ConvolutionLayer<Dtype>*>(layer)) {
+      conv->QuantizeWeights();
+    } else if (InnerProductLayer<Dtype>* inner_product =
+        dynamic_cast<InnerProductLayer<Dtype>*>(layer)) {
+      inner_product->QuantizeWeights();
+    } else {
+      LOG_IF(WARNING, Caffe::root_solver())
+          << "Layer " << layer_names_[layer_id] << " of type "
+          << layer->type() << " ignores quantization_param.";
+    }
+  }
 }
 
 template <typename Dtype>
@@ -936,7 +1400,9 @@ void Net<Dtype>::ShareWeights() {
   for (int i = 0; i < params_.size(); ++i) {
     if (param_owners_[i] < 0) { continue; }
     params_[i]->ShareData(*params_[param_owners_[i]]);
-    params_[i]->ShareDiff(*params_[param_owners_[i]]);
+    if (!inference_only_) {
+      params_[i]->ShareDiff(*params_[param_owners_[i]]);
+    }
   }
 }
 
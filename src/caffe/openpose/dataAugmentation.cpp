@@ -367,29 +367,6 @@ namespace caffe {
         }
     }
 
-    void keepRoiInside(cv::Rect& roi, const cv::Size& imageSize)
-    {
-        // x,y < 0
-        if (roi.x < 0)
-        {
-            roi.width += roi.x;
-            roi.x = 0;
-        }
-        if (roi.y < 0)
-        {
-            roi.height += roi.y;
-            roi.y = 0;
-        }
-        // Bigger than image
-        if (roi.width + roi.x >= imageSize.width)
-            roi.width = imageSize.width - 1 - roi.x;
-        if (roi.height + roi.y >= imageSize.height)
-            roi.height = imageSize.height - 1 - roi.y;
-        // Width/height negative
-        roi.width = std::max(0, roi.width);
-        roi.height = std::max(0, roi.height);
-    }
-
     void clahe(cv::Mat& bgrImage, const int tileSize, const int clipLimit)
     {
         cv::Mat labImage;
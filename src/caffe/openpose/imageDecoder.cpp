@@ -0,0 +1,178 @@
+#ifdef USE_OPENCV
+#include <opencv2/opencv.hpp>
+#include <caffe/openpose/imageDecoder.hpp>
+
+namespace caffe {
+    // Private functions
+    std::string getDecodingKey(const std::string& path, const int flags, const int reduction)
+    {
+        return path + "|" + std::to_string(flags) + "|" + std::to_string(reduction);
+    }
+
+    // Public functions
+    ImageDecoder::ImageDecoder(const int numberThreads, const int cacheSize) :
+        mCacheSize{cacheSize},
+        mStop{false},
+        mHits{0ull},
+        mMisses{0ull}
+    {
+        for (auto i = 0 ; i < numberThreads ; i++)
+            mThreads.emplace_back(&ImageDecoder::threadLoop, this);
+    }
+
+    ImageDecoder::~ImageDecoder()
+    {
+        {
+            std::unique_lock<std::mutex> lock{mMutex};
+            mStop = true;
+        }
+        mConditionVariable.notify_all();
+        for (auto& thread : mThreads)
+            thread.join();
+    }
+
+    void ImageDecoder::prefetch(const std::string& path, const int flags, const int reduction)
+    {
+        if (mThreads.empty())
+            return;
+        const auto key = getDecodingKey(path, flags, reduction);
+        {
+            std::unique_lock<std::mutex> lock{mMutex};
+            if (mCacheIndex.count(key) > 0 || mPending.count(key) > 0)
+                return;
+            auto task = std::make_shared<std::packaged_task<cv::Mat()>>(
+                [path, flags, reduction]{ return imreadReduced(path, flags, reduction); });
+            mPending.emplace(key, task->get_future().share());
+            mTasks.emplace_back([task]{ (*task)(); });
+        }
+        mConditionVariable.notify_one();
+    }
+
+    cv::Mat ImageDecoder::get(const std::string& path, const int flags, const int reduction)
+    {
+        const auto key = getDecodingKey(path, flags, reduction);
+        std::shared_future<cv::Mat> pending;
+        std::packaged_task<cv::Mat()> task;
+        {
+            std::unique_lock<std::mutex> lock{mMutex};
+            // Cached
+            const auto cacheIterator = mCacheIndex.find(key);
+            if (cacheIterator != mCacheIndex.end())
+            {
+                mHits++;
+                mCache.splice(mCache.begin(), mCache, cacheIterator->second);
+                return cacheIterator->second->second;
+            }
+            // Being decoded
+            const auto pendingIterator = mPending.find(key);
+            if (pendingIterator != mPending.end())
+            {
+                mHits++;
+                pending = pendingIterator->second;
+            }
+            // Decoded here, registered so that other calls wait for it rather than decoding it again
+            else
+            {
+                mMisses++;
+                task = std::packaged_task<cv::Mat()>{
+                    [path, flags, reduction]{ return imreadReduced(path, flags, reduction); }};
+                pending = task.get_future().share();
+                mPending.emplace(key, pending);
+            }
+        }
+        if (task.valid())
+            task();
+        const auto image = pending.get();
+        {
+            std::unique_lock<std::mutex> lock{mMutex};
+            if (!image.empty())
+                addToCache(key, image);
+            // Only erased once decoded (and cached)
+            mPending.erase(key);
+        }
+        return image;
+    }
+
+    void ImageDecoder::clearPending()
+    {
+        std::unique_lock<std::mutex> lock{mMutex};
+        // The decodings already queued still run, but their images are released as soon as they end
+        mPending.clear();
+    }
+
+    unsigned long long ImageDecoder::getHits() const
+    {
+        std::unique_lock<std::mutex> lock{mMutex};
+        return mHits;
+    }
+
+    unsigned long long ImageDecoder::getMisses() const
+    {
+        std::unique_lock<std::mutex> lock{mMutex};
+        return mMisses;
+    }
+
+    void ImageDecoder::threadLoop()
+    {
+        while (true)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock{mMutex};
+                mConditionVariable.wait(lock, [this]{ return mStop || !mTasks.empty(); });
+                if (mStop)
+                    return;
+                task = std::move(mTasks.front());
+                mTasks.pop_front();
+            }
+            task();
+        }
+    }
+
+    void ImageDecoder::addToCache(const std::string& key, const cv::Mat& image)
+    {
+        if (mCacheSize < 1 || mCacheIndex.count(key) > 0)
+            return;
+        mCache.emplace_front(key, image);
+        mCacheIndex[key] = mCache.begin();
+        if ((int)mCache.size() > mCacheSize)
+        {
+            mCacheIndex.erase(mCache.back().first);
+            mCache.pop_back();
+        }
+    }
+
+    cv::Mat imreadReduced(const std::string& path, const int flags, const int reduction)
+    {
+        if (reduction < 2)
+            return cv::imread(path, flags);
+#if CV_MAJOR_VERSION > 3 || (CV_MAJOR_VERSION == 3 && CV_MINOR_VERSION >= 2)
+        // libjpeg scales the DCT coefficients directly (x2-x6 faster than a full decoding)
+        if (flags == cv::IMREAD_COLOR || flags == cv::IMREAD_GRAYSCALE)
+        {
+            const auto reducedFlag = (reduction == 2 ? cv::IMREAD_REDUCED_GRAYSCALE_2
+                                   : (reduction == 4 ? cv::IMREAD_REDUCED_GRAYSCALE_4
+                                   : cv::IMREAD_REDUCED_GRAYSCALE_8));
+            return cv::imread(path, reducedFlag | flags);
+        }
+#endif
+        // Other image types (or old OpenCV versions): full decoding + resize
+        cv::Mat image = cv::imread(path, flags);
+        if (!image.empty())
+        {
+            const cv::Size reducedSize{(image.cols + reduction - 1) / reduction,
+                                       (image.rows + reduction - 1) / reduction};
+            cv::resize(image, image, reducedSize, 0, 0, cv::INTER_AREA);
+        }
+        return image;
+    }
+
+    int getDecodeReduction(const float maxScale)
+    {
+        for (const auto reduction : {8, 4, 2})
+            if (reduction * maxScale <= 1.f)
+                return reduction;
+        return 1;
+    }
+}  // namespace caffe
+#endif  // USE_OPENCV
@@ -0,0 +1,639 @@
+#ifdef USE_OPENCV
+#include <algorithm> // std::fill, std::max, std::min
+#include <cmath> // std::exp, std::isfinite, std::isnan, std::sqrt
+#include <opencv2/core/core.hpp>
+#include <caffe/openpose/labelRenderer.hpp>
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    // AVX2/AVX-512 functions are compiled with target attributes and only called if the CPU supports them
+    #define LABEL_RENDERER_X86
+    #include <immintrin.h>
+#endif
+
+namespace caffe {
+    // Private functions
+    float getNorm(const cv::Point2f& pointA, const cv::Point2f& pointB)
+    {
+        const auto difference = pointA - pointB;
+        return std::sqrt(difference.x*difference.x + difference.y*difference.y);
+    }
+
+    // Original implementations (ground truth)
+    template<typename Dtype>
+    void putGaussianMapsReference(Dtype* entry, const cv::Point2f& centerPoint, const int stride, const int gridX,
+                                  const int gridY, const float sigma)
+    {
+        const Dtype start = stride/2.f - 0.5f; //0 if stride = 1, 0.5 if stride = 2, 1.5 if stride = 4, ...
+        const auto multiplier = 2.0 * sigma * sigma;
+        for (auto gY = 0; gY < gridY; gY++)
+        {
+            const auto yOffset = gY*gridX;
+            const Dtype y = start + gY * stride;
+            const auto yMenosCenterPointSquared = (y-centerPoint.y)*(y-centerPoint.y);
+            for (auto gX = 0; gX < gridX; gX++)
+            {
+                const Dtype x = start + gX * stride;
+                const Dtype d2 = (x-centerPoint.x)*(x-centerPoint.x) + yMenosCenterPointSquared;
+                const Dtype exponent = d2 / multiplier;
+                //ln(100) = -ln(1%)
+                if (exponent <= 4.6052)
+                {
+                    const auto xyOffset = yOffset + gX;
+                    entry[xyOffset] = std::min(Dtype(1), std::max(entry[xyOffset], std::exp(-exponent)));
+                }
+            }
+        }
+    }
+
+    template<typename Dtype>
+    void putVectorMapsReference(Dtype* entryX, Dtype* entryY, Dtype* count, const cv::Point2f& centerA,
+                                const cv::Point2f& centerB, const int stride, const int gridX, const int gridY,
+                                const int threshold)
+    {
+        const auto scaleLabel = Dtype(1)/Dtype(stride);
+        const auto centerALabelScale = scaleLabel * centerA;
+        const auto centerBLabelScale = scaleLabel * centerB;
+        cv::Point2f directionAB = centerBLabelScale - centerALabelScale;
+        const auto distanceAB = std::sqrt(directionAB.x*directionAB.x + directionAB.y*directionAB.y);
+        directionAB *= (Dtype(1) / distanceAB);
+        // If PAF is not 0 or NaN (e.g. if PAF perpendicular to image plane)
+        if (!std::isnan(directionAB.x) && !std::isnan(directionAB.y))
+        {
+            const int minX = std::max(0,
+                                      int(std::round(std::min(centerALabelScale.x, centerBLabelScale.x) - threshold)));
+            const int maxX = std::min(gridX,
+                                      int(std::round(std::max(centerALabelScale.x, centerBLabelScale.x) + threshold)));
+            const int minY = std::max(0,
+                                      int(std::round(std::min(centerALabelScale.y, centerBLabelScale.y) - threshold)));
+            const int maxY = std::min(gridY,
+                                      int(std::round(std::max(centerALabelScale.y, centerBLabelScale.y) + threshold)));
+            for (auto gY = minY; gY < maxY; gY++)
+            {
+                const auto yOffset = gY*gridX;
+                const auto gYMenosCenterALabelScale = gY - centerALabelScale.y;
+                for (auto gX = minX; gX < maxX; gX++)
+                {
+                    const auto xyOffset = yOffset + gX;
+                    const cv::Point2f ba{gX - centerALabelScale.x, gYMenosCenterALabelScale};
+                    const float distance = std::abs(ba.x*directionAB.y - ba.y*directionAB.x);
+                    if (distance <= threshold)
+                    {
+                        auto& counter = count[xyOffset];
+                        if (counter == 0)
+                        {
+                            entryX[xyOffset] = directionAB.x;
+                            entryY[xyOffset] = directionAB.y;
+                        }
+                        else
+                        {
+                            entryX[xyOffset] = (entryX[xyOffset]*counter + directionAB.x) / (counter + 1);
+                            entryY[xyOffset] = (entryY[xyOffset]*counter + directionAB.y) / (counter + 1);
+                        }
+                        counter++;
+                    }
+                }
+            }
+        }
+    }
+
+    // Row kernels
+    // Gaussian: entry = min(1, max(entry, factorsX * factorY)) where factorsX * factorY >= minimumValue
+    template<typename Dtype>
+    void putGaussianRowScalar(Dtype* entry, const Dtype* factorsX, const Dtype factorY, const Dtype minimumValue,
+                              const int numberElements)
+    {
+        for (auto x = 0 ; x < numberElements ; x++)
+        {
+            const auto value = factorsX[x] * factorY;
+            if (value >= minimumValue)
+                entry[x] = std::min(Dtype(1), std::max(entry[x], value));
+        }
+    }
+
+    // PAF: average of the limb directions for the pixels closer than threshold to the limb line
+    template<typename Dtype>
+    void putVectorRowScalar(Dtype* entryX, Dtype* entryY, Dtype* count, const int minX, const int maxX,
+                            const float centerAX, const float gYMenosCenterAY, const cv::Point2f& directionAB,
+                            const float threshold)
+    {
+        for (auto gX = minX; gX < maxX; gX++)
+        {
+            const float distance = std::abs((gX - centerAX)*directionAB.y - gYMenosCenterAY*directionAB.x);
+            if (distance <= threshold)
+            {
+                auto& counter = count[gX];
+                if (counter == 0)
+                {
+                    entryX[gX] = directionAB.x;
+                    entryY[gX] = directionAB.y;
+                }
+                else
+                {
+                    entryX[gX] = (entryX[gX]*counter + directionAB.x) / (counter + 1);
+                    entryY[gX] = (entryY[gX]*counter + directionAB.y) / (counter + 1);
+                }
+                counter++;
+            }
+        }
+    }
+
+#ifdef LABEL_RENDERER_X86
+    __attribute__((target("avx2")))
+    void putGaussianRowAvx2(float* entry, const float* factorsX, const float factorY, const float minimumValue,
+                            const int numberElements)
+    {
+        const auto factorYs = _mm256_set1_ps(factorY);
+        const auto minimumValues = _mm256_set1_ps(minimumValue);
+        const auto ones = _mm256_set1_ps(1.f);
+        auto x = 0;
+        for ( ; x + 8 <= numberElements ; x += 8)
+        {
+            const auto values = _mm256_mul_ps(_mm256_loadu_ps(factorsX + x), factorYs);
+            const auto entries = _mm256_loadu_ps(entry + x);
+            const auto inside = _mm256_cmp_ps(values, minimumValues, _CMP_GE_OQ);
+            const auto maximums = _mm256_min_ps(ones, _mm256_max_ps(entries, values));
+            _mm256_storeu_ps(entry + x, _mm256_blendv_ps(entries, maximums, inside));
+        }
+        putGaussianRowScalar(entry + x, factorsX + x, factorY, minimumValue, numberElements - x);
+    }
+
+    __attribute__((target("avx512f")))
+    void putGaussianRowAvx512(float* entry, const float* factorsX, const float factorY, const float minimumValue,
+                              const int numberElements)
+    {
+        const auto factorYs = _mm512_set1_ps(factorY);
+        const auto minimumValues = _mm512_set1_ps(minimumValue);
+        const auto ones = _mm512_set1_ps(1.f);
+        for (auto x = 0 ; x < numberElements ; x += 16)
+        {
+            const auto remaining = numberElements - x;
+            const auto valid = (__mmask16)(remaining >= 16 ? 0xFFFF : (1u << remaining) - 1u);
+            const auto values = _mm512_mul_ps(_mm512_maskz_loadu_ps(valid, factorsX + x), factorYs);
+            const auto entries = _mm512_maskz_loadu_ps(valid, entry + x);
+            const auto inside = _mm512_mask_cmp_ps_mask(valid, values, minimumValues, _CMP_GE_OQ);
+            _mm512_mask_storeu_ps(entry + x, inside,
+                                  _mm512_maskz_min_ps(inside, ones, _mm512_maskz_max_ps(inside, entries, values)));
+        }
+    }
+
+    __attribute__((target("avx2")))
+    void putVectorRowAvx2(float* entryX, float* entryY, float* count, const int minX, const int maxX,
+                          const float centerAX, const float gYMenosCenterAY, const cv::Point2f& directionAB,
+                          const float threshold)
+    {
+        const auto directionXs = _mm256_set1_ps(directionAB.x);
+        const auto directionYs = _mm256_set1_ps(directionAB.y);
+        const auto centerAXs = _mm256_set1_ps(centerAX);
+        const auto baYDirectionXs = _mm256_mul_ps(_mm256_set1_ps(gYMenosCenterAY), directionXs);
+        const auto thresholds = _mm256_set1_ps(threshold);
+        const auto signMask = _mm256_set1_ps(-0.f);
+        const auto zeros = _mm256_setzero_ps();
+        const auto ones = _mm256_set1_ps(1.f);
+        const auto steps = _mm256_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f);
+        auto gX = minX;
+        for ( ; gX + 8 <= maxX ; gX += 8)
+        {
+            const auto baXs = _mm256_sub_ps(_mm256_add_ps(_mm256_set1_ps((float)gX), steps), centerAXs);
+            const auto distances = _mm256_andnot_ps(
+                signMask, _mm256_sub_ps(_mm256_mul_ps(baXs, directionYs), baYDirectionXs));
+            const auto inside = _mm256_cmp_ps(distances, thresholds, _CMP_LE_OQ);
+            if (_mm256_movemask_ps(inside) == 0)
+                continue;
+            const auto counters = _mm256_loadu_ps(count + gX);
+            const auto countersPlusOne = _mm256_add_ps(counters, ones);
+            const auto isFirst = _mm256_cmp_ps(counters, zeros, _CMP_EQ_OQ);
+            const auto entriesX = _mm256_loadu_ps(entryX + gX);
+            const auto entriesY = _mm256_loadu_ps(entryY + gX);
+            const auto averagesX = _mm256_blendv_ps(
+                _mm256_div_ps(_mm256_add_ps(_mm256_mul_ps(entriesX, counters), directionXs), countersPlusOne),
+                directionXs, isFirst);
+            const auto averagesY = _mm256_blendv_ps(
+                _mm256_div_ps(_mm256_add_ps(_mm256_mul_ps(entriesY, counters), directionYs), countersPlusOne),
+                directionYs, isFirst);
+            _mm256_storeu_ps(entryX + gX, _mm256_blendv_ps(entriesX, averagesX, inside));
+            _mm256_storeu_ps(entryY + gX, _mm256_blendv_ps(entriesY, averagesY, inside));
+            _mm256_storeu_ps(count + gX, _mm256_blendv_ps(counters, countersPlusOne, inside));
+        }
+        putVectorRowScalar(entryX, entryY, count, gX, maxX, centerAX, gYMenosCenterAY, directionAB, threshold);
+    }
+
+    __attribute__((target("avx512f")))
+    void putVectorRowAvx512(float* entryX, float* entryY, float* count, const int minX, const int maxX,
+                            const float centerAX, const float gYMenosCenterAY, const cv::Point2f& directionAB,
+                            const float threshold)
+    {
+        const auto directionXs = _mm512_set1_ps(directionAB.x);
+        const auto directionYs = _mm512_set1_ps(directionAB.y);
+        const auto centerAXs = _mm512_set1_ps(centerAX);
+        const auto baYDirectionXs = _mm512_mul_ps(_mm512_set1_ps(gYMenosCenterAY), directionXs);
+        const auto thresholds = _mm512_set1_ps(threshold);
+        const auto zeros = _mm512_setzero_ps();
+        const auto ones = _mm512_set1_ps(1.f);
+        const auto steps = _mm512_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f,
+                                          8.f, 9.f, 10.f, 11.f, 12.f, 13.f, 14.f, 15.f);
+        for (auto gX = minX ; gX < maxX ; gX += 16)
+        {
+            const auto remaining = maxX - gX;
+            const auto valid = (__mmask16)(remaining >= 16 ? 0xFFFF : (1u << remaining) - 1u);
+            const auto baXs = _mm512_sub_ps(_mm512_add_ps(_mm512_set1_ps((float)gX), steps), centerAXs);
+            const auto distances = _mm512_abs_ps(_mm512_sub_ps(_mm512_mul_ps(baXs, directionYs), baYDirectionXs));
+            const auto inside = _mm512_mask_cmp_ps_mask(valid, distances, thresholds, _CMP_LE_OQ);
+            if (inside == 0)
+                continue;
+            const auto counters = _mm512_maskz_loadu_ps(inside, count + gX);
+            const auto countersPlusOne = _mm512_add_ps(counters, ones);
+            const auto isFirst = _mm512_cmp_ps_mask(counters, zeros, _CMP_EQ_OQ);
+            const auto entriesX = _mm512_maskz_loadu_ps(inside, entryX + gX);
+            const auto entriesY = _mm512_maskz_loadu_ps(inside, entryY + gX);
+            const auto averagesX = _mm512_mask_blend_ps(
+                isFirst,
+                _mm512_div_ps(_mm512_add_ps(_mm512_mul_ps(entriesX, counters), directionXs), countersPlusOne),
+                directionXs);
+            const auto averagesY = _mm512_mask_blend_ps(
+                isFirst,
+                _mm512_div_ps(_mm512_add_ps(_mm512_mul_ps(entriesY, counters), directionYs), countersPlusOne),
+                directionYs);
+            _mm512_mask_storeu_ps(entryX + gX, inside, averagesX);
+            _mm512_mask_storeu_ps(entryY + gX, inside, averagesY);
+            _mm512_mask_storeu_ps(count + gX, inside, countersPlusOne);
+        }
+    }
+#endif  // LABEL_RENDERER_X86
+
+    // Engine dispatch (vectorized engines only for float)
+    template<typename Dtype>
+    void putGaussianRow(Dtype* entry, const Dtype* factorsX, const Dtype factorY, const Dtype minimumValue,
+                        const int numberElements, const LabelRenderingEngine labelRenderingEngine)
+    {
+        (void)labelRenderingEngine;
+        putGaussianRowScalar(entry, factorsX, factorY, minimumValue, numberElements);
+    }
+
+    template<>
+    void putGaussianRow<float>(float* entry, const float* factorsX, const float factorY, const float minimumValue,
+                               const int numberElements, const LabelRenderingEngine labelRenderingEngine)
+    {
+#ifdef LABEL_RENDERER_X86
+        if (labelRenderingEngine == LabelRenderingEngine::Avx512)
+            putGaussianRowAvx512(entry, factorsX, factorY, minimumValue, numberElements);
+        else if (labelRenderingEngine == LabelRenderingEngine::Avx2)
+            putGaussianRowAvx2(entry, factorsX, factorY, minimumValue, numberElements);
+        else
+#endif
+            putGaussianRowScalar(entry, factorsX, factorY, minimumValue, numberElements);
+    }
+
+    template<typename Dtype>
+    void putVectorRow(Dtype* entryX, Dtype* entryY, Dtype* count, const int minX, const int maxX,
+                      const float centerAX, const float gYMenosCenterAY, const cv::Point2f& directionAB,
+                      const float threshold, const LabelRenderingEngine labelRenderingEngine)
+    {
+        (void)labelRenderingEngine;
+        putVectorRowScalar(entryX, entryY, count, minX, maxX, centerAX, gYMenosCenterAY, directionAB, threshold);
+    }
+
+    template<>
+    void putVectorRow<float>(float* entryX, float* entryY, float* count, const int minX, const int maxX,
+                             const float centerAX, const float gYMenosCenterAY, const cv::Point2f& directionAB,
+                             const float threshold, const LabelRenderingEngine labelRenderingEngine)
+    {
+#ifdef LABEL_RENDERER_X86
+        if (labelRenderingEngine == LabelRenderingEngine::Avx512)
+            putVectorRowAvx512(entryX, entryY, count, minX, maxX, centerAX, gYMenosCenterAY, directionAB,
+                               threshold);
+        else if (labelRenderingEngine == LabelRenderingEngine::Avx2)
+            putVectorRowAvx2(entryX, entryY, count, minX, maxX, centerAX, gYMenosCenterAY, directionAB,
+                             threshold);
+        else
+#endif
+            putVectorRowScalar(entryX, entryY, count, minX, maxX, centerAX, gYMenosCenterAY, directionAB,
+                               threshold);
+    }
+
+    // Public functions
+    bool isLabelRenderingEngineSupported(const LabelRenderingEngine labelRenderingEngine)
+    {
+        if (labelRenderingEngine == LabelRenderingEngine::Avx2)
+        {
+#ifdef LABEL_RENDERER_X86
+            return __builtin_cpu_supports("avx2");
+#else
+            return false;
+#endif
+        }
+        else if (labelRenderingEngine == LabelRenderingEngine::Avx512)
+        {
+#ifdef LABEL_RENDERER_X86
+            return __builtin_cpu_supports("avx512f");
+#else
+            return false;
+#endif
+        }
+        return true;
+    }
+
+    LabelRenderingEngine getLabelRenderingEngine(const LabelRenderingEngine labelRenderingEngine)
+    {
+        if (labelRenderingEngine != LabelRenderingEngine::Auto)
+            return labelRenderingEngine;
+        static const auto sBestEngine = (isLabelRenderingEngineSupported(LabelRenderingEngine::Avx512)
+                                         ? LabelRenderingEngine::Avx512
+                                         : (isLabelRenderingEngineSupported(LabelRenderingEngine::Avx2)
+                                            ? LabelRenderingEngine::Avx2 : LabelRenderingEngine::Scalar));
+        return sBestEngine;
+    }
+
+    std::string getLabelRenderingEngineName(const LabelRenderingEngine labelRenderingEngine)
+    {
+        switch (getLabelRenderingEngine(labelRenderingEngine))
+        {
+            case LabelRenderingEngine::Reference: return "Reference";
+            case LabelRenderingEngine::Scalar: return "Scalar";
+            case LabelRenderingEngine::Avx2: return "AVX2";
+            case LabelRenderingEngine::Avx512: return "AVX-512";
+            default: return "Unknown";
+        }
+    }
+
+    template<typename Dtype>
+    void putGaussianMaps(Dtype* entry, const cv::Point2f& centerPoint, const int stride, const int gridX,
+                         const int gridY, const float sigma, const LabelRenderingEngine labelRenderingEngine)
+    {
+        const auto engine = getLabelRenderingEngine(labelRenderingEngine);
+        if (engine == LabelRenderingEngine::Reference)
+            return putGaussianMapsReference(entry, centerPoint, stride, gridX, gridY, sigma);
+        if (!std::isfinite(centerPoint.x) || !std::isfinite(centerPoint.y))
+            return;
+        const Dtype start = stride/2.f - 0.5f; //0 if stride = 1, 0.5 if stride = 2, 1.5 if stride = 4, ...
+        const auto multiplier = 2.0 * sigma * sigma;
+        // exp(-(dx^2+dy^2)/m) = exp(-dx^2/m) * exp(-dy^2/m): gridX+gridY exponentials rather than gridX*gridY.
+        // Values below 1% (ln(100) = -ln(1%)) are not rendered, so only the rows/columns within radius are visited
+        const auto maximumExponent = 4.6052;
+        const auto minimumValue = Dtype(std::exp(-maximumExponent));
+        const auto radius = std::sqrt(maximumExponent * multiplier);
+        const auto minX = (int)std::max(0., std::ceil((centerPoint.x - radius - start) / stride));
+        const auto maxX = (int)std::min((double)gridX, std::floor((centerPoint.x + radius - start) / stride) + 1.);
+        const auto minY = (int)std::max(0., std::ceil((centerPoint.y - radius - start) / stride));
+        const auto maxY = (int)std::min((double)gridY, std::floor((centerPoint.y + radius - start) / stride) + 1.);
+        if (minX >= maxX || minY >= maxY)
+            return;
+        std::vector<Dtype> factorsX(maxX - minX);
+        for (auto gX = minX; gX < maxX; gX++)
+        {
+            const Dtype x = start + gX * stride;
+            factorsX[gX - minX] = std::exp(-Dtype((x-centerPoint.x)*(x-centerPoint.x) / multiplier));
+        }
+        for (auto gY = minY; gY < maxY; gY++)
+        {
+            const Dtype y = start + gY * stride;
+            const auto factorY = std::exp(-Dtype((y-centerPoint.y)*(y-centerPoint.y) / multiplier));
+            if (factorY >= minimumValue)
+                putGaussianRow(entry + gY*gridX + minX, factorsX.data(), factorY, minimumValue, maxX - minX, engine);
+        }
+    }
+
+    template<typename Dtype>
+    void putVectorMaps(Dtype* entryX, Dtype* entryY, Dtype* count, const cv::Point2f& centerA,
+                       const cv::Point2f& centerB, const int stride, const int gridX, const int gridY,
+                       const int threshold, const LabelRenderingEngine labelRenderingEngine)
+    {
+        const auto engine = getLabelRenderingEngine(labelRenderingEngine);
+        if (engine == LabelRenderingEngine::Reference)
+            return putVectorMapsReference(entryX, entryY, count, centerA, centerB, stride, gridX, gridY, threshold);
+        const auto scaleLabel = Dtype(1)/Dtype(stride);
+        const auto centerALabelScale = scaleLabel * centerA;
+        const auto centerBLabelScale = scaleLabel * centerB;
+        cv::Point2f directionAB = centerBLabelScale - centerALabelScale;
+        const auto distanceAB = std::sqrt(directionAB.x*directionAB.x + directionAB.y*directionAB.y);
+        directionAB *= (Dtype(1) / distanceAB);
+        // If PAF is not 0 or NaN (e.g. if PAF perpendicular to image plane)
+        if (!std::isnan(directionAB.x) && !std::isnan(directionAB.y))
+        {
+            const int minX = std::max(0,
+                                      int(std::round(std::min(centerALabelScale.x, centerBLabelScale.x) - threshold)));
+            const int maxX = std::min(gridX,
+                                      int(std::round(std::max(centerALabelScale.x, centerBLabelScale.x) + threshold)));
+            const int minY = std::max(0,
+                                      int(std::round(std::min(centerALabelScale.y, centerBLabelScale.y) - threshold)));
+            const int maxY = std::min(gridY,
+                                      int(std::round(std::max(centerALabelScale.y, centerBLabelScale.y) + threshold)));
+            for (auto gY = minY; gY < maxY; gY++)
+            {
+                const auto yOffset = gY*gridX;
+                putVectorRow(entryX + yOffset, entryY + yOffset, count + yOffset, minX, maxX, centerALabelScale.x,
+                             gY - centerALabelScale.y, directionAB, float(threshold), engine);
+            }
+        }
+    }
+
+    template<typename Dtype>
+    void putBackgroundMap(Dtype* background, const Dtype* heatMaps, const int numberBodyParts,
+                          const int channelOffset)
+    {
+        // Channel by channel (contiguous memory, vectorized by the compiler) rather than pixel by pixel
+        std::fill(background, background + channelOffset, Dtype(0));
+        for (auto part = 0 ; part < numberBodyParts ; part++)
+        {
+            const auto* heatMap = heatMaps + part*channelOffset;
+            for (auto xyOffset = 0 ; xyOffset < channelOffset ; xyOffset++)
+                background[xyOffset] = (background[xyOffset] > heatMap[xyOffset]
+                                        ? background[xyOffset] : heatMap[xyOffset]);
+        }
+        for (auto xyOffset = 0 ; xyOffset < channelOffset ; xyOffset++)
+            background[xyOffset] = std::max(Dtype(1.)-background[xyOffset], Dtype(0.));
+    }
+
+    template<typename Dtype>
+    void renderLabels(Dtype* labels, const std::vector<Joints>& people, const PoseModel poseModel,
+                      const LabelRenderingParameters& labelRenderingParameters,
+                      const LabelRenderingEngine labelRenderingEngine)
+    {
+        const auto& parameters = labelRenderingParameters;
+        const auto engine = getLabelRenderingEngine(labelRenderingEngine);
+        const auto channelOffset = parameters.gridY * parameters.gridX;
+        const auto numberBodyParts = getNumberBodyParts(poseModel);
+        const auto numberPafChannels = getNumberPafChannels(poseModel);
+        std::fill(labels, labels + (numberPafChannels + numberBodyParts + 1)*channelOffset, Dtype(0));
+
+        // PAFs
+        const auto& labelMapA = getPafIndexA(poseModel);
+        const auto& labelMapB = getPafIndexB(poseModel);
+        std::vector<Dtype> count(channelOffset);
+        for (auto i = 0u ; i < labelMapA.size() ; i++)
+        {
+            std::fill(count.begin(), count.end(), Dtype(0));
+            for (const auto& joints : people)
+            {
+                if (joints.isVisible[labelMapA[i]] <= 1 && joints.isVisible[labelMapB[i]] <= 1)
+                    putVectorMaps(labels + 2*i*channelOffset, labels + (2*i + 1)*channelOffset, count.data(),
+                                  joints.points[labelMapA[i]], joints.points[labelMapB[i]], parameters.stride,
+                                  parameters.gridX, parameters.gridY, parameters.threshold, engine);
+            }
+        }
+
+        // Body parts
+        auto* heatMaps = labels + numberPafChannels*channelOffset;
+        for (auto part = 0; part < numberBodyParts; part++)
+            for (const auto& joints : people)
+                if (joints.isVisible[part] <= 1)
+                    putGaussianMaps(heatMaps + part*channelOffset, joints.points[part], parameters.stride,
+                                    parameters.gridX, parameters.gridY, parameters.sigma, engine);
+
+        // Background channel
+        putBackgroundMap(heatMaps + numberBodyParts*channelOffset, heatMaps, numberBodyParts, channelOffset);
+    }
+
+    template<typename Dtype>
+    void renderLabelsBatch(Dtype* labels, const std::vector<std::vector<Joints>>& peoplePerImage,
+                           const PoseModel poseModel, const LabelRenderingParameters& labelRenderingParameters,
+                           const LabelRenderingEngine labelRenderingEngine)
+    {
+        const auto imageOffset = (getNumberPafChannels(poseModel) + getNumberBodyParts(poseModel) + 1)
+                               * labelRenderingParameters.gridY * labelRenderingParameters.gridX;
+        for (auto i = 0u ; i < peoplePerImage.size() ; i++)
+            renderLabels(labels + i*imageOffset, peoplePerImage[i], poseModel, labelRenderingParameters,
+                         labelRenderingEngine);
+    }
+
+    void maskHands(cv::Mat& maskMiss, const std::vector<float>& isVisible, const std::vector<cv::Point2f>& points,
+                   const float stride, const float ratio)
+    {
+        for (auto part = 0 ; part < 2 ; part++)
+        {
+            const auto shoulderIndex = (part == 0 ? 5:2);
+            const auto elbowIndex = shoulderIndex+1;
+            const auto wristIndex = elbowIndex+1;
+            if (isVisible.at(shoulderIndex) != 2 && isVisible.at(elbowIndex) != 2 && isVisible.at(wristIndex) != 2)
+            {
+                const auto ratioStride = 1.f / stride;
+                const auto wrist = ratioStride * points.at(wristIndex);
+                const auto elbow = ratioStride * points.at(elbowIndex);
+                const auto shoulder = ratioStride * points.at(shoulderIndex);
+
+                const auto distance = (int)std::round(ratio*std::max(getNorm(wrist, elbow), getNorm(elbow, shoulder)));
+                const cv::Point momentum = (wrist-elbow)*0.25f;
+                cv::Rect roi{(int)std::round(wrist.x + momentum.x - distance /*- wrist.x/2.f*/),
+                             (int)std::round(wrist.y + momentum.y - distance /*- wrist.y/2.f*/),
+                             2*distance, 2*distance};
+                // Apply ROI
+                keepRoiInside(roi, maskMiss.size());
+                if (roi.area() > 0)
+                    maskMiss(roi).setTo(0.f); // For debugging use 0.5f
+            }
+            // // If there is no visible desired keypoints, mask out the whole background
+            // else
+            //     maskMiss.setTo(0.f); // For debugging use 0.5f
+        }
+    }
+
+    void maskFeet(cv::Mat& maskMiss, const std::vector<float>& isVisible, const std::vector<cv::Point2f>& points,
+                  const float stride, const float ratio)
+    {
+        for (auto part = 0 ; part < 2 ; part++)
+        {
+            const auto kneeIndex = 9+part*5;
+            const auto ankleIndex = kneeIndex+1;
+            if (isVisible.at(kneeIndex) != 2 && isVisible.at(ankleIndex) != 2)
+            {
+                const auto ratioStride = 1.f / stride;
+                const auto knee = ratioStride * points.at(kneeIndex);
+                const auto ankle = ratioStride * points.at(ankleIndex);
+                const auto distance = (int)std::round(ratio*getNorm(knee, ankle));
+                const cv::Point momentum = (ankle-knee)*0.15f;
+                cv::Rect roi{(int)std::round(ankle.x + momentum.x)-distance,
+                             (int)std::round(ankle.y + momentum.y)-distance,
+                             2*distance, 2*distance};
+                // Apply ROI
+                keepRoiInside(roi, maskMiss.size());
+                if (roi.area() > 0)
+                    maskMiss(roi).setTo(0.f); // For debugging use 0.5f
+            }
+            // // If there is no visible desired keypoints, mask out the whole background
+            // else
+            //     maskMiss.setTo(0.f); // For debugging use 0.5f
+        }
+    }
+
+    template<typename Dtype>
+    void fillMaskChannels(Dtype* transformedLabel, const int gridX, const int gridY, const int numberTotalChannels,
+                          const int channelOffset, const cv::Mat& maskMiss)
+    {
+        // Initialize labels to [0, 1] (depending on maskMiss)
+        // OpenCV wrapper: ~10x speed up with the naive per-pixel version
+        cv::Mat maskMissFloat;
+        const auto type = cv::DataType<Dtype>::type;
+        maskMiss.convertTo(maskMissFloat, type);
+        maskMissFloat /= Dtype(255.f);
+        // // For Distance
+        // for (auto part = 0; part < numberTotalChannels - numberPafChannels/2; part++)
+        for (auto part = 0; part < numberTotalChannels; part++)
+        {
+            auto* pointer = &transformedLabel[part*channelOffset];
+            cv::Mat transformedLabel(gridY, gridX, type, (unsigned char*)(pointer));
+            maskMissFloat.copyTo(transformedLabel);
+        }
+    }
+
+    void keepRoiInside(cv::Rect& roi, const cv::Size& imageSize)
+    {
+        // x,y < 0
+        if (roi.x < 0)
+        {
+            roi.width += roi.x;
+            roi.x = 0;
+        }
+        if (roi.y < 0)
+        {
+            roi.height += roi.y;
+            roi.y = 0;
+        }
+        // Bigger than image
+        if (roi.width + roi.x >= imageSize.width)
+            roi.width = imageSize.width - 1 - roi.x;
+        if (roi.height + roi.y >= imageSize.height)
+            roi.height = imageSize.height - 1 - roi.y;
+        // Width/height negative
+        roi.width = std::max(0, roi.width);
+        roi.height = std::max(0, roi.height);
+    }
+
+    // Explicit instantiations
+    template void putGaussianMaps<float>(float* entry, const cv::Point2f& centerPoint, const int stride,
+                                         const int gridX, const int gridY, const float sigma,
+                                         const LabelRenderingEngine labelRenderingEngine);
+    template void putGaussianMaps<double>(double* entry, const cv::Point2f& centerPoint, const int stride,
+                                          const int gridX, const int gridY, const float sigma,
+                                          const LabelRenderingEngine labelRenderingEngine);
+    template void putVectorMaps<float>(float* entryX, float* entryY, float* count, const cv::Point2f& centerA,
+                                       const cv::Point2f& centerB, const int stride, const int gridX,
+                                       const int gridY, const int threshold,
+                                       const LabelRenderingEngine labelRenderingEngine);
+    template void putVectorMaps<double>(double* entryX, double* entryY, double* count, const cv::Point2f& centerA,
+                                        const cv::Point2f& centerB, const int stride, const int gridX,
+                                        const int gridY, const int threshold,
+                                        const LabelRenderingEngine labelRenderingEngine);
+    template void putBackgroundMap<float>(float* background, const float* heatMaps, const int numberBodyParts,
+                                          const int channelOffset);
+    template void putBackgroundMap<double>(double* background, const double* heatMaps, const int numberBodyParts,
+                                           const int channelOffset);
+    template void renderLabels<float>(float* labels, const std::vector<Joints>& people, const PoseModel poseModel,
+                                      const LabelRenderingParameters& labelRenderingParameters,
+                                      const LabelRenderingEngine labelRenderingEngine);
+    template void renderLabels<double>(double* labels, const std::vector<Joints>& people, const PoseModel poseModel,
+                                       const LabelRenderingParameters& labelRenderingParameters,
+                                       const LabelRenderingEngine labelRenderingEngine);
+    template void renderLabelsBatch<float>(float* labels, const std::vector<std::vector<Joints>>& peoplePerImage,
+                                           const PoseModel poseModel,
+                                           const LabelRenderingParameters& labelRenderingParameters,
+                                           const LabelRenderingEngine labelRenderingEngine);
+    template void renderLabelsBatch<double>(double* labels, const std::vector<std::vector<Joints>>& peoplePerImage,
+                                            const PoseModel poseModel,
+                                            const LabelRenderingParameters& labelRenderingParameters,
+                                            const LabelRenderingEngine labelRenderingEngine);
+    template void fillMaskChannels<float>(float* transformedLabel, const int gridX, const int gridY,
+                                          const int numberTotalChannels, const int channelOffset,
+                                          const cv::Mat& maskMiss);
+    template void fillMaskChannels<double>(double* transformedLabel, const int gridX, const int gridY,
+                                           const int numberTotalChannels, const int channelOffset,
+                                           const cv::Mat& maskMiss);
+}  // namespace caffe
+#endif  // USE_OPENCV
@@ -8,16 +8,42 @@
 #include "caffe/data_transformer.hpp"
 #include "caffe/layers/data_layer.hpp"
 #include "caffe/util/benchmark.hpp"
+#ifdef USE_LMDB
+#include "caffe/util/db_lmdb.hpp"
+#endif  // USE_LMDB
 // OpenPose: added
 #include <chrono>
 #include <stdexcept>
 #include "caffe/util/io.hpp" // DecodeDatum, DecodeDatumNative
+#include "caffe/util/math_functions.hpp" // caffe_copy
 #include "caffe/openpose/getLine.hpp"
 #include "caffe/openpose/layers/oPDataLayer.hpp"
 // OpenPose: added end
 
 namespace caffe {
 
+// OpenPose: added
+// Number of entries of the DB (LMDB statistics, or a single pass of an extra cursor for other backends)
+uint64_t getNumberEntries(db::DB* db)
+{
+    uint64_t numberEntries = 0;
+    #ifdef USE_LMDB
+    auto* lmdb = dynamic_cast<db::LMDB*>(db);
+    if (lmdb != nullptr)
+        numberEntries = lmdb->NumEntries();
+    else
+    #endif  // USE_LMDB
+    {
+        shared_ptr<db::Cursor> cursor{db->NewCursor()};
+        for (cursor->SeekToFirst() ; cursor->valid() ; cursor->Next())
+            numberEntries++;
+    }
+    if (numberEntries == 0)
+        throw std::runtime_error{"Empty DB." + getLine(__LINE__, __FUNCTION__, __FILE__)};
+    return numberEntries;
+}
+// OpenPose: added end
+
 template <typename Dtype>
 OPDataLayer<Dtype>::OPDataLayer(const LayerParameter& param) :
     BasePrefetchingDataLayer<Dtype>(param),
@@ -31,6 +57,15 @@ OPDataLayer<Dtype>::OPDataLayer(const LayerParameter& param) :
     // OpenPose: added
     mOnes = 0;
     mTwos = 0;
+    // TEST phase letterboxing
+    mLetterbox = (this->phase_ == TEST && op_transform_param_.test_letterbox());
+    // Epoch counters
+    mEpoch = 0;
+    mEpochPosition = 0;
+    mEpochSize = getNumberEntries(db_.get());
+    mEpochSecond = 0;
+    mEpochPositionSecond = 0;
+    mEpochSizeSecond = 1;
     // Set up secondary DB
     if (!param.op_transform_param().source_secondary().empty())
     {
@@ -41,6 +76,7 @@ OPDataLayer<Dtype>::OPDataLayer(const LayerParameter& param) :
         dbSecond.reset(db::GetDB(DataParameter_DB::DataParameter_DB_LMDB));
         dbSecond->Open(param.op_transform_param().source_secondary(), db::READ);
         cursorSecond.reset(dbSecond->NewCursor());
+        mEpochSizeSecond = getNumberEntries(dbSecond.get());
     }
     else
     {
@@ -79,17 +115,27 @@ void OPDataLayer<Dtype>::DataLayerSetUp(const vector<Blob<Dtype>*>& bottom,
     datum.ParseFromString(cursor_->value());
 
     // OpenPose: added
-    mOPDataTransformer.reset(new OPDataTransformer<Dtype>(op_transform_param_, this->phase_, op_transform_param_.model()));
+    const auto prefetchThreads = this->layer_param_.data_param().prefetch_threads();
+    for (auto worker = 0u ; worker < prefetchThreads ; worker++)
+    {
+        mOPDataTransformers.emplace_back(
+            new OPDataTransformer<Dtype>(op_transform_param_, this->phase_, op_transform_param_.model()));
+        if (secondDb)
+            mOPDataTransformersSecondary.emplace_back(
+                new OPDataTransformer<Dtype>(op_transform_param_, this->phase_, op_transform_param_.model_secondary()));
+    }
+    mOPDataTransformer = mOPDataTransformers[0];
     if (secondDb)
-        mOPDataTransformerSecondary.reset(new OPDataTransformer<Dtype>(op_transform_param_, this->phase_, op_transform_param_.model_secondary()));
+        mOPDataTransformerSecondary = mOPDataTransformersSecondary[0];
     // mOPDataTransformer->InitRand();
     // Force color
     bool forceColor = this->layer_param_.data_param().force_encoded_color();
     if ((forceColor && DecodeDatum(&datum, true)) || DecodeDatumNative(&datum))
         LOG(INFO) << "Decoding Datum";
-    // Image shape
-    const int width = this->phase_ != TRAIN ? datum.width() : this->layer_param_.op_transform_param().crop_size_x();
-    const int height = this->phase_ != TRAIN ? datum.height() : this->layer_param_.op_transform_param().crop_size_y();
+    // Image shape (fixed unless TEST phase without letterboxing)
+    const auto fixedShape = (this->phase_ == TRAIN || mLetterbox);
+    const int width = !fixedShape ? datum.width() : this->layer_param_.op_transform_param().crop_size_x();
+    const int height = !fixedShape ? datum.height() : this->layer_param_.op_transform_param().crop_size_y();
     std::vector<int> topShape{batch_size, 3, height, width};
     top[0]->Reshape(topShape);
     this->transformed_data_.Reshape(1, topShape[1], topShape[2], topShape[3]);
@@ -111,6 +157,17 @@ void OPDataLayer<Dtype>::DataLayerSetUp(const vector<Blob<Dtype>*>& bottom,
     }
     else
         throw std::runtime_error{"output_labels_ must be set to true" + getLine(__LINE__, __FUNCTION__, __FILE__)};
+    // Letterbox info: scale, offset x, offset y, original width, original height
+    if (top.size() > 2)
+    {
+        if (!mLetterbox)
+            throw std::runtime_error{"3rd top blob requires TEST phase and test_letterbox"
+                                     + getLine(__LINE__, __FUNCTION__, __FILE__)};
+        const std::vector<int> letterboxShape{batch_size, 5};
+        top[2]->Reshape(letterboxShape);
+        for (int i = 0; i < this->prefetch_.size(); ++i)
+            mPrefetchLetterboxes.emplace_back(new Blob<Dtype>(letterboxShape));
+    }
     // OpenPose: end
 
     // OpenPose: commented
@@ -138,6 +195,53 @@ void OPDataLayer<Dtype>::DataLayerSetUp(const vector<Blob<Dtype>*>& bottom,
     // OpenPose: end
 }
 
+// OpenPose: added
+template <typename Dtype>
+int OPDataLayer<Dtype>::getEpoch() const
+{
+    return mEpoch;
+}
+
+template <typename Dtype>
+float OPDataLayer<Dtype>::getEpochProgress() const
+{
+    return mEpochPosition / (float)mEpochSize;
+}
+
+template <typename Dtype>
+void OPDataLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
+    const vector<Blob<Dtype>*>& top)
+{
+    BasePrefetchingDataLayer<Dtype>::Forward_cpu(bottom, top);
+    if (top.size() > 2)
+    {
+        const auto* letterbox = getLetterbox(this->prefetch_current_);
+        caffe_copy(letterbox->count(), letterbox->cpu_data(), top[2]->mutable_cpu_data());
+    }
+}
+
+template <typename Dtype>
+void OPDataLayer<Dtype>::Forward_gpu(const vector<Blob<Dtype>*>& bottom,
+    const vector<Blob<Dtype>*>& top)
+{
+    BasePrefetchingDataLayer<Dtype>::Forward_gpu(bottom, top);
+    if (top.size() > 2)
+    {
+        const auto* letterbox = getLetterbox(this->prefetch_current_);
+        caffe_copy(letterbox->count(), letterbox->cpu_data(), top[2]->mutable_cpu_data());
+    }
+}
+
+template <typename Dtype>
+Blob<Dtype>* OPDataLayer<Dtype>::getLetterbox(const Batch<Dtype>* batch) const
+{
+    for (auto i = 0u ; i < mPrefetchLetterboxes.size() ; i++)
+        if (this->prefetch_[i].get() == batch)
+            return mPrefetchLetterboxes[i].get();
+    return nullptr;
+}
+// OpenPose: added end
+
 template <typename Dtype>
 bool OPDataLayer<Dtype>::Skip()
 {
@@ -158,7 +262,15 @@ void OPDataLayer<Dtype>::Next()
         LOG_IF(INFO, Caffe::root_solver())
                 << "Restarting data prefetching from start.";
         cursor_->SeekToFirst();
+        // OpenPose: added
+        mEpochPosition = 0;
+        mEpoch++;
+        // OpenPose: added end
     }
+    // OpenPose: added
+    else
+        mEpochPosition++;
+    // OpenPose: added end
     offset_++;
 }
 
@@ -198,7 +310,11 @@ void OPDataLayer<Dtype>::NextSecond()
         LOG_IF(INFO, Caffe::root_solver())
                 << "Restarting second data prefetching from start.";
         cursorSecond->SeekToFirst();
+        mEpochPositionSecond = 0;
+        mEpochSecond++;
     }
+    else
+        mEpochPositionSecond++;
     offsetSecond++;
 }
 // OpenPose: added ended
@@ -217,14 +333,21 @@ void OPDataLayer<Dtype>::load_batch(Batch<Dtype>* batch)
     const int batch_size = this->layer_param_.data_param().batch_size();
 
     // OpenPose: added
+    const auto worker = this->prefetch_worker();
     auto* topLabel = batch->label_.mutable_cpu_data();
     // OpenPose: added ended
 
-    Datum datum;
-    Datum datumBackground;
     // OpenPose: added
+    // Whole batch is read first, so the images not stored in the LMDB (DOME) are decoded in parallel
+    std::vector<Datum> datums(batch_size);
+    std::vector<Datum> datumsBackground(backgroundDb ? batch_size : 0);
+    std::vector<int> epochs(batch_size);
     const float dice = static_cast <float> (rand()) / static_cast <float> (RAND_MAX); //[0,1]
     const auto desiredDbIs1 = !secondDb || (dice <= (1-secondProbability));
+    // If only main DB or if 2 DBs but 1st must go
+    auto oPDataTransformerPtr = (desiredDbIs1 ? mOPDataTransformers[worker] : mOPDataTransformersSecondary[worker]);
+    auto* letterbox = getLetterbox(batch);
+    oPDataTransformerPtr->StartBatch();
     // OpenPose: added ended
     for (int item_id = 0; item_id < batch_size; ++item_id) {
         timer.Start();
@@ -235,38 +358,54 @@ void OPDataLayer<Dtype>::load_batch(Batch<Dtype>* batch)
         // datum.ParseFromString(cursor_->value());
         // OpenPose: commended ended
         // OpenPose: added
-        // If only main DB or if 2 DBs but 1st must go
-        auto oPDataTransformerPtr = this->mOPDataTransformer;
+        auto& datum = datums[item_id];
         if (desiredDbIs1)
         {
             mOnes++;
             while (Skip())
                 Next();
             datum.ParseFromString(cursor_->value());
+            epochs[item_id] = mEpoch;
+            Next();
         }
         // If 2 DBs & 2nd one must go
         else
         {
-            oPDataTransformerPtr = this->mOPDataTransformerSecondary;
             mTwos++;
             while (SkipSecond())
                 NextSecond();
             datum.ParseFromString(cursorSecond->value());
+            epochs[item_id] = mEpochSecond;
+            NextSecond();
         }
         if (backgroundDb)
         {
             NextBackground();
-            datumBackground.ParseFromString(cursorBackground->value());
+            datumsBackground[item_id].ParseFromString(cursorBackground->value());
         }
+        oPDataTransformerPtr->Prefetch(datum);
         // OpenPose: added ended
         read_time += timer.MicroSeconds();
+    }
+    // OpenPose: added
+    // Batch read, the next prefetch worker can start reading while this one transforms it
+    this->EndOrderedRead();
+    Blob<Dtype> transformedData;
+    transformedData.ReshapeLike(this->transformed_data_);
+    Blob<Dtype> transformedLabel;
+    transformedLabel.ReshapeLike(this->transformed_label_);
+    double duration = 0;
+    // OpenPose: added ended
+    for (int item_id = 0; item_id < batch_size; ++item_id) {
+        const auto& datum = datums[item_id];
 
         if (item_id == 0) {
             // OpenPose: added
             // this->transformed_data_.Reshape({1, 3, height, width});
             // top_shape[0] = batch_size;
-            const int width = this->phase_ != TRAIN ? datum.width() : this->layer_param_.op_transform_param().crop_size_x();
-            const int height = this->phase_ != TRAIN ? datum.height() : this->layer_param_.op_transform_param().crop_size_y();
+            const auto fixedShape = (this->phase_ == TRAIN || mLetterbox);
+            const int width = !fixedShape ? datum.width() : this->layer_param_.op_transform_param().crop_size_x();
+            const int height = !fixedShape ? datum.height() : this->layer_param_.op_transform_param().crop_size_y();
             batch->data_.Reshape({batch_size, 3, height, width});
             // OpenPose: added ended
             // OpenPose: commented
@@ -287,30 +426,22 @@ void OPDataLayer<Dtype>::load_batch(Batch<Dtype>* batch)
         // Image
         const int offset = batch->data_.offset(item_id);
         auto* topData = batch->data_.mutable_cpu_data();
-        this->transformed_data_.set_cpu_data(topData + offset);
+        transformedData.set_cpu_data(topData + offset);
         // Label
         const int offsetLabel = batch->label_.offset(item_id);
-        this->transformed_label_.set_cpu_data(topLabel + offsetLabel);
+        transformedLabel.set_cpu_data(topLabel + offsetLabel);
         // Process image & label
         const auto begin = std::chrono::high_resolution_clock::now();
-        if (backgroundDb)
-            oPDataTransformerPtr->Transform(&(this->transformed_data_),
-                                            &(this->transformed_label_),
-                                            datum,
-                                            &datumBackground);
-        else
-            oPDataTransformerPtr->Transform(&(this->transformed_data_),
-                                            &(this->transformed_label_),
-                                            datum);
+        oPDataTransformerPtr->Transform(&transformedData,
+                                        &transformedLabel,
+                                        datum,
+                                        (backgroundDb ? &datumsBackground[item_id] : nullptr),
+                                        epochs[item_id],
+                                        (letterbox != nullptr
+                                            ? letterbox->mutable_cpu_data() + letterbox->offset(item_id)
+                                            : nullptr));
         const auto end = std::chrono::high_resolution_clock::now();
-        mDuration += std::chrono::duration_cast<std::chrono::nanoseconds>(end-begin).count();
-
-        // DB 1
-        if (desiredDbIs1)
-            Next();
-        // DB 2
-        else
-            NextSecond();
+        duration += std::chrono::duration_cast<std::chrono::nanoseconds>(end-begin).count();
         trans_time += timer.MicroSeconds();
         // OpenPose: added ended
         // OpenPose: commented
@@ -325,6 +456,8 @@ void OPDataLayer<Dtype>::load_batch(Batch<Dtype>* batch)
         // OpenPose: commented ended
     }
     // Timer (every 20 iterations x batch size)
+    std::unique_lock<std::mutex> lock{mTimerMutex};
+    mDuration += duration;
     mCounter++;
     const auto repeatEveryXVisualizations = 2;
     if (mCounter == 20*repeatEveryXVisualizations)
@@ -334,6 +467,7 @@ void OPDataLayer<Dtype>::load_batch(Batch<Dtype>* batch)
         mDuration = 0;
         mCounter = 0;
     }
+    lock.unlock();
     timer.Stop();
     batch_timer.Stop();
     DLOG(INFO) << "Prefetch batch: " << batch_timer.MilliSeconds() << " ms.";
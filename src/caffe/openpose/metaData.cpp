@@ -86,8 +86,8 @@ namespace caffe {
 
     // Public functions
     template<typename Dtype>
-    void readMetaData(MetaData& metaData, int& currentEpoch, const char* data,
-                      const size_t offsetPerLine, const PoseCategory poseCategory, const PoseModel poseModel)
+    void readMetaData(MetaData& metaData, const char* data, const size_t offsetPerLine,
+                      const PoseCategory poseCategory, const PoseModel poseModel)
     {
         // Dataset name
         metaData.datasetString = decodeString(data);
@@ -101,19 +101,8 @@ namespace caffe {
         metaData.annotationListIndex = (int)(decodeNumber<Dtype>(&data[2*offsetPerLine+2]));
         metaData.writeNumber = (int)(decodeNumber<Dtype>(&data[2*offsetPerLine+6]));
         metaData.totalWriteNumber = (int)(decodeNumber<Dtype>(&data[2*offsetPerLine+10]));
-
-        // Count epochs according to counters
-        if (metaData.writeNumber == 0)
-            currentEpoch++;
-        metaData.epoch = currentEpoch;
-        if (metaData.writeNumber % 1000 == 0)
-        {
-            LOG(INFO) << "datasetString: " << metaData.datasetString <<"; imageSize: " << metaData.imageSize
-                      << "; metaData.annotationListIndex: " << metaData.annotationListIndex
-                      << "; metaData.writeNumber: " << metaData.writeNumber
-                      << "; metaData.totalWriteNumber: " << metaData.totalWriteNumber
-                      << "; metaData.epoch: " << metaData.epoch;
-        }
+        // Epoch is given by the data layer sampler, not by the writing order of the LMDB
+        metaData.epoch = -1;
 
         // Objpos
         metaData.objPos.x = decodeNumber<Dtype>(&data[3*offsetPerLine]);
@@ -218,8 +207,8 @@ namespace caffe {
         lmdbJointsToOurModel(metaData, poseModel);
     }
 
-    template void readMetaData<float>(MetaData& metaData, int& currentEpoch, const char* data, const size_t offsetPerLine,
+    template void readMetaData<float>(MetaData& metaData, const char* data, const size_t offsetPerLine,
                                       const PoseCategory poseCategory, const PoseModel poseModel);
-    template void readMetaData<double>(MetaData& metaData, int& currentEpoch, const char* data, const size_t offsetPerLine,
+    template void readMetaData<double>(MetaData& metaData, const char* data, const size_t offsetPerLine,
                                        const PoseCategory poseCategory, const PoseModel poseModel);
 }  // namespace caffe
@@ -233,7 +233,7 @@ template<typename Dtype>
 OPDataTransformer<Dtype>::OPDataTransformer(const OPTransformationParameter& param,
         Phase phase, const std::string& modelString) // OpenPose: Added std::string
         // : param_(param), phase_(phase) {
-        : param_(param), phase_(phase), mCurrentEpoch{-1} {
+        : param_(param), phase_(phase) {
     // OpenPose: commented
     // // check if we want to use mean_file
     // if (param_.has_mean_file()) {
@@ -261,6 +261,9 @@ OPDataTransformer<Dtype>::OPDataTransformer(const OPTransformationParameter& par
     // PoseModel
     std::tie(mPoseModel, mPoseCategory) = flagsToPoseModel(modelString);
     mModelString = modelString;
+    // Image decoder (DOME images are not stored in the LMDB)
+    if (mPoseCategory == PoseCategory::DOME)
+        mImageDecoder.reset(new ImageDecoder{(int)param_.decode_threads(), (int)param_.decode_cache_size()});
     // OpenPose: added end
 }
 
@@ -281,7 +284,8 @@ OPDataTransformer<Dtype>::OPDataTransformer(const OPTransformationParameter& par
 // OpenPose: added
 template<typename Dtype>
 void OPDataTransformer<Dtype>::Transform(Blob<Dtype>* transformedData, Blob<Dtype>* transformedLabel,
-                                         const Datum& datum, const Datum* datumNegative)
+                                         const Datum& datum, const Datum* datumNegative, const int epoch,
+                                         Dtype* transformedLetterbox)
 {
     // Secuirty checks
     const int datumChannels = datum.channels();
@@ -297,10 +301,40 @@ void OPDataTransformer<Dtype>::Transform(Blob<Dtype>* transformedData, Blob<Dtyp
     auto* transformedLabelPtr = transformedLabel->mutable_cpu_data();
     CPUTimer timer;
     timer.Start();
-    generateDataAndLabel(transformedDataPtr, transformedLabelPtr, datum, datumNegative);
+    generateDataAndLabel(transformedDataPtr, transformedLabelPtr, transformedLetterbox, datum, datumNegative, epoch);
     VLOG(2) << "Transform: " << timer.MicroSeconds() / 1000.0  << " ms";
 }
 
+template<typename Dtype>
+void OPDataTransformer<Dtype>::StartBatch()
+{
+    // Scales of the datums of an abandoned batch, whose addresses a new batch may reuse
+    mPrefetchedScales.clear();
+    if (mImageDecoder)
+        mImageDecoder->clearPending();
+}
+
+template<typename Dtype>
+void OPDataTransformer<Dtype>::Prefetch(const Datum& datum)
+{
+    if (mPoseCategory == PoseCategory::DOME)
+    {
+        MetaData metaData;
+        readMetaData<Dtype>(metaData, datum.data().c_str(), datum.width(), mPoseCategory, mPoseModel);
+        // Scale sampled before decoding, so the image can be decoded at the lowest resolution it allows
+        auto scale = 1.f;
+        if (phase_ == TRAIN)
+        {
+            scale = estimateScale(metaData, param_);
+            mPrefetchedScales.emplace_back(&datum, scale);
+        }
+        mImageDecoder->prefetch(param_.media_directory() + metaData.imageSource, CV_LOAD_IMAGE_COLOR,
+                                getImageReduction(scale));
+        if (metaData.depthEnabled)
+            mImageDecoder->prefetch(param_.media_directory() + metaData.depthSource, CV_LOAD_IMAGE_ANYDEPTH);
+    }
+}
+
 template <typename Dtype>
 int OPDataTransformer<Dtype>::getNumberChannels() const
 {
@@ -322,7 +356,8 @@ int OPDataTransformer<Dtype>::getNumberChannels() const
 // OpenPose: added
 template<typename Dtype>
 void OPDataTransformer<Dtype>::generateDataAndLabel(Dtype* transformedData, Dtype* transformedLabel,
-                                                    const Datum& datum, const Datum* datumNegative)
+                                                    Dtype* transformedLetterbox, const Datum& datum,
+                                                    const Datum* datumNegative, const int epoch)
 {
     // Parameters
     const std::string& data = datum.data();
@@ -347,21 +382,37 @@ void OPDataTransformer<Dtype>::generateDataAndLabel(Dtype* transformedData, Dtyp
     MetaData metaData;
     // DOME
     if (mPoseCategory == PoseCategory::DOME)
-        readMetaData<Dtype>(metaData, mCurrentEpoch, data.c_str(), datumWidth, mPoseCategory, mPoseModel);
+        readMetaData<Dtype>(metaData, data.c_str(), datumWidth, mPoseCategory, mPoseModel);
     // COCO & MPII
     else
-        readMetaData<Dtype>(metaData, mCurrentEpoch, &data[3 * datumArea], datumWidth, mPoseCategory, mPoseModel);
+        readMetaData<Dtype>(metaData, &data[3 * datumArea], datumWidth, mPoseCategory, mPoseModel);
+    metaData.epoch = epoch;
+    if (metaData.writeNumber % 1000 == 0)
+    {
+        LOG(INFO) << "datasetString: " << metaData.datasetString <<"; imageSize: " << metaData.imageSize
+                  << "; metaData.annotationListIndex: " << metaData.annotationListIndex
+                  << "; metaData.writeNumber: " << metaData.writeNumber
+                  << "; metaData.totalWriteNumber: " << metaData.totalWriteNumber
+                  << "; metaData.epoch: " << metaData.epoch;
+    }
     const auto depthEnabled = metaData.depthEnabled;
+    // Scale augmentation (sampled before reading the image, so it can be decoded at a reduced resolution)
+    const auto scale = (phase_ == TRAIN ? getScale(metaData, datum) : 1.f);
 
     // Read image (LMDB channel 1)
     cv::Mat image;
+    // Image resolution relative to the decoded one (> 1 if decoded at reduced resolution)
+    auto imageReduction = 1.f;
     // DOME
     if (mPoseCategory == PoseCategory::DOME)
     {
         const auto imageFullPath = param_.media_directory() + metaData.imageSource;
-        image = cv::imread(imageFullPath, CV_LOAD_IMAGE_COLOR);
+        const auto reduction = getImageReduction(scale);
+        image = mImageDecoder->get(imageFullPath, CV_LOAD_IMAGE_COLOR, reduction);
         if (image.empty())
             throw std::runtime_error{"Empty image at " + imageFullPath + getLine(__LINE__, __FUNCTION__, __FILE__)};
+        if (reduction > 1)
+            imageReduction = metaData.imageSize.width / (float)image.cols;
     }
     // COCO & MPII
     else
@@ -415,8 +466,8 @@ void OPDataTransformer<Dtype>::generateDataAndLabel(Dtype* transformedData, Dtyp
         // CHECK_EQ(initImageArea, datumArea);
         // CHECK_EQ(cv::norm(image-image2), 0);
     }
-    const auto initImageWidth = (int)image.cols;
-    const auto initImageHeight = (int)image.rows;
+    const auto initImageWidth = (int)std::round(image.cols * imageReduction);
+    const auto initImageHeight = (int)std::round(image.rows * imageReduction);
 
     // Read background image
     cv::Mat backgroundImage;
@@ -542,8 +593,8 @@ void OPDataTransformer<Dtype>::generateDataAndLabel(Dtype* transformedData, Dtyp
     if (depthEnabled)
     {
         const auto depthFullPath = param_.media_directory() + metaData.depthSource;
-        depth = cv::imread(depthFullPath, CV_LOAD_IMAGE_ANYDEPTH);
-        if (image.empty())
+        depth = mImageDecoder->get(depthFullPath, CV_LOAD_IMAGE_ANYDEPTH);
+        if (depth.empty())
             throw std::runtime_error{"Empty depth at " + depthFullPath + getLine(__LINE__, __FUNCTION__, __FILE__)};
     }
 
@@ -582,12 +633,12 @@ void OPDataTransformer<Dtype>::generateDataAndLabel(Dtype* transformedData, Dtyp
         swapCenterPoint(metaData, param_, mPoseModel);
         // Augmentation (scale, rotation, cropping, and flipping)
         // Order does matter, otherwise code will fail doing augmentation
-        augmentSelection.scale = estimateScale(metaData, param_);
+        augmentSelection.scale = scale;
         applyScale(metaData, augmentSelection.scale, mPoseModel);
         augmentSelection.RotAndFinalSize = estimateRotation(
             metaData,
-            cv::Size{(int)std::round(image.cols * augmentSelection.scale),
-                     (int)std::round(image.rows * augmentSelection.scale)},
+            cv::Size{(int)std::round(initImageWidth * augmentSelection.scale),
+                     (int)std::round(initImageHeight * augmentSelection.scale)},
             param_);
         applyRotation(metaData, augmentSelection.RotAndFinalSize.first, mPoseModel);
         augmentSelection.cropCenter = estimateCrop(metaData, param_);
@@ -595,9 +646,9 @@ void OPDataTransformer<Dtype>::generateDataAndLabel(Dtype* transformedData, Dtyp
         augmentSelection.flip = estimateFlip(metaData, param_);
         applyFlip(metaData, augmentSelection.flip, finalImageHeight, param_, mPoseModel);
         // Aug on images - ~80% code time spent in the following `applyAllAugmentation` lines
-        applyAllAugmentation(imageAugmented, augmentSelection.RotAndFinalSize.first, augmentSelection.scale,
-                             augmentSelection.flip, augmentSelection.cropCenter, finalCropSize, image,
-                             0);
+        applyAllAugmentation(imageAugmented, augmentSelection.RotAndFinalSize.first,
+                             augmentSelection.scale * imageReduction, augmentSelection.flip,
+                             augmentSelection.cropCenter, finalCropSize, image, 0);
         applyAllAugmentation(maskBackgroundImageAugmented, augmentSelection.RotAndFinalSize.first,
                              augmentSelection.scale, augmentSelection.flip, augmentSelection.cropCenter,
                              finalCropSize, maskBackgroundImage, 255);
@@ -632,6 +683,40 @@ void OPDataTransformer<Dtype>::generateDataAndLabel(Dtype* transformedData, Dtyp
         if (depthEnabled && !depthAugmented.empty())
             cv::resize(depthAugmented, depthAugmented, cv::Size{gridX, gridY}, 0, 0, cv::INTER_AREA);
     }
+    // Test - Letterbox: resize keeping the aspect ratio + padding into the fixed finalCropSize canvas
+    else if (param_.test_letterbox())
+    {
+        augmentSelection.scale = std::min(finalImageWidth / (float)initImageWidth,
+                                          finalImageHeight / (float)initImageHeight);
+        const cv::Point2i offset{
+            (int)std::round((finalImageWidth - initImageWidth * augmentSelection.scale) / 2.f),
+            (int)std::round((finalImageHeight - initImageHeight * augmentSelection.scale) / 2.f)};
+        // Crop center such that the scaled image starts at offset
+        augmentSelection.cropCenter = cv::Point2i{finalImageWidth/2 - offset.x, finalImageHeight/2 - offset.y};
+        const cv::Mat identity = cv::Mat::eye(2, 3, CV_64F);
+        applyScale(metaData, augmentSelection.scale, mPoseModel);
+        applyCrop(metaData, augmentSelection.cropCenter, finalCropSize, mPoseModel);
+        applyAllAugmentation(imageAugmented, identity, augmentSelection.scale * imageReduction, false,
+                             augmentSelection.cropCenter, finalCropSize, image, 0);
+        applyAllAugmentation(maskMissAugmented, identity, augmentSelection.scale, false,
+                             augmentSelection.cropCenter, finalCropSize, maskMiss, 255);
+        applyAllAugmentation(depthAugmented, identity, augmentSelection.scale, false,
+                             augmentSelection.cropCenter, finalCropSize, depth, 0);
+        // Resize mask
+        if (!maskMissAugmented.empty())
+            cv::resize(maskMissAugmented, maskMissAugmented, cv::Size{gridX, gridY}, 0, 0, cv::INTER_AREA);
+        if (depthEnabled && !depthAugmented.empty())
+            cv::resize(depthAugmented, depthAugmented, cv::Size{gridX, gridY}, 0, 0, cv::INTER_AREA);
+        // Original coordinates = (letterbox coordinates - offset) / scale
+        if (transformedLetterbox != nullptr)
+        {
+            transformedLetterbox[0] = augmentSelection.scale;
+            transformedLetterbox[1] = offset.x;
+            transformedLetterbox[2] = offset.y;
+            transformedLetterbox[3] = initImageWidth;
+            transformedLetterbox[4] = initImageHeight;
+        }
+    }
     // Test
     else
     {
@@ -760,6 +845,30 @@ void OPDataTransformer<Dtype>::generateDataAndLabel(Dtype* transformedData, Dtyp
     // }
 }
 
+template<typename Dtype>
+float OPDataTransformer<Dtype>::getScale(const MetaData& metaData, const Datum& datum)
+{
+    // Scale already sampled by Prefetch
+    if (!mPrefetchedScales.empty() && mPrefetchedScales.front().first == &datum)
+    {
+        const auto scale = mPrefetchedScales.front().second;
+        mPrefetchedScales.pop_front();
+        return scale;
+    }
+    // Datum not prefetched (or Prefetch/Transform out of order)
+    mPrefetchedScales.clear();
+    return estimateScale(metaData, param_);
+}
+
+template<typename Dtype>
+int OPDataTransformer<Dtype>::getImageReduction(const float scale) const
+{
+    // The decoded image must not be upsampled back by the scale augmentation
+    if (phase_ != TRAIN || !param_.decode_reduced())
+        return 1;
+    return getDecodeReduction(scale);
+}
+
 template<typename Dtype>
 void OPDataTransformer<Dtype>::generateDepthLabelMap(Dtype* transformedLabel, const cv::Mat& depth) const
 {
@@ -781,108 +890,6 @@ void OPDataTransformer<Dtype>::generateDepthLabelMap(Dtype* transformedLabel, co
     }
 }
 
-float getNorm(const cv::Point2f& pointA, const cv::Point2f& pointB)
-{
-    const auto difference = pointA - pointB;
-    return std::sqrt(difference.x*difference.x + difference.y*difference.y);
-}
-
-void maskHands(cv::Mat& maskMiss, const std::vector<float>& isVisible, const std::vector<cv::Point2f>& points,
-              const float stride, const float ratio)
-{
-    for (auto part = 0 ; part < 2 ; part++)
-    {
-        const auto shoulderIndex = (part == 0 ? 5:2);
-        const auto elbowIndex = shoulderIndex+1;
-        const auto wristIndex = elbowIndex+1;
-        if (isVisible.at(shoulderIndex) != 2 && isVisible.at(elbowIndex) != 2 && isVisible.at(wristIndex) != 2)
-        {
-            const auto ratioStride = 1.f / stride;
-            const auto wrist = ratioStride * points.at(wristIndex);
-            const auto elbow = ratioStride * points.at(elbowIndex);
-            const auto shoulder = ratioStride * points.at(shoulderIndex);
-
-            const auto distance = (int)std::round(ratio*std::max(getNorm(wrist, elbow), getNorm(elbow, shoulder)));
-            const cv::Point momentum = (wrist-elbow)*0.25f;
-            cv::Rect roi{(int)std::round(wrist.x + momentum.x - distance /*- wrist.x/2.f*/),
-                         (int)std::round(wrist.y + momentum.y - distance /*- wrist.y/2.f*/),
-                         2*distance, 2*distance};
-            // Apply ROI
-            keepRoiInside(roi, maskMiss.size());
-            if (roi.area() > 0)
-                maskMiss(roi).setTo(0.f); // For debugging use 0.5f
-        }
-        // // If there is no visible desired keypoints, mask out the whole background
-        // else
-        //     maskMiss.setTo(0.f); // For debugging use 0.5f
-    }
-}
-
-void maskFeet(cv::Mat& maskMiss, const std::vector<float>& isVisible, const std::vector<cv::Point2f>& points,
-              const float stride, const float ratio)
-{
-    for (auto part = 0 ; part < 2 ; part++)
-    {
-        const auto kneeIndex = 9+part*5;
-        const auto ankleIndex = kneeIndex+1;
-        if (isVisible.at(kneeIndex) != 2 && isVisible.at(ankleIndex) != 2)
-        {
-            const auto ratioStride = 1.f / stride;
-            const auto knee = ratioStride * points.at(kneeIndex);
-            const auto ankle = ratioStride * points.at(ankleIndex);
-            const auto distance = (int)std::round(ratio*getNorm(knee, ankle));
-            const cv::Point momentum = (ankle-knee)*0.15f;
-            cv::Rect roi{(int)std::round(ankle.x + momentum.x)-distance,
-                         (int)std::round(ankle.y + momentum.y)-distance,
-                         2*distance, 2*distance};
-            // Apply ROI
-            keepRoiInside(roi, maskMiss.size());
-            if (roi.area() > 0)
-                maskMiss(roi).setTo(0.f); // For debugging use 0.5f
-        }
-        // // If there is no visible desired keypoints, mask out the whole background
-        // else
-        //     maskMiss.setTo(0.f); // For debugging use 0.5f
-    }
-}
-
-template<typename Dtype>
-void fillMaskChannels(Dtype* transformedLabel, const int gridX, const int gridY, const int numberTotalChannels,
-                      const int channelOffset, const cv::Mat& maskMiss)
-{
-    // Initialize labels to [0, 1] (depending on maskMiss)
-    // // Naive version (very slow)
-    // for (auto gY = 0; gY < gridY; gY++)
-    // {
-    //     const auto yOffset = gY*gridX;
-    //     for (auto gX = 0; gX < gridX; gX++)
-    //     {
-    //         const auto xyOffset = yOffset + gX;
-    //         const float weight = float(maskMiss.at<uchar>(gY, gX)) / 255.f;
-    //         // Body part & PAFs & background channel & distance
-    //         for (auto part = 0; part < numberTotalChannels; part++)
-    //         // // For Distance
-    //         // for (auto part = 0; part < numberTotalChannels - numberPafChannels/2; part++)
-    //             transformedLabel[part*channelOffset + xyOffset] = weight;
-    //     }
-    // }
-    // OpenCV wrapper: ~10x speed up with baseline
-    cv::Mat maskMissFloat;
-    const auto type = getType(Dtype(0));
-    maskMiss.convertTo(maskMissFloat, type);
-    maskMissFloat /= Dtype(255.f);
-    // // For Distance
-    // for (auto part = 0; part < numberTotalChannels - numberPafChannels/2; part++)
-    for (auto part = 0; part < numberTotalChannels; part++)
-    {
-        auto* pointer = &transformedLabel[part*channelOffset];
-        cv::Mat transformedLabel(gridY, gridX, type, (unsigned char*)(pointer));
-        // // Not exactly 0 for limited floating precission
-        // CHECK_LT(std::abs(cv::norm(transformedLabel-maskMissFloat)), 1e-6);
-        maskMissFloat.copyTo(transformedLabel);
-    }
-}
-
 template<typename Dtype>
 void OPDataTransformer<Dtype>::generateLabelMap(Dtype* transformedLabel, const cv::Size& imageSize, const cv::Mat& maskMiss,
                                                 const MetaData& metaData) const
@@ -1046,211 +1053,14 @@ void OPDataTransformer<Dtype>::generateLabelMap(Dtype* transformedLabel, const c
         }
     }
 
-    // PAFs
-    const auto& labelMapA = getPafIndexA(mPoseModel);
-    const auto& labelMapB = getPafIndexB(mPoseModel);
-    const auto threshold = 1;
-    const auto diagonal = sqrt(gridX*gridX + gridY*gridY);
-    const auto diagonalProportion = (mCurrentEpoch > 0 ? 1.f : metaData.writeNumber/(float)metaData.totalWriteNumber);
-    for (auto i = 0 ; i < labelMapA.size() ; i++)
-    {
-        cv::Mat count = cv::Mat::zeros(gridY, gridX, CV_8UC1);
-        // Self
-        const auto& joints = metaData.jointsSelf;
-        if (joints.isVisible[labelMapA[i]] <= 1 && joints.isVisible[labelMapB[i]] <= 1)
-        {
-            putVectorMaps(transformedLabel + (numberTotalChannels + 2*i)*channelOffset,
-                          transformedLabel + (numberTotalChannels + 2*i + 1)*channelOffset,
-                          transformedLabel + 2*i*channelOffset,
-                          transformedLabel + (2*i + 1)*channelOffset,
-                          // // For Distance
-                          // transformedLabel + (2*numberTotalChannels - numberPafChannels/2 + i)*channelOffset,
-                          // transformedLabel + (numberTotalChannels - numberPafChannels/2 + i)*channelOffset,
-                          count, joints.points[labelMapA[i]], joints.points[labelMapB[i]],
-                          param_.stride(), gridX, gridY, param_.sigma(), threshold,
-                          diagonal, diagonalProportion);
-        }
-
-        // For every other person
-        for (auto otherPerson = 0; otherPerson < metaData.numberOtherPeople; otherPerson++)
-        {
-            const auto& joints = metaData.jointsOthers[otherPerson];
-            if (joints.isVisible[labelMapA[i]] <= 1 && joints.isVisible[labelMapB[i]] <= 1)
-            {
-                putVectorMaps(transformedLabel + (numberTotalChannels + 2*i)*channelOffset,
-                              transformedLabel + (numberTotalChannels + 2*i + 1)*channelOffset,
-                              transformedLabel + 2*i*channelOffset,
-                              transformedLabel + (2*i + 1)*channelOffset,
-                              // // For Distance
-                              // transformedLabel + (2*numberTotalChannels - numberPafChannels/2 + i)*channelOffset,
-                              // transformedLabel + (numberTotalChannels - numberPafChannels/2 + i)*channelOffset,
-                              count, joints.points[labelMapA[i]], joints.points[labelMapB[i]],
-                              param_.stride(), gridX, gridY, param_.sigma(), threshold,
-                              diagonal, diagonalProportion);
-            }
-        }
-    }
-    // // Re-normalize masks (otherwise PAF explodes)
-    // const auto finalImageArea = gridX*gridY;
-    // for (auto i = 0 ; i < labelMapA.size() ; i++)
-    // {
-    //     auto* initPoint = &transformedLabel[2*i*channelOffset];
-    //     const auto accumulation = std::accumulate(initPoint, initPoint+channelOffset, 0);
-    //     const auto ratio = finalImageArea / (float)accumulation;
-    //     if (ratio > 1.01 || ratio < 0.99)
-    //         std::transform(initPoint, initPoint + 2*channelOffset, initPoint, std::bind1st(std::multiplies<Dtype>(), ratio)) ;
-    // }
-
-    // Body parts
-    for (auto part = 0; part < numberBodyParts; part++)
-    {
-        // Self
-        if (metaData.jointsSelf.isVisible[part] <= 1)
-        {
-            const auto& centerPoint = metaData.jointsSelf.points[part];
-            putGaussianMaps(transformedLabel + (part+numberTotalChannels+numberPafChannels)*channelOffset,
-                            centerPoint, param_.stride(), gridX, gridY, param_.sigma());
-        }
-        // For every other person
-        for (auto otherPerson = 0; otherPerson < metaData.numberOtherPeople; otherPerson++)
-        {
-            if (metaData.jointsOthers[otherPerson].isVisible[part] <= 1)
-            {
-                const auto& centerPoint = metaData.jointsOthers[otherPerson].points[part];
-                putGaussianMaps(transformedLabel + (part+numberTotalChannels+numberPafChannels)*channelOffset,
-                                centerPoint, param_.stride(), gridX, gridY, param_.sigma());
-            }
-        }
-    }
-
-    // Background channel
-    // Naive implementation
-    for (auto gY = 0; gY < gridY; gY++)
-    {
-        const auto yOffset = gY*gridX;
-        for (auto gX = 0; gX < gridX; gX++)
-        {
-            const auto xyOffset = yOffset + gX;
-            Dtype maximum = 0.;
-            const auto backgroundIndex = numberTotalChannels+numberPafChannels+numberBodyParts;
-            for (auto part = numberTotalChannels+numberPafChannels ; part < backgroundIndex ; part++)
-            {
-                const auto index = part * channelOffset + xyOffset;
-                maximum = (maximum > transformedLabel[index]) ? maximum : transformedLabel[index];
-            }
-            transformedLabel[backgroundIndex*channelOffset + xyOffset] = std::max(Dtype(1.)-maximum, Dtype(0.));
-        }
-    }
-}
-
-template<typename Dtype>
-void OPDataTransformer<Dtype>::putGaussianMaps(Dtype* entry, const cv::Point2f& centerPoint, const int stride,
-                                               const int gridX, const int gridY, const float sigma) const
-{
-    //LOG(INFO) << "putGaussianMaps here we start for " << centerPoint.x << " " << centerPoint.y;
-    const Dtype start = stride/2.f - 0.5f; //0 if stride = 1, 0.5 if stride = 2, 1.5 if stride = 4, ...
-    const auto multiplier = 2.0 * sigma * sigma;
-    for (auto gY = 0; gY < gridY; gY++)
-    {
-        const auto yOffset = gY*gridX;
-        const Dtype y = start + gY * stride;
-        const auto yMenosCenterPointSquared = (y-centerPoint.y)*(y-centerPoint.y);
-        for (auto gX = 0; gX < gridX; gX++)
-        {
-            const Dtype x = start + gX * stride;
-            const Dtype d2 = (x-centerPoint.x)*(x-centerPoint.x) + yMenosCenterPointSquared;
-            const Dtype exponent = d2 / multiplier;
-            //ln(100) = -ln(1%)
-            if (exponent <= 4.6052)
-            {
-                const auto xyOffset = yOffset + gX;
-                // Option a) Max
-                entry[xyOffset] = std::min(Dtype(1), std::max(entry[xyOffset], std::exp(-exponent)));
-                // // Option b) Average
-                // entry[xyOffset] += std::exp(-exponent);
-                // if (entry[xyOffset] > 1)
-                //     entry[xyOffset] = 1;
-            }
-        }
-    }
+    // PAFs, body parts and background channel (self + every other person)
+    std::vector<Joints> people{metaData.jointsSelf};
+    people.insert(people.end(), metaData.jointsOthers.begin(),
+                  metaData.jointsOthers.begin() + metaData.numberOtherPeople);
+    const LabelRenderingParameters labelRenderingParameters{gridX, gridY, stride, param_.sigma(), 1};
+    renderLabels(transformedLabel + numberTotalChannels*channelOffset, people, mPoseModel, labelRenderingParameters);
 }
 
-template<typename Dtype>
-void OPDataTransformer<Dtype>::putVectorMaps(Dtype* entryX, Dtype* entryY, Dtype* maskX, Dtype* maskY,
-                                             cv::Mat& count, const cv::Point2f& centerA,
-                                             const cv::Point2f& centerB, const int stride, const int gridX,
-                                             const int gridY, const float sigma, const int threshold,
-                                             const int diagonal, const float diagonalProportion) const
-// void OPDataTransformer<Dtype>::putVectorMaps(Dtype* entryX, Dtype* entryY, Dtype* entryD, Dtype* entryDMask,
-//                                              cv::Mat& count, const cv::Point2f& centerA,
-//                                              const cv::Point2f& centerB, const int stride, const int gridX,
-//                                              const int gridY, const float sigma, const int threshold) const
-{
-    const auto scaleLabel = Dtype(1)/Dtype(stride);
-    const auto centerALabelScale = scaleLabel * centerA;
-    const auto centerBLabelScale = scaleLabel * centerB;
-    cv::Point2f directionAB = centerBLabelScale - centerALabelScale;
-    const auto distanceAB = std::sqrt(directionAB.x*directionAB.x + directionAB.y*directionAB.y);
-    directionAB *= (Dtype(1) / distanceAB);
-
-    // // For Distance
-    // const auto dMin = Dtype(0);
-    // const auto dMax = Dtype(std::sqrt(gridX*gridX + gridY*gridY));
-    // const auto dRange = dMax - dMin;
-    // const auto entryDValue = 2*(distanceAB - dMin)/dRange - 1; // Main range: [-1, 1], -1 is 0px-distance, 1 is 368 / stride x sqrt(2) px of distance
-
-    // If PAF is not 0 or NaN (e.g. if PAF perpendicular to image plane)
-    if (!isnan(directionAB.x) && !isnan(directionAB.y))
-    {
-        const int minX = std::max(0,
-                                  int(std::round(std::min(centerALabelScale.x, centerBLabelScale.x) - threshold)));
-        const int maxX = std::min(gridX,
-                                  int(std::round(std::max(centerALabelScale.x, centerBLabelScale.x) + threshold)));
-        const int minY = std::max(0,
-                                  int(std::round(std::min(centerALabelScale.y, centerBLabelScale.y) - threshold)));
-        const int maxY = std::min(gridY,
-                                  int(std::round(std::max(centerALabelScale.y, centerBLabelScale.y) + threshold)));
-(void)diagonalProportion;
-(void)diagonal;
-(void)entryX;
-(void)entryY;
-        // const auto weight = (1-diagonalProportion) + diagonalProportion * diagonal/distanceAB; // alpha*1 + (1-alpha)*realProportion
-        for (auto gY = minY; gY < maxY; gY++)
-        {
-            const auto yOffset = gY*gridX;
-            const auto gYMenosCenterALabelScale = gY - centerALabelScale.y;
-            for (auto gX = minX; gX < maxX; gX++)
-            {
-                const auto xyOffset = yOffset + gX;
-                const cv::Point2f ba{gX - centerALabelScale.x, gYMenosCenterALabelScale};
-                const float distance = std::abs(ba.x*directionAB.y - ba.y*directionAB.x);
-                if (distance <= threshold)
-                {
-                    auto& counter = count.at<uchar>(gY, gX);
-                    if (counter == 0)
-                    {
-                        entryX[xyOffset] = directionAB.x;
-                        entryY[xyOffset] = directionAB.y;
-                        // Weight makes small PAFs as important as big PAFs
-                        // maskX[xyOffset] *= weight;
-                        // maskY[xyOffset] *= weight;
-                        // // For Distance
-                        // entryD[xyOffset] = entryDValue;
-                        // entryDMask[xyOffset] = Dtype(1);
-                    }
-                    else
-                    {
-                        entryX[xyOffset] = (entryX[xyOffset]*counter + directionAB.x) / (counter + 1);
-                        entryY[xyOffset] = (entryY[xyOffset]*counter + directionAB.y) / (counter + 1);
-                        // // For Distance
-                        // entryD[xyOffset] = (entryD[xyOffset]*counter + entryDValue) / (counter + 1);
-                    }
-                    counter++;
-                }
-            }
-        }
-    }
-}
 // OpenPose: added end
 
 INSTANTIATE_CLASS(OPDataTransformer);
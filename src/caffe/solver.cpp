@@ -4,6 +4,7 @@
 #include <vector>
 
 #include "boost/algorithm/string.hpp"
+#include "caffe/layers/base_data_layer.hpp"
 #include "caffe/solver.hpp"
 #include "caffe/util/format.hpp"
 #include "caffe/util/hdf5.hpp"
@@ -260,6 +261,7 @@ void Solver<Dtype>::Step(int iters) {
               << result_vec[k] << loss_msg_stream.str();
         }
       }
+      DisplayPrefetchStats();
     }
     for (int i = 0; i < callbacks_.size(); ++i) {
       callbacks_[i]->on_gradients_ready();
@@ -336,6 +338,24 @@ void Solver<Dtype>::Solve(const char* resume_file) {
   LOG(INFO) << "Optimization Done.";
 }
 
+// Time the train net data layers made Forward wait since the last display
+template <typename Dtype>
+void Solver<Dtype>::DisplayPrefetchStats() {
+  const vector<shared_ptr<Layer<Dtype> > >& layers = net_->layers();
+  for (int i = 0; i < layers.size(); ++i) {
+    BasePrefetchingDataLayer<Dtype>* data_layer =
+        dynamic_cast<BasePrefetchingDataLayer<Dtype>*>(layers[i].get());
+    if (data_layer) {
+      const typename BasePrefetchingDataLayer<Dtype>::PrefetchStats stats =
+          data_layer->prefetch_stats();
+      LOG_IF(INFO, Caffe::root_solver()) << "    Prefetch "
+          << net_->layer_names()[i] << ": " << stats.depth << " batches, "
+          << "Forward waited " << 100 * stats.stall_ratio << "%, prefetch "
+          << "threads waited " << 100 * stats.loader_wait_ratio << "%";
+    }
+  }
+}
+
 template <typename Dtype>
 void Solver<Dtype>::TestAll() {
   for (int test_net_id = 0;
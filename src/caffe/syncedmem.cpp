@@ -1,11 +1,24 @@
+#include <atomic>
+
 #include "caffe/common.hpp"
 #include "caffe/syncedmem.hpp"
 #include "caffe/util/math_functions.hpp"
 
 namespace caffe {
+
+namespace {
+
+uint64_t NextVersion() {
+  static std::atomic<uint64_t> version(0);
+  return version.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+}  // namespace
+
 SyncedMemory::SyncedMemory()
   : cpu_ptr_(NULL), gpu_ptr_(NULL), size_(0), head_(UNINITIALIZED),
-    own_cpu_data_(false), cpu_malloc_use_cuda_(false), own_gpu_data_(false) {
+    own_cpu_data_(false), cpu_malloc_use_cuda_(false), own_gpu_data_(false),
+    version_(NextVersion()) {
 #ifndef CPU_ONLY
 #ifdef DEBUG
   CUDA_CHECK(cudaGetDevice(&device_));
@@ -15,7 +28,8 @@ SyncedMemory::SyncedMemory()
 
 SyncedMemory::SyncedMemory(size_t size)
   : cpu_ptr_(NULL), gpu_ptr_(NULL), size_(size), head_(UNINITIALIZED),
-    own_cpu_data_(false), cpu_malloc_use_cuda_(false), own_gpu_data_(false) {
+    own_cpu_data_(false), cpu_malloc_use_cuda_(false), own_gpu_data_(false),
+    version_(NextVersion()) {
 #ifndef CPU_ONLY
 #ifdef DEBUG
   CUDA_CHECK(cudaGetDevice(&device_));
@@ -39,12 +53,17 @@ SyncedMemory::~SyncedMemory() {
 inline void SyncedMemory::to_cpu() {
   check_device();
   switch (head_) {
-  case UNINITIALIZED:
-    CaffeMallocHost(&cpu_ptr_, size_, &cpu_malloc_use_cuda_);
-    caffe_memset(size_, 0, cpu_ptr_);
+  case UNINITIALIZED: {
+    bool zeroed = false;
+    CaffeMallocHost(&cpu_ptr_, size_, &cpu_malloc_use_cuda_, &zeroed);
+    // Clearing fresh mappings would fault in all their pages on this thread
+    if (!zeroed) {
+      caffe_memset(size_, 0, cpu_ptr_);
+    }
     head_ = HEAD_AT_CPU;
     own_cpu_data_ = true;
     break;
+  }
   case HEAD_AT_GPU:
 #ifndef CPU_ONLY
     if (cpu_ptr_ == NULL) {
@@ -105,6 +124,7 @@ void SyncedMemory::set_cpu_data(void* data) {
   cpu_ptr_ = data;
   head_ = HEAD_AT_CPU;
   own_cpu_data_ = false;
+  version_ = NextVersion();
 }
 
 const void* SyncedMemory::gpu_data() {
@@ -128,6 +148,7 @@ void SyncedMemory::set_gpu_data(void* data) {
   gpu_ptr_ = data;
   head_ = HEAD_AT_GPU;
   own_gpu_data_ = false;
+  version_ = NextVersion();
 #else
   NO_GPU;
 #endif
@@ -137,6 +158,7 @@ void* SyncedMemory::mutable_cpu_data() {
   check_device();
   to_cpu();
   head_ = HEAD_AT_CPU;
+  version_ = NextVersion();
   return cpu_ptr_;
 }
 
@@ -145,6 +167,7 @@ void* SyncedMemory::mutable_gpu_data() {
 #ifndef CPU_ONLY
   to_gpu();
   head_ = HEAD_AT_GPU;
+  version_ = NextVersion();
   return gpu_ptr_;
 #else
   NO_GPU;
@@ -1,3 +1,4 @@
+#include <cmath>
 #include <vector>
 
 #include "gtest/gtest.h"
@@ -59,6 +60,60 @@ TYPED_TEST(BlobSimpleTest, TestReshapeZero) {
   EXPECT_EQ(this->blob_->count(), 0);
 }
 
+TYPED_TEST(BlobSimpleTest, TestLazyDiff) {
+  Blob<TypeParam> blob(2, 3, 4, 5);
+  EXPECT_EQ(blob.count() * sizeof(TypeParam), blob.diff()->size());
+  blob.set_lazy_diff(true);
+  blob.mutable_cpu_data();
+  // Not created by reads or ShareDiff
+  EXPECT_EQ(0, blob.asum_diff());
+  Blob<TypeParam> shared(2, 3, 4, 5);
+  shared.set_lazy_diff(true);
+  shared.ShareDiff(blob);
+  EXPECT_EQ(0, shared.sumsq_diff());
+  // Created when first written, zero-initialized
+  TypeParam* diff = blob.mutable_cpu_diff();
+  for (int i = 0; i < blob.count(); ++i) {
+    EXPECT_EQ(0, diff[i]);
+  }
+  EXPECT_EQ(blob.count() * sizeof(TypeParam), blob.diff()->size());
+  EXPECT_EQ(diff, blob.cpu_diff());
+  diff[0] = 1;
+  shared.ShareDiff(blob);
+  EXPECT_EQ(blob.diff(), shared.diff());
+  // Dropped by a growing reshape
+  blob.Reshape(2, 3, 4, 6);
+  EXPECT_EQ(0, blob.asum_diff());
+  EXPECT_EQ(1, shared.cpu_diff()[0]);
+}
+
+TYPED_TEST(BlobSimpleTest, TestReshapePooled) {
+  Caffe::set_mode(Caffe::CPU);
+  shared_ptr<HostAllocator> default_allocator = GetHostAllocator();
+  shared_ptr<PooledHostAllocator> pool(
+      new PooledHostAllocator(default_allocator));
+  SetHostAllocator(pool);
+  // Variable-size inputs: every iteration grows a new blob batch by batch
+  size_t first_iteration_misses = 0;
+  for (int iteration = 0; iteration < 3; ++iteration) {
+    Blob<TypeParam> blob;
+    for (int height = 10; height <= 40; height += 10) {
+      blob.Reshape(2, 3, height, 20);
+      blob.mutable_cpu_data();
+      blob.mutable_cpu_diff();
+    }
+    if (iteration == 0) {
+      first_iteration_misses = pool->stats().misses;
+    }
+  }
+  // No allocation once the pool is warm
+  EXPECT_EQ(first_iteration_misses, pool->stats().misses);
+  EXPECT_GE(pool->stats().hits, 2 * 4 * 2);
+  EXPECT_EQ(0, pool->stats().in_use_bytes);
+  SetHostAllocator(default_allocator);
+  pool->Trim();
+}
+
 TYPED_TEST(BlobSimpleTest, TestLegacyBlobProtoShapeEquals) {
   BlobProto blob_proto;
 
@@ -112,6 +167,39 @@ TYPED_TEST(BlobSimpleTest, TestLegacyBlobProtoShapeEquals) {
   EXPECT_FALSE(this->blob_->ShapeEquals(blob_proto));
 }
 
+TYPED_TEST(BlobSimpleTest, TestHalfProto) {
+  FillerParameter filler_param;
+  filler_param.set_std(10);
+  GaussianFiller<TypeParam> filler(filler_param);
+  filler.Fill(this->blob_preshaped_);
+  TypeParam* data = this->blob_preshaped_->mutable_cpu_data();
+  // Exactly representable in both formats
+  data[0] = 0;
+  data[1] = -2.5;
+  data[2] = 1024;
+  const int count = this->blob_preshaped_->count();
+  const HalfFormat formats[] = {BFLOAT16, FLOAT16};
+  // The relative rounding error, half an ulp
+  const TypeParam epsilons[] = {1. / 256, 1. / 2048};
+  for (int f = 0; f < 2; ++f) {
+    BlobProto proto;
+    this->blob_preshaped_->ToHalfProto(&proto, formats[f]);
+    EXPECT_EQ(2 * count, proto.half_data().size());
+    EXPECT_EQ(0, proto.data_size());
+    this->blob_->FromProto(proto);
+    EXPECT_TRUE(this->blob_->shape() == this->blob_preshaped_->shape());
+    const TypeParam* result = this->blob_->cpu_data();
+    EXPECT_EQ(0, result[0]);
+    EXPECT_EQ(-2.5, result[1]);
+    EXPECT_EQ(1024, result[2]);
+    for (int i = 0; i < count; ++i) {
+      // Absolute below the smallest normal float16
+      EXPECT_NEAR(data[i], result[i],
+          std::fabs(data[i]) * epsilons[f] + 1e-7);
+    }
+  }
+}
+
 template <typename TypeParam>
 class BlobMathTest : public MultiDeviceTest<TypeParam> {
   typedef typename TypeParam::Dtype Dtype;
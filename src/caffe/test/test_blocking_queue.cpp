@@ -0,0 +1,124 @@
+#include <boost/thread.hpp>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "caffe/common.hpp"
+#include "caffe/layers/base_data_layer.hpp"
+#include "caffe/util/blocking_queue.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+class BlockingQueueTest : public ::testing::Test {
+ public:
+  BlockingQueueTest() : batches_(1000) {}
+
+  // Pushes batches_ in order
+  void Produce(BlockingQueue<Batch<float>*>* queue) {
+    for (int i = 0; i < batches_.size(); ++i) {
+      queue->push(&batches_[i]);
+    }
+  }
+
+  vector<Batch<float> > batches_;
+};
+
+TEST_F(BlockingQueueTest, TestFifo) {
+  BlockingQueue<Batch<float>*> queue(4);
+  EXPECT_EQ(4, queue.capacity());
+  Batch<float>* batch = NULL;
+  EXPECT_FALSE(queue.try_pop(&batch));
+  EXPECT_FALSE(queue.try_peek(&batch));
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_TRUE(queue.try_push(&batches_[i]));
+  }
+  EXPECT_FALSE(queue.try_push(&batches_[4]));
+  EXPECT_EQ(4, queue.size());
+  EXPECT_EQ(&batches_[0], queue.peek());
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_EQ(&batches_[i], queue.pop());
+  }
+  EXPECT_EQ(0, queue.size());
+  const BlockingQueue<Batch<float>*>::Stats stats = queue.stats();
+  EXPECT_EQ(4, stats.pushes);
+  EXPECT_EQ(4, stats.pops);
+  EXPECT_EQ(0, stats.pop_waits);
+  EXPECT_EQ(0, stats.push_waits);
+}
+
+TEST_F(BlockingQueueTest, TestCapacityRounding) {
+  BlockingQueue<Batch<float>*> queue(5);
+  EXPECT_EQ(8, queue.capacity());
+}
+
+TEST_F(BlockingQueueTest, TestProducerConsumer) {
+  // Small capacity, so both sides wait
+  BlockingQueue<Batch<float>*> queue(2);
+  boost::thread producer(&BlockingQueueTest::Produce, this, &queue);
+  for (int i = 0; i < batches_.size(); ++i) {
+    EXPECT_EQ(&batches_[i], queue.pop());
+  }
+  producer.join();
+  const BlockingQueue<Batch<float>*>::Stats stats = queue.stats();
+  EXPECT_EQ(batches_.size(), stats.pushes);
+  EXPECT_EQ(batches_.size(), stats.pops);
+  EXPECT_GE(stats.pop_wait_seconds, 0);
+  EXPECT_GE(stats.push_wait_seconds, 0);
+}
+
+TEST_F(BlockingQueueTest, TestMultipleProducers) {
+  BlockingQueue<Batch<float>*> queue(8);
+  const int producer_count = 3;
+  boost::thread_group producers;
+  for (int i = 0; i < producer_count; ++i) {
+    producers.create_thread(
+        boost::bind(&BlockingQueueTest::Produce, this, &queue));
+  }
+  // Each batch is received once per producer
+  vector<int> received(batches_.size(), 0);
+  for (int i = 0; i < producer_count * batches_.size(); ++i) {
+    const int index = queue.pop() - &batches_[0];
+    ASSERT_GE(index, 0);
+    ASSERT_LT(index, batches_.size());
+    ++received[index];
+  }
+  producers.join_all();
+  for (int i = 0; i < batches_.size(); ++i) {
+    EXPECT_EQ(producer_count, received[i]);
+  }
+  EXPECT_EQ(0, queue.size());
+}
+
+TEST_F(BlockingQueueTest, TestPopWait) {
+  BlockingQueue<Batch<float>*> queue;
+  boost::thread delayed_push([&queue, this]() {
+    boost::this_thread::sleep(boost::posix_time::milliseconds(20));
+    queue.push(&batches_[0]);
+  });
+  // Empty: the pop waits for the push
+  EXPECT_EQ(&batches_[0], queue.pop());
+  delayed_push.join();
+  const BlockingQueue<Batch<float>*>::Stats stats = queue.stats();
+  EXPECT_EQ(1, stats.pop_waits);
+  EXPECT_GT(stats.pop_wait_seconds, 0.01);
+}
+
+TEST_F(BlockingQueueTest, TestInterruptPop) {
+  BlockingQueue<Batch<float>*> queue;
+  bool interrupted = false;
+  boost::thread consumer([&queue, &interrupted]() {
+    try {
+      queue.pop();
+    } catch (boost::thread_interrupted&) {
+      interrupted = true;
+    }
+  });
+  boost::this_thread::sleep(boost::posix_time::milliseconds(20));
+  consumer.interrupt();
+  consumer.join();
+  EXPECT_TRUE(interrupted);
+}
+
+}  // namespace caffe
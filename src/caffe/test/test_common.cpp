@@ -27,6 +27,28 @@ TEST_F(CommonTest, TestBrewMode) {
   EXPECT_EQ(Caffe::mode(), Caffe::GPU);
 }
 
+TEST_F(CommonTest, TestNumThreads) {
+  EXPECT_GE(Caffe::num_threads(), 1);
+  Caffe::set_num_threads(3);
+#ifdef _OPENMP
+  EXPECT_EQ(Caffe::num_threads(), 3);
+#else
+  EXPECT_EQ(Caffe::num_threads(), 1);
+#endif
+  EXPECT_EQ(Caffe::parallel_threads(10), 1);
+  EXPECT_EQ(Caffe::parallel_threads(1 << 30), Caffe::num_threads());
+  // Each iteration runs once
+  vector<int> runs(1 << 16, 0);
+  CAFFE_PARALLEL_FOR(runs.size())
+  for (int i = 0; i < runs.size(); ++i) {
+    ++runs[i];
+  }
+  for (int i = 0; i < runs.size(); ++i) {
+    EXPECT_EQ(runs[i], 1);
+  }
+  Caffe::set_num_threads(0);
+}
+
 TEST_F(CommonTest, TestRandSeedCPU) {
   SyncedMemory data_a(10 * sizeof(int));
   SyncedMemory data_b(10 * sizeof(int));
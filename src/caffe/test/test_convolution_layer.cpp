@@ -1,3 +1,4 @@
+#include <cmath>
 #include <vector>
 
 #include "gtest/gtest.h"
@@ -5,7 +6,9 @@
 #include "caffe/blob.hpp"
 #include "caffe/common.hpp"
 #include "caffe/filler.hpp"
+#include "caffe/layer_factory.hpp"
 #include "caffe/layers/conv_layer.hpp"
+#include "caffe/util/math_functions.hpp"
 
 #ifdef USE_CUDNN
 #include "caffe/layers/cudnn_conv_layer.hpp"
@@ -495,6 +498,246 @@ TYPED_TEST(ConvolutionLayerTest, TestSimpleConvolutionGroup) {
   }
 }
 
+TYPED_TEST(ConvolutionLayerTest, TestBatchedConvolutionGroup) {
+  typedef typename TypeParam::Dtype Dtype;
+  // 5 images, lowered 4 (float) or 2 (double) at a time
+  Blob<Dtype> bottom(5, 3, 6, 4);
+  FillerParameter filler_param;
+  GaussianFiller<Dtype> filler(filler_param);
+  filler.Fill(&bottom);
+  this->blob_bottom_vec_[0] = &bottom;
+  LayerParameter layer_param;
+  ConvolutionParameter* convolution_param =
+      layer_param.mutable_convolution_param();
+  convolution_param->add_kernel_size(3);
+  convolution_param->add_stride(2);
+  convolution_param->set_num_output(3);
+  convolution_param->set_group(3);
+  convolution_param->set_col_buffer_batch_kb(1);
+  convolution_param->mutable_weight_filler()->set_type("gaussian");
+  convolution_param->mutable_bias_filler()->set_type("constant");
+  convolution_param->mutable_bias_filler()->set_value(0.1);
+  shared_ptr<Layer<Dtype> > layer(
+      new ConvolutionLayer<Dtype>(layer_param));
+  layer->SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  layer->Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+  // Check against reference convolution.
+  caffe_conv(&bottom, convolution_param, layer->blobs(),
+      this->MakeReferenceTop(this->blob_top_));
+  const Dtype* top_data = this->blob_top_->cpu_data();
+  const Dtype* ref_top_data = this->ref_blob_top_->cpu_data();
+  for (int i = 0; i < this->blob_top_->count(); ++i) {
+    EXPECT_NEAR(top_data[i], ref_top_data[i], 1e-4);
+  }
+}
+
+TYPED_TEST(ConvolutionLayerTest, TestGroupedConvolution) {
+  typedef typename TypeParam::Dtype Dtype;
+  Blob<Dtype> bottom(2, 16, 9, 11);
+  FillerParameter filler_param;
+  GaussianFiller<Dtype> filler(filler_param);
+  filler.Fill(&bottom);
+  this->blob_bottom_vec_[0] = &bottom;
+  // Depthwise with 1 and 2 outputs per channel, 2 and 8 (the most for the
+  // grouped CPU kernel) input channels per group
+  const int groups[] = {16, 16, 8, 2};
+  const int num_outputs[] = {16, 32, 8, 4};
+  for (int config = 0; config < 4; ++config) {
+    LayerParameter layer_param;
+    ConvolutionParameter* convolution_param =
+        layer_param.mutable_convolution_param();
+    convolution_param->set_kernel_h(3);
+    convolution_param->set_kernel_w(1 + config);
+    convolution_param->set_stride_h(1 + config % 2);
+    convolution_param->set_stride_w(1 + config / 2);
+    convolution_param->set_pad_h(config);
+    convolution_param->set_pad_w(1);
+    convolution_param->add_dilation(1 + config / 2);
+    convolution_param->set_num_output(num_outputs[config]);
+    convolution_param->set_group(groups[config]);
+    convolution_param->mutable_weight_filler()->set_type("gaussian");
+    convolution_param->mutable_bias_filler()->set_type("gaussian");
+    shared_ptr<Layer<Dtype> > layer(
+        new ConvolutionLayer<Dtype>(layer_param));
+    layer->SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+    layer->Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+    caffe_conv(&bottom, convolution_param, layer->blobs(),
+        this->MakeReferenceTop(this->blob_top_));
+    const Dtype* top_data = this->blob_top_->cpu_data();
+    const Dtype* ref_top_data = this->ref_blob_top_->cpu_data();
+    for (int i = 0; i < this->blob_top_->count(); ++i) {
+      EXPECT_NEAR(top_data[i], ref_top_data[i], 1e-4);
+    }
+  }
+}
+
+TYPED_TEST(ConvolutionLayerTest, TestInt8Convolution) {
+  typedef typename TypeParam::Dtype Dtype;
+  Blob<Dtype> bottom(2, 18, 9, 11);
+  FillerParameter filler_param;
+  filler_param.set_min(-1);
+  filler_param.set_max(2);
+  UniformFiller<Dtype> filler(filler_param);
+  filler.Fill(&bottom);
+  this->blob_bottom_vec_[0] = &bottom;
+  // im2col, 1x1, and groups of more channels than the grouped kernel takes
+  const int kernels[] = {3, 1, 3};
+  const int groups[] = {1, 1, 2};
+  for (int config = 0; config < 3; ++config) {
+    LayerParameter layer_param;
+    layer_param.set_phase(TEST);
+    layer_param.mutable_quantization_param()->set_input_min(-1);
+    layer_param.mutable_quantization_param()->set_input_max(2);
+    ConvolutionParameter* convolution_param =
+        layer_param.mutable_convolution_param();
+    convolution_param->add_kernel_size(kernels[config]);
+    convolution_param->add_pad(kernels[config] / 2);
+    convolution_param->set_num_output(8);
+    convolution_param->set_group(groups[config]);
+    convolution_param->mutable_weight_filler()->set_type("gaussian");
+    convolution_param->mutable_bias_filler()->set_type("gaussian");
+    shared_ptr<Layer<Dtype> > layer(
+        new ConvolutionLayer<Dtype>(layer_param));
+    layer->SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+    layer->Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+    caffe_conv(&bottom, convolution_param, layer->blobs(),
+        this->MakeReferenceTop(this->blob_top_));
+    // Within the rounding of the weights and of the input
+    const Dtype* top_data = this->blob_top_->cpu_data();
+    const Dtype* ref_top_data = this->ref_blob_top_->cpu_data();
+    Dtype error = 0;
+    Dtype norm = 0;
+    for (int i = 0; i < this->blob_top_->count(); ++i) {
+      const Dtype difference = top_data[i] - ref_top_data[i];
+      error += difference * difference;
+      norm += ref_top_data[i] * ref_top_data[i];
+    }
+    if (Caffe::mode() == Caffe::CPU) {
+      EXPECT_GT(error, 0);
+    }
+    EXPECT_LT(std::sqrt(error / norm), 0.02);
+  }
+}
+
+TYPED_TEST(ConvolutionLayerTest, TestWinogradConvolution) {
+  typedef typename TypeParam::Dtype Dtype;
+  // Odd output sizes, so the last tiles are cropped
+  Blob<Dtype> bottom(2, 4, 7, 9);
+  FillerParameter filler_param;
+  GaussianFiller<Dtype> filler(filler_param);
+  filler.Fill(&bottom);
+  this->blob_bottom_vec_[0] = &bottom;
+  for (int tile = 2; tile <= 4; tile += 2) {
+    for (int group = 1; group <= 2; ++group) {
+      LayerParameter layer_param;
+      layer_param.set_type("Convolution");
+      ConvolutionParameter* convolution_param =
+          layer_param.mutable_convolution_param();
+      convolution_param->add_kernel_size(3);
+      convolution_param->add_pad(group - 1);
+      convolution_param->set_num_output(6);
+      convolution_param->set_group(group);
+      convolution_param->set_engine(ConvolutionParameter_Engine_WINOGRAD);
+      convolution_param->set_winograd_tile(tile);
+      convolution_param->mutable_weight_filler()->set_type("gaussian");
+      convolution_param->mutable_bias_filler()->set_type("gaussian");
+      shared_ptr<Layer<Dtype> > layer =
+          LayerRegistry<Dtype>::CreateLayer(layer_param);
+      layer->SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+      // The filters are transformed again after an update
+      for (int pass = 0; pass < 2; ++pass) {
+        if (pass > 0) {
+          caffe_scal(layer->blobs()[0]->count(), Dtype(-2),
+              layer->blobs()[0]->mutable_cpu_data());
+        }
+        layer->Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+        caffe_conv(&bottom, convolution_param, layer->blobs(),
+            this->MakeReferenceTop(this->blob_top_));
+        // F(4x4, 3x3) rounds more than the direct sum
+        const Dtype* top_data = this->blob_top_->cpu_data();
+        const Dtype* ref_top_data = this->ref_blob_top_->cpu_data();
+        for (int i = 0; i < this->blob_top_->count(); ++i) {
+          EXPECT_NEAR(top_data[i], ref_top_data[i], 1e-3);
+        }
+      }
+    }
+  }
+}
+
+TYPED_TEST(ConvolutionLayerTest, TestWinogradFallback) {
+  typedef typename TypeParam::Dtype Dtype;
+  // Stride 2: im2col
+  LayerParameter layer_param;
+  layer_param.set_type("Convolution");
+  ConvolutionParameter* convolution_param =
+      layer_param.mutable_convolution_param();
+  convolution_param->add_kernel_size(3);
+  convolution_param->add_stride(2);
+  convolution_param->set_num_output(4);
+  convolution_param->set_engine(ConvolutionParameter_Engine_WINOGRAD);
+  convolution_param->mutable_weight_filler()->set_type("gaussian");
+  convolution_param->mutable_bias_filler()->set_type("gaussian");
+  shared_ptr<Layer<Dtype> > layer =
+      LayerRegistry<Dtype>::CreateLayer(layer_param);
+  layer->SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  layer->Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+  caffe_conv(this->blob_bottom_, convolution_param, layer->blobs(),
+      this->MakeReferenceTop(this->blob_top_));
+  const Dtype* top_data = this->blob_top_->cpu_data();
+  const Dtype* ref_top_data = this->ref_blob_top_->cpu_data();
+  for (int i = 0; i < this->blob_top_->count(); ++i) {
+    EXPECT_NEAR(top_data[i], ref_top_data[i], 1e-4);
+  }
+}
+
+TYPED_TEST(ConvolutionLayerTest, TestDirectConvolution) {
+  typedef typename TypeParam::Dtype Dtype;
+  Blob<Dtype> bottom(2, 4, 9, 11);
+  FillerParameter filler_param;
+  GaussianFiller<Dtype> filler(filler_param);
+  filler.Fill(&bottom);
+  this->blob_bottom_vec_[0] = &bottom;
+  // Output channels (per group) below, equal to and above the block size,
+  // odd output widths
+  const int num_outputs[] = {6, 16, 10};
+  for (int config = 0; config < 3; ++config) {
+    LayerParameter layer_param;
+    layer_param.set_type("Convolution");
+    ConvolutionParameter* convolution_param =
+        layer_param.mutable_convolution_param();
+    convolution_param->set_kernel_h(3);
+    convolution_param->set_kernel_w(config + 1);
+    convolution_param->set_stride_h(1 + config % 2);
+    convolution_param->set_stride_w(1 + config / 2);
+    convolution_param->set_pad_h(config);
+    convolution_param->set_pad_w(1);
+    convolution_param->add_dilation(1 + config / 2);
+    convolution_param->set_num_output(num_outputs[config]);
+    convolution_param->set_group(1 + config % 2);
+    convolution_param->set_engine(ConvolutionParameter_Engine_DIRECT);
+    convolution_param->mutable_weight_filler()->set_type("gaussian");
+    convolution_param->mutable_bias_filler()->set_type("gaussian");
+    shared_ptr<Layer<Dtype> > layer =
+        LayerRegistry<Dtype>::CreateLayer(layer_param);
+    layer->SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+    // The filters are blocked again after an update
+    for (int pass = 0; pass < 2; ++pass) {
+      if (pass > 0) {
+        caffe_scal(layer->blobs()[0]->count(), Dtype(-2),
+            layer->blobs()[0]->mutable_cpu_data());
+      }
+      layer->Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+      caffe_conv(&bottom, convolution_param, layer->blobs(),
+          this->MakeReferenceTop(this->blob_top_));
+      const Dtype* top_data = this->blob_top_->cpu_data();
+      const Dtype* ref_top_data = this->ref_blob_top_->cpu_data();
+      for (int i = 0; i < this->blob_top_->count(); ++i) {
+        EXPECT_NEAR(top_data[i], ref_top_data[i], 1e-4);
+      }
+    }
+  }
+}
+
 TYPED_TEST(ConvolutionLayerTest, TestSobelConvolution) {
   // Test separable convolution by computing the Sobel operator
   // as a single filter then comparing the result
@@ -690,8 +933,9 @@ TYPED_TEST(ConvolutionLayerTest, TestNDAgainst2D) {
     backward_weight_result_nd.CopyFrom(weights, copy_diff, reshape);
   }
   ASSERT_EQ(result_nd.count(), result_2d.count());
+  // The 2D forward pass sums in another order (grouped CPU kernel)
   for (int i = 0; i < result_2d.count(); ++i)  {
-    EXPECT_EQ(result_2d.cpu_data()[i], result_nd.cpu_data()[i]);
+    EXPECT_NEAR(result_2d.cpu_data()[i], result_nd.cpu_data()[i], 1e-3);
   }
   ASSERT_EQ(backward_result_nd.count(), backward_result_2d.count());
   for (int i = 0; i < backward_result_2d.count(); ++i) {
@@ -811,6 +1055,25 @@ TYPED_TEST(ConvolutionLayerTest, TestGradientGroup) {
       this->blob_top_vec_);
 }
 
+TYPED_TEST(ConvolutionLayerTest, TestGradientBatched) {
+  typedef typename TypeParam::Dtype Dtype;
+  LayerParameter layer_param;
+  ConvolutionParameter* convolution_param =
+      layer_param.mutable_convolution_param();
+  convolution_param->add_kernel_size(3);
+  convolution_param->add_stride(2);
+  convolution_param->add_pad(1);
+  convolution_param->set_num_output(3);
+  convolution_param->set_group(3);
+  convolution_param->set_col_buffer_batch_kb(4);
+  convolution_param->mutable_weight_filler()->set_type("gaussian");
+  convolution_param->mutable_bias_filler()->set_type("gaussian");
+  ConvolutionLayer<Dtype> layer(layer_param);
+  GradientChecker<Dtype> checker(1e-2, 1e-3);
+  checker.CheckGradientExhaustive(&layer, this->blob_bottom_vec_,
+      this->blob_top_vec_);
+}
+
 #ifdef USE_CUDNN
 
 template <typename Dtype>
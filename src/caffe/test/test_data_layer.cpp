@@ -1,8 +1,11 @@
 #ifdef USE_OPENCV
+#include <atomic>
+#include <set>
 #include <string>
 #include <vector>
 
 #include "boost/scoped_ptr.hpp"
+#include "boost/thread.hpp"
 #include "gtest/gtest.h"
 
 #include "caffe/blob.hpp"
@@ -105,6 +108,69 @@ class DataLayerTest : public MultiDeviceTest<TypeParam> {
     }
   }
 
+  void TestReadParallel() {
+    LayerParameter param;
+    param.set_phase(TRAIN);
+    DataParameter* data_param = param.mutable_data_param();
+    const int batch_size = 3;
+    data_param->set_batch_size(batch_size);
+    data_param->set_source(filename_->c_str());
+    data_param->set_backend(backend_);
+    data_param->set_prefetch_threads(3);
+
+    DataLayer<Dtype> layer(param);
+    layer.SetUp(blob_bottom_vec_, blob_top_vec_);
+    // Batches come in DB order whatever the worker that loaded them
+    int label = 0;
+    for (int iter = 0; iter < 100; ++iter) {
+      layer.Forward(blob_bottom_vec_, blob_top_vec_);
+      for (int i = 0; i < batch_size; ++i) {
+        EXPECT_EQ(label, blob_top_label_->cpu_data()[i]);
+        for (int j = 0; j < 24; ++j) {
+          EXPECT_EQ(label, blob_top_data_->cpu_data()[i * 24 + j])
+              << "debug: iter " << iter << " i " << i << " j " << j;
+        }
+        label = (label + 1) % 5;
+      }
+    }
+    // Fixed number of batches without prefetch_max
+    const typename DataLayer<Dtype>::PrefetchStats stats =
+        layer.prefetch_stats();
+    EXPECT_EQ(data_param->prefetch(), stats.depth);
+    EXPECT_GE(stats.stall_ratio, 0);
+    EXPECT_LE(stats.stall_ratio, 1);
+  }
+
+  void TestBatchesReused() {
+    LayerParameter param;
+    param.set_phase(TRAIN);
+    DataParameter* data_param = param.mutable_data_param();
+    const int batch_size = 3;
+    data_param->set_batch_size(batch_size);
+    data_param->set_source(filename_->c_str());
+    data_param->set_backend(backend_);
+
+    DataLayer<Dtype> layer(param);
+    layer.SetUp(blob_bottom_vec_, blob_top_vec_);
+    // Keep references to the tops memory, as a layer sharing them would
+    vector<shared_ptr<SyncedMemory> > held;
+    std::set<const void*> memory;
+    int label = 0;
+    for (int iter = 0; iter < 10 * data_param->prefetch(); ++iter) {
+      layer.Forward(blob_bottom_vec_, blob_top_vec_);
+      held.push_back(blob_top_data_->data());
+      held.push_back(blob_top_label_->data());
+      memory.insert(blob_top_label_->cpu_data());
+      for (int i = 0; i < batch_size; ++i) {
+        EXPECT_EQ(label, blob_top_label_->cpu_data()[i])
+            << "debug: iter " << iter;
+        label = (label + 1) % 5;
+      }
+    }
+    // The batches are released by the next Forward, not reallocated
+    EXPECT_LE(memory.size(), data_param->prefetch());
+  }
+
   void TestSkip() {
     LayerParameter param;
     param.set_phase(TRAIN);
@@ -382,6 +448,18 @@ TYPED_TEST(DataLayerTest, TestReadLevelDB) {
   this->TestRead();
 }
 
+TYPED_TEST(DataLayerTest, TestReadParallelLevelDB) {
+  const bool unique_pixels = false;  // all pixels the same; images different
+  this->Fill(unique_pixels, DataParameter_DB_LEVELDB);
+  this->TestReadParallel();
+}
+
+TYPED_TEST(DataLayerTest, TestBatchesReusedLevelDB) {
+  const bool unique_pixels = false;  // all pixels the same; images different
+  this->Fill(unique_pixels, DataParameter_DB_LEVELDB);
+  this->TestBatchesReused();
+}
+
 TYPED_TEST(DataLayerTest, TestSkipLevelDB) {
   this->Fill(false, DataParameter_DB_LEVELDB);
   this->TestSkip();
@@ -427,6 +505,18 @@ TYPED_TEST(DataLayerTest, TestReadLMDB) {
   this->TestRead();
 }
 
+TYPED_TEST(DataLayerTest, TestReadParallelLMDB) {
+  const bool unique_pixels = false;  // all pixels the same; images different
+  this->Fill(unique_pixels, DataParameter_DB_LMDB);
+  this->TestReadParallel();
+}
+
+TYPED_TEST(DataLayerTest, TestBatchesReusedLMDB) {
+  const bool unique_pixels = false;  // all pixels the same; images different
+  this->Fill(unique_pixels, DataParameter_DB_LMDB);
+  this->TestBatchesReused();
+}
+
 TYPED_TEST(DataLayerTest, TestSkipLMDB) {
   this->Fill(false, DataParameter_DB_LMDB);
   this->TestSkip();
@@ -465,5 +555,118 @@ TYPED_TEST(DataLayerTest, TestReadCropTestLMDB) {
 }
 
 #endif  // USE_LMDB
+
+// Loads empty batches of 256 KB, load_ms after being asked for them, so that
+// the adaptive prefetching can be tested against a given consumer.
+template <typename Dtype>
+class SlowPrefetchingDataLayer : public BasePrefetchingDataLayer<Dtype> {
+ public:
+  explicit SlowPrefetchingDataLayer(const LayerParameter& param)
+      : BasePrefetchingDataLayer<Dtype>(param), load_ms_(0) {}
+  virtual ~SlowPrefetchingDataLayer() { this->StopInternalThread(); }
+  virtual void DataLayerSetUp(const vector<Blob<Dtype>*>& bottom,
+      const vector<Blob<Dtype>*>& top) {
+    const vector<int> shape(1, (256 << 10) / sizeof(Dtype));
+    top[0]->Reshape(shape);
+    for (int i = 0; i < this->prefetch_.size(); ++i) {
+      this->prefetch_[i]->data_.Reshape(shape);
+    }
+  }
+  virtual inline const char* type() const { return "SlowPrefetchingData"; }
+
+  int depth() { return this->prefetch_stats().depth; }
+  void set_load_ms(int load_ms) { load_ms_ = load_ms; }
+
+ protected:
+  virtual void load_batch(Batch<Dtype>* batch) {
+    const int load_ms = load_ms_;
+    boost::this_thread::sleep(boost::posix_time::milliseconds(load_ms));
+  }
+
+  std::atomic<int> load_ms_;
+};
+
+template <typename Dtype>
+class AdaptivePrefetchTest : public ::testing::Test {
+ protected:
+  AdaptivePrefetchTest() : blob_top_data_(new Blob<Dtype>()) {}
+  virtual void SetUp() {
+    Caffe::set_mode(Caffe::CPU);
+    blob_top_vec_.push_back(blob_top_data_);
+    DataParameter* data_param = param_.mutable_data_param();
+    data_param->set_batch_size(1);
+    data_param->set_prefetch(2);
+    data_param->set_prefetch_max(4);
+  }
+  virtual ~AdaptivePrefetchTest() { delete blob_top_data_; }
+
+  // Bursts of 7 Forward calls after a pause, the batches loaded during the
+  // pause are drained and the next ones are waited for
+  void ForwardBursts(SlowPrefetchingDataLayer<Dtype>* layer,
+      const int forwards) {
+    layer->set_load_ms(2);
+    for (int i = 0; i < forwards; ++i) {
+      if (i % 8 == 0) {
+        boost::this_thread::sleep(boost::posix_time::milliseconds(40));
+      }
+      layer->Forward(blob_bottom_vec_, blob_top_vec_);
+    }
+  }
+
+  // Batches loaded at once, Forward never waits
+  void ForwardSlowly(SlowPrefetchingDataLayer<Dtype>* layer,
+      const int forwards) {
+    layer->set_load_ms(0);
+    for (int i = 0; i < forwards; ++i) {
+      boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+      layer->Forward(blob_bottom_vec_, blob_top_vec_);
+    }
+  }
+
+  LayerParameter param_;
+  Blob<Dtype>* const blob_top_data_;
+  vector<Blob<Dtype>*> blob_bottom_vec_;
+  vector<Blob<Dtype>*> blob_top_vec_;
+};
+
+TYPED_TEST_CASE(AdaptivePrefetchTest, TestDtypes);
+
+TYPED_TEST(AdaptivePrefetchTest, TestGrowWhenForwardWaits) {
+  SlowPrefetchingDataLayer<TypeParam> layer(this->param_);
+  layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  EXPECT_EQ(2, layer.depth());
+  // A batch at most is added every 50 Forward calls
+  this->ForwardBursts(&layer, 50);
+  EXPECT_EQ(3, layer.depth());
+  this->ForwardBursts(&layer, 150);
+  EXPECT_EQ(4, layer.depth());
+}
+
+TYPED_TEST(AdaptivePrefetchTest, TestShrinkWhenQueueStaysFull) {
+  SlowPrefetchingDataLayer<TypeParam> layer(this->param_);
+  layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  this->ForwardBursts(&layer, 100);
+  EXPECT_EQ(4, layer.depth());
+  // A batch is removed after 20 quiet periods of 50 Forward calls (the
+  // first one may still see the last waits of the bursts)
+  this->ForwardSlowly(&layer, 900);
+  EXPECT_EQ(4, layer.depth());
+  this->ForwardSlowly(&layer, 200);
+  EXPECT_EQ(3, layer.depth());
+  // Down to prefetch, not below
+  this->ForwardSlowly(&layer, 2000);
+  EXPECT_EQ(2, layer.depth());
+}
+
+TYPED_TEST(AdaptivePrefetchTest, TestMemoryBudget) {
+  // 256 KB batches: 4 fit in 1 MB
+  this->param_.mutable_data_param()->set_prefetch_max(10);
+  this->param_.mutable_data_param()->set_prefetch_max_mb(1);
+  SlowPrefetchingDataLayer<TypeParam> layer(this->param_);
+  layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  this->ForwardBursts(&layer, 200);
+  EXPECT_EQ(4, layer.depth());
+}
+
 }  // namespace caffe
 #endif  // USE_OPENCV
@@ -175,6 +175,51 @@ TYPED_TEST(EltwiseLayerTest, TestSumCoeffGradient) {
       this->blob_top_vec_);
 }
 
+TYPED_TEST(EltwiseLayerTest, TestSumCoeffInPlace) {
+  typedef typename TypeParam::Dtype Dtype;
+  LayerParameter layer_param;
+  EltwiseParameter* eltwise_param = layer_param.mutable_eltwise_param();
+  eltwise_param->set_operation(EltwiseParameter_EltwiseOp_SUM);
+  eltwise_param->add_coeff(1.5);
+  eltwise_param->add_coeff(-0.5);
+  eltwise_param->add_coeff(2);
+  // Reference
+  EltwiseLayer<Dtype> layer(layer_param);
+  layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+  Blob<Dtype> top;
+  top.CopyFrom(*this->blob_top_, false, true);
+  FillerParameter filler_param;
+  UniformFiller<Dtype> filler(filler_param);
+  filler.Fill(this->blob_top_);
+  caffe_copy(this->blob_top_->count(), this->blob_top_->cpu_data(),
+      this->blob_top_->mutable_cpu_diff());
+  vector<bool> propagate_down(this->blob_bottom_vec_.size(), true);
+  layer.Backward(this->blob_top_vec_, propagate_down, this->blob_bottom_vec_);
+  Blob<Dtype> diff_b;
+  diff_b.CopyFrom(*this->blob_bottom_b_, true, true);
+  // In place in bottom a
+  Blob<Dtype> diff_a;
+  diff_a.CopyFrom(*this->blob_bottom_a_, true, true);
+  vector<Blob<Dtype>*> top_vec(1, this->blob_bottom_a_);
+  EltwiseLayer<Dtype> in_place_layer(layer_param);
+  in_place_layer.SetUp(this->blob_bottom_vec_, top_vec);
+  in_place_layer.Forward(this->blob_bottom_vec_, top_vec);
+  const int count = top.count();
+  for (int i = 0; i < count; ++i) {
+    EXPECT_NEAR(top.cpu_data()[i], this->blob_bottom_a_->cpu_data()[i], 1e-5);
+  }
+  caffe_copy(count, this->blob_top_->cpu_diff(),
+      this->blob_bottom_a_->mutable_cpu_diff());
+  in_place_layer.Backward(top_vec, propagate_down, this->blob_bottom_vec_);
+  for (int i = 0; i < count; ++i) {
+    EXPECT_NEAR(diff_a.cpu_diff()[i], this->blob_bottom_a_->cpu_diff()[i],
+        1e-5);
+    EXPECT_NEAR(diff_b.cpu_diff()[i], this->blob_bottom_b_->cpu_diff()[i],
+        1e-5);
+  }
+}
+
 TYPED_TEST(EltwiseLayerTest, TestMax) {
   typedef typename TypeParam::Dtype Dtype;
   LayerParameter layer_param;
@@ -1,3 +1,4 @@
+#include <cmath>
 #include <vector>
 
 #include "gtest/gtest.h"
@@ -208,6 +209,50 @@ TYPED_TEST(InnerProductLayerTest, TestForwardTranspose) {
   }
 }
 
+TYPED_TEST(InnerProductLayerTest, TestForwardInt8) {
+  typedef typename TypeParam::Dtype Dtype;
+  this->blob_bottom_vec_.push_back(this->blob_bottom_);
+  for (int transpose = 0; transpose <= 1; ++transpose) {
+    LayerParameter layer_param;
+    layer_param.set_phase(TEST);
+    InnerProductParameter* inner_product_param =
+        layer_param.mutable_inner_product_param();
+    inner_product_param->set_num_output(10);
+    inner_product_param->set_transpose(transpose);
+    inner_product_param->mutable_weight_filler()->set_type("gaussian");
+    inner_product_param->mutable_bias_filler()->set_type("gaussian");
+    shared_ptr<InnerProductLayer<Dtype> > layer(
+        new InnerProductLayer<Dtype>(layer_param));
+    layer->SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+    layer->Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+    Blob<Dtype> expected;
+    expected.CopyFrom(*this->blob_top_, false, true);
+    // The same weights, with the range of the uniform input
+    layer_param.mutable_quantization_param()->set_input_min(0);
+    layer_param.mutable_quantization_param()->set_input_max(1);
+    shared_ptr<InnerProductLayer<Dtype> > int8_layer(
+        new InnerProductLayer<Dtype>(layer_param));
+    int8_layer->SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+    for (int i = 0; i < layer->blobs().size(); ++i) {
+      int8_layer->blobs()[i]->CopyFrom(*layer->blobs()[i]);
+    }
+    int8_layer->Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+    // Within the rounding of the weights and of the input
+    const Dtype* data = this->blob_top_->cpu_data();
+    const Dtype* expected_data = expected.cpu_data();
+    Dtype error = 0;
+    Dtype norm = 0;
+    for (int i = 0; i < expected.count(); ++i) {
+      error += (data[i] - expected_data[i]) * (data[i] - expected_data[i]);
+      norm += expected_data[i] * expected_data[i];
+    }
+    if (Caffe::mode() == Caffe::CPU) {
+      EXPECT_GT(error, 0);
+    }
+    EXPECT_LT(std::sqrt(error / norm), 0.02);
+  }
+}
+
 TYPED_TEST(InnerProductLayerTest, TestForwardNoBatch) {
   typedef typename TypeParam::Dtype Dtype;
   this->blob_bottom_vec_.push_back(this->blob_bottom_nobatch_);
@@ -49,5 +49,28 @@ TEST_F(InternalThreadTest, TestRandomSeed) {
   t3.StopInternalThread();
 }
 
+class TestThreadN : public InternalThread {
+ public:
+  TestThreadN() : entries_(3, 0) {}
+  // Each thread only writes its own entry
+  vector<int> entries_;
+
+ protected:
+  void InternalThreadEntryN(int thread_id) {
+    ++entries_[thread_id];
+  }
+};
+
+TEST_F(InternalThreadTest, TestThreadCount) {
+  TestThreadN thread;
+  thread.StartInternalThread(3);
+  EXPECT_TRUE(thread.is_started());
+  thread.StopInternalThread();
+  EXPECT_FALSE(thread.is_started());
+  for (int i = 0; i < thread.entries_.size(); ++i) {
+    EXPECT_EQ(1, thread.entries_[i]);
+  }
+}
+
 }  // namespace caffe
 
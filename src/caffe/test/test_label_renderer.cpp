@@ -0,0 +1,101 @@
+#ifdef USE_OPENCV
+#include <algorithm>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "caffe/common.hpp"
+#include "caffe/openpose/labelRenderer.hpp"
+#include "caffe/openpose/poseModel.hpp"
+#include "caffe/util/math_functions.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+template <typename Dtype>
+class LabelRendererTest : public ::testing::Test {
+ protected:
+  LabelRendererTest()
+      : pose_model_(PoseModel::COCO_18), people_per_image_(3) {
+    parameters_.gridX = 46;
+    parameters_.gridY = 40;
+    parameters_.stride = 8;
+    parameters_.sigma = 7.f;
+    parameters_.threshold = 1;
+  }
+
+  virtual void SetUp() {
+    Caffe::set_random_seed(1701);
+    // 4 people per image, with keypoints outside of the image and keypoints
+    // not labeled (isVisible 2)
+    const int number_body_parts = getNumberBodyParts(pose_model_);
+    const int number_points = 4 * number_body_parts;
+    for (int image = 0; image < people_per_image_.size(); ++image) {
+      vector<float> x(number_points);
+      vector<float> y(number_points);
+      vector<float> visibility(number_points);
+      caffe_rng_uniform<float>(number_points, -40, 410, x.data());
+      caffe_rng_uniform<float>(number_points, -40, 360, y.data());
+      caffe_rng_uniform<float>(number_points, 0, 3, visibility.data());
+      vector<Joints>& people = people_per_image_[image];
+      people.resize(4);
+      for (int i = 0; i < number_points; ++i) {
+        Joints& joints = people[i / number_body_parts];
+        joints.points.push_back(cv::Point2f(x[i], y[i]));
+        joints.isVisible.push_back(static_cast<int>(visibility[i]));
+      }
+    }
+  }
+
+  // Renders the batch with engine, expecting the Reference labels
+  void CheckEngine(const LabelRenderingEngine engine) {
+    if (!isLabelRenderingEngineSupported(engine)) {
+      LOG(INFO) << "Skipping " << getLabelRenderingEngineName(engine)
+          << ": not supported by this CPU.";
+      return;
+    }
+    const int count = people_per_image_.size()
+        * getNumberBodyBkgAndPAF(pose_model_)
+        * parameters_.gridX * parameters_.gridY;
+    vector<Dtype> reference(count, Dtype(0));
+    renderLabelsBatch(reference.data(), people_per_image_, pose_model_,
+        parameters_, LabelRenderingEngine::Reference);
+    vector<Dtype> labels(count, Dtype(0));
+    renderLabelsBatch(labels.data(), people_per_image_, pose_model_,
+        parameters_, engine);
+    Dtype max_label = 0;
+    for (int i = 0; i < count; ++i) {
+      EXPECT_NEAR(reference[i], labels[i], 1e-5)
+          << getLabelRenderingEngineName(engine) << " at " << i;
+      max_label = std::max(max_label, reference[i]);
+    }
+    // Not an empty rendering
+    EXPECT_GT(max_label, 0.5);
+  }
+
+  const PoseModel pose_model_;
+  LabelRenderingParameters parameters_;
+  vector<vector<Joints> > people_per_image_;
+};
+
+TYPED_TEST_CASE(LabelRendererTest, TestDtypes);
+
+TYPED_TEST(LabelRendererTest, TestScalar) {
+  this->CheckEngine(LabelRenderingEngine::Scalar);
+}
+
+TYPED_TEST(LabelRendererTest, TestAvx2) {
+  this->CheckEngine(LabelRenderingEngine::Avx2);
+}
+
+TYPED_TEST(LabelRendererTest, TestAvx512) {
+  this->CheckEngine(LabelRenderingEngine::Avx512);
+}
+
+TYPED_TEST(LabelRendererTest, TestAuto) {
+  this->CheckEngine(LabelRenderingEngine::Auto);
+}
+
+}  // namespace caffe
+#endif  // USE_OPENCV
@@ -1,6 +1,10 @@
 #include <stdint.h>  // for uint32_t & uint64_t
 #include <time.h>
+#include <algorithm>
 #include <cmath>  // for std::fabs
+#include <cstring>
+#include <limits>
+#include <vector>
 
 #include "gtest/gtest.h"
 
@@ -119,6 +123,180 @@ TYPED_TEST(CPUMathFunctionsTest, TestCopy) {
   }
 }
 
+TYPED_TEST(CPUMathFunctionsTest, TestExp) {
+  const int n = this->blob_bottom_->count();
+  const TypeParam* x = this->blob_bottom_->cpu_data();
+  caffe_exp<TypeParam>(n, x, this->blob_bottom_->mutable_cpu_diff());
+  const TypeParam* y = this->blob_bottom_->cpu_diff();
+  for (int i = 0; i < n; ++i) {
+    EXPECT_NEAR(y[i], std::exp(x[i]), 1e-6 * std::exp(x[i]));
+  }
+}
+
+TYPED_TEST(CPUMathFunctionsTest, TestLog) {
+  const int n = this->blob_bottom_->count();
+  TypeParam* x = this->blob_bottom_->mutable_cpu_data();
+  caffe_abs<TypeParam>(n, x, x);
+  caffe_log<TypeParam>(n, x, this->blob_bottom_->mutable_cpu_diff());
+  const TypeParam* y = this->blob_bottom_->cpu_diff();
+  for (int i = 0; i < n; ++i) {
+    EXPECT_NEAR(y[i], std::log(x[i]), 1e-6 * std::fabs(std::log(x[i])));
+  }
+}
+
+TYPED_TEST(CPUMathFunctionsTest, TestPowx) {
+  const int n = this->blob_bottom_->count();
+  TypeParam* x = this->blob_bottom_->mutable_cpu_data();
+  caffe_abs<TypeParam>(n, x, x);
+  const TypeParam powers[] = {-0.75, 0.5, 2, 3.5};
+  for (int p = 0; p < 4; ++p) {
+    caffe_powx<TypeParam>(n, x, powers[p],
+        this->blob_bottom_->mutable_cpu_diff());
+    const TypeParam* y = this->blob_bottom_->cpu_diff();
+    for (int i = 0; i < n; ++i) {
+      const TypeParam expected = std::pow(x[i], powers[p]);
+      EXPECT_NEAR(y[i], expected, 1e-5 * expected);
+    }
+  }
+}
+
+TYPED_TEST(CPUMathFunctionsTest, TestSigmoidTanh) {
+  const int n = this->blob_bottom_->count();
+  TypeParam* x = this->blob_bottom_->mutable_cpu_data();
+  caffe_scal<TypeParam>(n, 4, x);
+  TypeParam* y = this->blob_bottom_->mutable_cpu_diff();
+  caffe_sigmoid<TypeParam>(n, x, y);
+  for (int i = 0; i < n; ++i) {
+    EXPECT_NEAR(y[i], 1 / (1 + std::exp(-x[i])), 1e-6);
+  }
+  caffe_tanh<TypeParam>(n, x, y);
+  for (int i = 0; i < n; ++i) {
+    EXPECT_NEAR(y[i], std::tanh(x[i]), 1e-6);
+  }
+}
+
+TYPED_TEST(CPUMathFunctionsTest, TestSpecialValues) {
+  const TypeParam inf = std::numeric_limits<TypeParam>::infinity();
+  const TypeParam x[] = {-inf, -1, 0, 100, inf};
+  TypeParam y[5];
+  caffe_exp<TypeParam>(5, x, y);
+  EXPECT_EQ(y[0], 0);
+  EXPECT_EQ(y[2], 1);
+  EXPECT_EQ(y[4], inf);
+  caffe_log<TypeParam>(5, x, y);
+  EXPECT_TRUE(std::isnan(y[1]));
+  EXPECT_EQ(y[2], -inf);
+  EXPECT_EQ(y[4], inf);
+  caffe_powx<TypeParam>(5, x, TypeParam(0.75), y);
+  EXPECT_TRUE(std::isnan(y[1]));
+  EXPECT_EQ(y[2], 0);
+  EXPECT_NEAR(y[3], std::pow(TypeParam(100), TypeParam(0.75)), 1e-4);
+  EXPECT_EQ(y[4], inf);
+  caffe_sigmoid<TypeParam>(5, x, y);
+  EXPECT_EQ(y[0], 0);
+  EXPECT_EQ(y[2], 0.5);
+  EXPECT_EQ(y[4], 1);
+  caffe_tanh<TypeParam>(5, x, y);
+  EXPECT_EQ(y[0], -1);
+  EXPECT_EQ(y[2], 0);
+  EXPECT_EQ(y[4], 1);
+}
+
+// Floats in the order of their values, as consecutive integers
+int64_t FloatOrder(const float x) {
+  int32_t bits;
+  std::memcpy(&bits, &x, sizeof(bits));
+  return bits < 0 ? -static_cast<int64_t>(bits & 0x7fffffff) : bits;
+}
+
+float OrderFloat(const int64_t order) {
+  const int32_t bits = order < 0 ?
+      static_cast<int32_t>(-order | 0x80000000u) : static_cast<int32_t>(order);
+  float x;
+  std::memcpy(&x, &bits, sizeof(x));
+  return x;
+}
+
+double ReferenceExp(const double x) { return std::exp(x); }
+double ReferenceLog(const double x) { return std::log(x); }
+double ReferenceTanh(const double x) { return std::tanh(x); }
+double ReferenceSigmoid(const double x) { return 1 / (1 + std::exp(-x)); }
+
+// Largest error, in units in the last place, of the float function over
+// every 1021st float of [min, max], against the double reference rounded to
+// float
+int64_t MaxUlpError(void (*function)(const int, const float*, float*),
+    double (*reference)(const double), const float min, const float max) {
+  const int64_t step = 1021;
+  const int block = 1 << 16;
+  std::vector<float> x(block);
+  std::vector<float> y(block);
+  int64_t max_error = 0;
+  for (int64_t begin = FloatOrder(min); begin <= FloatOrder(max);
+       begin += block * step) {
+    int n = 0;
+    for (; n < block && begin + n * step <= FloatOrder(max); ++n) {
+      x[n] = OrderFloat(begin + n * step);
+    }
+    function(n, x.data(), y.data());
+    for (int i = 0; i < n; ++i) {
+      const float expected = static_cast<float>(reference(x[i]));
+      int64_t error = FloatOrder(y[i]) - FloatOrder(expected);
+      max_error = std::max(max_error, error < 0 ? -error : error);
+    }
+  }
+  return max_error;
+}
+
+// The errors documented in fast_math.hpp, over the inputs whose results are
+// finite normal floats
+TEST(FastMathTest, TestUlpError) {
+  const float float_max = std::numeric_limits<float>::max();
+#ifndef USE_MKL
+  EXPECT_LE(MaxUlpError(caffe_exp<float>, ReferenceExp, -87.33f, 88.37f), 1);
+  EXPECT_LE(MaxUlpError(caffe_log<float>, ReferenceLog,
+      std::numeric_limits<float>::denorm_min(), float_max), 1);
+#endif
+  EXPECT_LE(MaxUlpError(caffe_tanh<float>, ReferenceTanh, -float_max,
+      float_max), 1);
+  EXPECT_LE(MaxUlpError(caffe_sigmoid<float>, ReferenceSigmoid, -87.33f,
+      float_max), 2);
+}
+
+TYPED_TEST(CPUMathFunctionsTest, TestGemmS8U8S32) {
+  // More columns than a block of the kernel
+  const int M = 5;
+  const int N = 1100;
+  const int K = 37;
+  std::vector<int8_t> A(M * K);
+  std::vector<uint8_t> B(K * N);
+  std::vector<uint8_t> B_transposed(N * K);
+  for (int i = 0; i < A.size(); ++i) {
+    A[i] = static_cast<int8_t>(static_cast<int>(caffe_rng_rand() % 255) - 127);
+  }
+  for (int k = 0; k < K; ++k) {
+    for (int j = 0; j < N; ++j) {
+      B[k * N + j] = B_transposed[j * K + k] =
+          static_cast<uint8_t>(caffe_rng_rand());
+    }
+  }
+  std::vector<int32_t> C(M * N);
+  std::vector<int32_t> C_transposed(M * N);
+  caffe_cpu_gemm_s8u8s32(CblasNoTrans, M, N, K, A.data(), B.data(), C.data());
+  caffe_cpu_gemm_s8u8s32(CblasTrans, M, N, K, A.data(), B_transposed.data(),
+      C_transposed.data());
+  for (int i = 0; i < M; ++i) {
+    for (int j = 0; j < N; ++j) {
+      int32_t expected = 0;
+      for (int k = 0; k < K; ++k) {
+        expected += A[i * K + k] * B[k * N + j];
+      }
+      EXPECT_EQ(expected, C[i * N + j]);
+      EXPECT_EQ(expected, C_transposed[i * N + j]);
+    }
+  }
+}
+
 #ifndef CPU_ONLY
 
 template <typename Dtype>
@@ -629,6 +629,401 @@ class NetTest : public MultiDeviceTest<TypeParam> {
     InitNetFromProtoString(proto);
   }
 
+  virtual void InitActivationMemoryNet(const bool optimize,
+                                       const bool inference_only = false,
+                                       const bool force_backward = false) {
+    // conv1 is split between conv2 and the eltwise layer, so it stays alive
+    // until the end while conv2 and conv3 can reuse each other's memory.
+    string proto =
+        "name: 'ActivationMemoryNetwork' "
+        "state { phase: TEST } "
+        "layer { "
+        "  name: 'data' "
+        "  type: 'Input' "
+        "  top: 'data' "
+        "  input_param { "
+        "  shape: { dim: 2 dim: 3 dim: 10 dim: 10 } "
+        "  } "
+        "} ";
+    const char* convolutions[][2] = {{"data", "conv1"}, {"conv1", "conv2"},
+                                     {"conv2", "conv3"}};
+    for (int i = 0; i < 3; ++i) {
+      proto +=
+          "layer { "
+          "  name: '" + string(convolutions[i][1]) + "' "
+          "  type: 'Convolution' "
+          "  bottom: '" + string(convolutions[i][0]) + "' "
+          "  top: '" + string(convolutions[i][1]) + "' "
+          "  convolution_param { "
+          "    num_output: 4 "
+          "    kernel_size: 3 "
+          "    pad: 1 "
+          "    weight_filler { "
+          "      type: 'gaussian' "
+          "      std: 0.1 "
+          "    } "
+          "    bias_filler { "
+          "      type: 'constant' "
+          "      value: 0.2 "
+          "    } "
+          "  } "
+          "} "
+          "layer { "
+          "  name: 'relu_" + string(convolutions[i][1]) + "' "
+          "  type: 'ReLU' "
+          "  bottom: '" + string(convolutions[i][1]) + "' "
+          "  top: '" + string(convolutions[i][1]) + "' "
+          "} ";
+    }
+    proto +=
+        "layer { "
+        "  name: 'sum' "
+        "  type: 'Eltwise' "
+        "  bottom: 'conv1' "
+        "  bottom: 'conv3' "
+        "  top: 'sum' "
+        "} "
+        "layer { "
+        "  name: 'softmax' "
+        "  type: 'Softmax' "
+        "  bottom: 'sum' "
+        "  top: 'softmax' "
+        "} ";
+    if (optimize) {
+      proto += "optimize_activation_memory: true ";
+    }
+    if (inference_only) {
+      proto += "inference_only: true ";
+    }
+    if (force_backward) {
+      proto += "force_backward: true ";
+    }
+    InitNetFromProtoString(proto);
+  }
+
+  virtual void InitConcatSliceNet(const bool optimize) {
+    // At batch size 1 the bottoms of concat can be views of it, and the tops
+    // of slice views of conv_c.
+    string proto =
+        "name: 'ConcatSliceNetwork' "
+        "state { phase: TEST } "
+        "layer { "
+        "  name: 'data' "
+        "  type: 'Input' "
+        "  top: 'data' "
+        "  input_param { "
+        "  shape: { dim: 1 dim: 3 dim: 6 dim: 5 } "
+        "  } "
+        "} "
+        "layer { "
+        "  name: 'conv_a' "
+        "  type: 'Convolution' "
+        "  bottom: 'data' "
+        "  top: 'conv_a' "
+        "  convolution_param { "
+        "    num_output: 4 "
+        "    kernel_size: 3 "
+        "    pad: 1 "
+        "    weight_filler { "
+        "      type: 'gaussian' "
+        "      std: 0.1 "
+        "    } "
+        "  } "
+        "} "
+        "layer { "
+        "  name: 'relu_a' "
+        "  type: 'ReLU' "
+        "  bottom: 'conv_a' "
+        "  top: 'conv_a' "
+        "} "
+        "layer { "
+        "  name: 'conv_b' "
+        "  type: 'Convolution' "
+        "  bottom: 'conv_a' "
+        "  top: 'conv_b' "
+        "  convolution_param { "
+        "    num_output: 2 "
+        "    kernel_size: 3 "
+        "    pad: 1 "
+        "    weight_filler { "
+        "      type: 'gaussian' "
+        "      std: 0.1 "
+        "    } "
+        "  } "
+        "} "
+        "layer { "
+        "  name: 'concat' "
+        "  type: 'Concat' "
+        "  bottom: 'conv_a' "
+        "  bottom: 'conv_b' "
+        "  top: 'concat' "
+        "} "
+        "layer { "
+        "  name: 'conv_c' "
+        "  type: 'Convolution' "
+        "  bottom: 'concat' "
+        "  top: 'conv_c' "
+        "  convolution_param { "
+        "    num_output: 4 "
+        "    kernel_size: 3 "
+        "    pad: 1 "
+        "    weight_filler { "
+        "      type: 'gaussian' "
+        "      std: 0.1 "
+        "    } "
+        "  } "
+        "} "
+        "layer { "
+        "  name: 'slice' "
+        "  type: 'Slice' "
+        "  bottom: 'conv_c' "
+        "  top: 'slice1' "
+        "  top: 'slice2' "
+        "  slice_param { "
+        "    slice_point: 1 "
+        "  } "
+        "} "
+        "layer { "
+        "  name: 'conv_d' "
+        "  type: 'Convolution' "
+        "  bottom: 'slice2' "
+        "  top: 'conv_d' "
+        "  convolution_param { "
+        "    num_output: 1 "
+        "    kernel_size: 3 "
+        "    pad: 1 "
+        "    weight_filler { "
+        "      type: 'gaussian' "
+        "      std: 0.1 "
+        "    } "
+        "  } "
+        "} "
+        "layer { "
+        "  name: 'sum' "
+        "  type: 'Eltwise' "
+        "  bottom: 'slice1' "
+        "  bottom: 'conv_d' "
+        "  top: 'sum' "
+        "} ";
+    if (optimize) {
+      proto += "optimize_activation_memory: true ";
+    }
+    InitNetFromProtoString(proto);
+  }
+
+  virtual void InitFusedNet(const bool fuse,
+                            const bool force_backward = false) {
+    // bn, scale and relu can be fused into conv, scale2 and relu2 into conv2.
+    string proto =
+        "name: 'FusedNetwork' "
+        "state: { phase: TEST } "
+        "layer { "
+        "  name: 'data' "
+        "  type: 'Input' "
+        "  top: 'data' "
+        "  input_param { "
+        "    shape: { dim: 2 dim: 3 dim: 6 dim: 5 } "
+        "  } "
+        "} "
+        "layer { "
+        "  name: 'conv' "
+        "  type: 'Convolution' "
+        "  bottom: 'data' "
+        "  top: 'conv' "
+        "  convolution_param { "
+        "    num_output: 4 "
+        "    kernel_size: 3 "
+        "    pad: 1 "
+        "    weight_filler { "
+        "      type: 'gaussian' "
+        "      std: 0.1 "
+        "    } "
+        "    bias_filler { "
+        "      type: 'gaussian' "
+        "      std: 0.1 "
+        "    } "
+        "  } "
+        "} "
+        "layer { "
+        "  name: 'bn' "
+        "  type: 'BatchNorm' "
+        "  bottom: 'conv' "
+        "  top: 'conv' "
+        "} "
+        "layer { "
+        "  name: 'scale' "
+        "  type: 'Scale' "
+        "  bottom: 'conv' "
+        "  top: 'conv' "
+        "  scale_param { "
+        "    bias_term: true "
+        "    filler { "
+        "      type: 'gaussian' "
+        "      std: 1 "
+        "    } "
+        "    bias_filler { "
+        "      type: 'gaussian' "
+        "      std: 1 "
+        "    } "
+        "  } "
+        "} "
+        "layer { "
+        "  name: 'relu' "
+        "  type: 'ReLU' "
+        "  bottom: 'conv' "
+        "  top: 'conv' "
+        "} "
+        "layer { "
+        "  name: 'conv2' "
+        "  type: 'Convolution' "
+        "  bottom: 'conv' "
+        "  top: 'conv2' "
+        "  convolution_param { "
+        "    num_output: 5 "
+        "    kernel_size: 1 "
+        "    bias_term: false "
+        "    weight_filler { "
+        "      type: 'gaussian' "
+        "      std: 0.1 "
+        "    } "
+        "  } "
+        "} "
+        "layer { "
+        "  name: 'scale2' "
+        "  type: 'Scale' "
+        "  bottom: 'conv2' "
+        "  top: 'conv2' "
+        "  scale_param { "
+        "    filler { "
+        "      type: 'gaussian' "
+        "      std: 1 "
+        "    } "
+        "  } "
+        "} "
+        "layer { "
+        "  name: 'relu2' "
+        "  type: 'ReLU' "
+        "  bottom: 'conv2' "
+        "  top: 'conv2' "
+        "  relu_param { "
+        "    negative_slope: 0.1 "
+        "  } "
+        "} ";
+    if (fuse) {
+      proto += "fuse_inference_layers: true ";
+    }
+    if (force_backward) {
+      proto += "force_backward: true ";
+    }
+    InitNetFromProtoString(proto);
+  }
+
+  virtual void InitInPlaceNet(const bool optimize) {
+    // bn, scale and relu can be computed in place in conv, sum and sigmoid in
+    // ip. relu2 cannot, the backward of sigmoid reads its top.
+    string proto =
+        "name: 'InPlaceNetwork' "
+        "force_backward: true "
+        "layer { "
+        "  name: 'data' "
+        "  type: 'Input' "
+        "  top: 'data' "
+        "  top: 'offset' "
+        "  top: 'label' "
+        "  input_param { "
+        "    shape: { dim: 2 dim: 3 dim: 5 dim: 5 } "
+        "    shape: { dim: 2 dim: 4 } "
+        "    shape: { dim: 2 dim: 4 } "
+        "  } "
+        "} "
+        "layer { "
+        "  name: 'conv' "
+        "  type: 'Convolution' "
+        "  bottom: 'data' "
+        "  top: 'conv' "
+        "  convolution_param { "
+        "    num_output: 4 "
+        "    kernel_size: 3 "
+        "    weight_filler { "
+        "      type: 'gaussian' "
+        "      std: 0.1 "
+        "    } "
+        "  } "
+        "} "
+        "layer { "
+        "  name: 'bn' "
+        "  type: 'BatchNorm' "
+        "  bottom: 'conv' "
+        "  top: 'bn' "
+        "} "
+        "layer { "
+        "  name: 'scale' "
+        "  type: 'Scale' "
+        "  bottom: 'bn' "
+        "  top: 'scale' "
+        "  scale_param { "
+        "    bias_term: true "
+        "    filler { "
+        "      type: 'gaussian' "
+        "      std: 1 "
+        "    } "
+        "  } "
+        "} "
+        "layer { "
+        "  name: 'relu' "
+        "  type: 'ReLU' "
+        "  bottom: 'scale' "
+        "  top: 'relu' "
+        "} "
+        "layer { "
+        "  name: 'ip' "
+        "  type: 'InnerProduct' "
+        "  bottom: 'relu' "
+        "  top: 'ip' "
+        "  inner_product_param { "
+        "    num_output: 4 "
+        "    weight_filler { "
+        "      type: 'gaussian' "
+        "      std: 0.1 "
+        "    } "
+        "  } "
+        "} "
+        "layer { "
+        "  name: 'sum' "
+        "  type: 'Eltwise' "
+        "  bottom: 'ip' "
+        "  bottom: 'offset' "
+        "  top: 'sum' "
+        "  eltwise_param { "
+        "    coeff: 2 "
+        "    coeff: -1 "
+        "  } "
+        "} "
+        "layer { "
+        "  name: 'sigmoid' "
+        "  type: 'Sigmoid' "
+        "  bottom: 'sum' "
+        "  top: 'sigmoid' "
+        "} "
+        "layer { "
+        "  name: 'relu2' "
+        "  type: 'ReLU' "
+        "  bottom: 'sigmoid' "
+        "  top: 'relu2' "
+        "} "
+        "layer { "
+        "  name: 'loss' "
+        "  type: 'EuclideanLoss' "
+        "  bottom: 'relu2' "
+        "  bottom: 'label' "
+        "  top: 'loss' "
+        "} ";
+    if (optimize) {
+      proto += "optimize_in_place: true ";
+    }
+    InitNetFromProtoString(proto);
+  }
+
   virtual void InitSkipPropNet(bool test_skip_true) {
     string proto =
       "name: 'SkipPropTestNetwork' "
@@ -2446,6 +2841,200 @@ TYPED_TEST(NetTest, TestReshape) {
   EXPECT_FALSE(same_spatial_shape);
 }
 
+TYPED_TEST(NetTest, TestReshapeSkip) {
+  typedef typename TypeParam::Dtype Dtype;
+  Caffe::set_mode(Caffe::CPU);
+  this->InitReshapableNet();
+  const vector<shared_ptr<Layer<Dtype> > >& layers = this->net_->layers();
+  shared_ptr<Blob<Dtype> > input_blob = this->net_->blob_by_name("data");
+  // SetUp already reshaped the layers, later Forward calls skip it
+  for (int i = 0; i < 3; ++i) {
+    this->net_->Forward();
+  }
+  for (int i = 0; i < layers.size(); ++i) {
+    EXPECT_EQ(0, layers[i]->reshape_count()) << layers[i]->type();
+    EXPECT_EQ(3, layers[i]->reshape_skip_count()) << layers[i]->type();
+  }
+  // A new input shape reshapes every layer once
+  input_blob->Reshape(4, 3, 9, 11);
+  this->net_->Forward();
+  this->net_->Forward();
+  for (int i = 0; i < layers.size(); ++i) {
+    EXPECT_EQ(1, layers[i]->reshape_count()) << layers[i]->type();
+    EXPECT_EQ(4, layers[i]->reshape_skip_count()) << layers[i]->type();
+  }
+  Blob<Dtype>* output_blob = this->net_->output_blobs()[0];
+  EXPECT_EQ(4, output_blob->num());
+}
+
+TYPED_TEST(NetTest, TestActivationMemory) {
+  typedef typename TypeParam::Dtype Dtype;
+  Caffe::set_mode(Caffe::CPU);
+  FillerParameter filler_param;
+  filler_param.set_std(1);
+  GaussianFiller<Dtype> filler(filler_param);
+  Blob<Dtype> input(2, 3, 10, 10);
+  filler.Fill(&input);
+  // Reference (one buffer per blob)
+  Caffe::set_random_seed(this->seed_);
+  this->InitActivationMemoryNet(false);
+  EXPECT_EQ(0u, this->net_->activation_memory_size());
+  caffe_copy(input.count(), input.cpu_data(),
+      this->net_->input_blobs()[0]->mutable_cpu_data());
+  this->net_->Forward();
+  Blob<Dtype> output;
+  output.CopyFrom(*this->net_->output_blobs()[0], false, true);
+  // Shared arena
+  Caffe::set_random_seed(this->seed_);
+  this->InitActivationMemoryNet(true);
+  // conv1 (alive until sum), conv3 and a buffer shared by conv2 and sum
+  const size_t blob_size = 2 * 4 * 10 * 10 * sizeof(Dtype);
+  EXPECT_GE(this->net_->activation_memory_size(), 3 * blob_size);
+  EXPECT_LT(this->net_->activation_memory_size(), 4 * blob_size);
+  for (int run = 0; run < 2; ++run) {
+    caffe_copy(input.count(), input.cpu_data(),
+        this->net_->input_blobs()[0]->mutable_cpu_data());
+    this->net_->Forward();
+    const Blob<Dtype>& planned_output = *this->net_->output_blobs()[0];
+    ASSERT_EQ(output.count(), planned_output.count());
+    for (int i = 0; i < output.count(); ++i) {
+      EXPECT_FLOAT_EQ(output.cpu_data()[i], planned_output.cpu_data()[i]);
+    }
+  }
+}
+
+TYPED_TEST(NetTest, TestActivationMemoryForceBackward) {
+  Caffe::set_mode(Caffe::CPU);
+  // Backward reads the activations: no arena
+  this->InitActivationMemoryNet(true, false, true);
+  EXPECT_EQ(0u, this->net_->activation_memory_size());
+  this->net_->Forward();
+  this->net_->Backward();
+}
+
+TYPED_TEST(NetTest, TestActivationMemoryReshape) {
+  typedef typename TypeParam::Dtype Dtype;
+  Caffe::set_mode(Caffe::CPU);
+  FillerParameter filler_param;
+  filler_param.set_std(1);
+  GaussianFiller<Dtype> filler(filler_param);
+  Blob<Dtype> input(3, 3, 12, 14);
+  filler.Fill(&input);
+  vector<shared_ptr<Blob<Dtype> > > outputs;
+  vector<size_t> activation_memory_sizes;
+  for (int optimize = 0; optimize < 2; ++optimize) {
+    Caffe::set_random_seed(this->seed_);
+    this->InitActivationMemoryNet(optimize);
+    const size_t initial_size = this->net_->activation_memory_size();
+    Blob<Dtype>* input_blob = this->net_->input_blobs()[0];
+    input_blob->ReshapeLike(input);
+    caffe_copy(input.count(), input.cpu_data(),
+        input_blob->mutable_cpu_data());
+    this->net_->Reshape();
+    this->net_->Forward();
+    outputs.push_back(shared_ptr<Blob<Dtype> >(new Blob<Dtype>()));
+    outputs.back()->CopyFrom(*this->net_->output_blobs()[0], false, true);
+    activation_memory_sizes.push_back(this->net_->activation_memory_size());
+    EXPECT_LE(initial_size, activation_memory_sizes.back());
+  }
+  EXPECT_EQ(0u, activation_memory_sizes[0]);
+  EXPECT_GT(activation_memory_sizes[1], 0u);
+  ASSERT_EQ(outputs[0]->count(), outputs[1]->count());
+  for (int i = 0; i < outputs[0]->count(); ++i) {
+    EXPECT_FLOAT_EQ(outputs[0]->cpu_data()[i], outputs[1]->cpu_data()[i]);
+  }
+}
+
+TYPED_TEST(NetTest, TestActivationMemoryViews) {
+  typedef typename TypeParam::Dtype Dtype;
+  Caffe::set_mode(Caffe::CPU);
+  FillerParameter filler_param;
+  filler_param.set_std(1);
+  GaussianFiller<Dtype> filler(filler_param);
+  // Planned, then smaller without re-planning, then a batch of 2 (no views)
+  const int shapes[][4] = {{1, 3, 6, 5}, {1, 3, 4, 5}, {2, 3, 6, 5}};
+  const bool replan[] = {true, false, true};
+  vector<shared_ptr<Blob<Dtype> > > inputs;
+  for (int i = 0; i < 3; ++i) {
+    inputs.push_back(shared_ptr<Blob<Dtype> >(new Blob<Dtype>(
+        shapes[i][0], shapes[i][1], shapes[i][2], shapes[i][3])));
+    filler.Fill(inputs.back().get());
+  }
+  vector<shared_ptr<Blob<Dtype> > > outputs[2];
+  for (int optimize = 0; optimize < 2; ++optimize) {
+    Caffe::set_random_seed(this->seed_);
+    this->InitConcatSliceNet(optimize);
+    Net<Dtype>& net = *this->net_;
+    if (optimize) {
+      // Written in place by conv_a, conv_b and conv_c
+      const Dtype* concat = net.blob_by_name("concat")->cpu_data();
+      EXPECT_EQ(concat, net.blob_by_name("conv_a")->cpu_data());
+      EXPECT_EQ(concat + 4 * 6 * 5, net.blob_by_name("conv_b")->cpu_data());
+      const Dtype* conv_c = net.blob_by_name("conv_c")->cpu_data();
+      EXPECT_EQ(conv_c, net.blob_by_name("slice1")->cpu_data());
+      EXPECT_EQ(conv_c + 6 * 5, net.blob_by_name("slice2")->cpu_data());
+    }
+    for (int i = 0; i < 3; ++i) {
+      Blob<Dtype>* input_blob = net.input_blobs()[0];
+      input_blob->ReshapeLike(*inputs[i]);
+      caffe_copy(inputs[i]->count(), inputs[i]->cpu_data(),
+          input_blob->mutable_cpu_data());
+      if (replan[i]) {
+        net.Reshape();
+      }
+      net.Forward();
+      outputs[optimize].push_back(shared_ptr<Blob<Dtype> >(new Blob<Dtype>()));
+      outputs[optimize].back()->CopyFrom(*net.output_blobs()[0], false, true);
+    }
+  }
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_EQ(outputs[0][i]->count(), outputs[1][i]->count());
+    for (int j = 0; j < outputs[0][i]->count(); ++j) {
+      EXPECT_FLOAT_EQ(outputs[0][i]->cpu_data()[j],
+          outputs[1][i]->cpu_data()[j]);
+    }
+  }
+}
+
+TYPED_TEST(NetTest, TestInferenceOnly) {
+  typedef typename TypeParam::Dtype Dtype;
+  FillerParameter filler_param;
+  filler_param.set_std(1);
+  GaussianFiller<Dtype> filler(filler_param);
+  Blob<Dtype> input(2, 3, 10, 10);
+  filler.Fill(&input);
+  vector<shared_ptr<Blob<Dtype> > > outputs;
+  for (int inference_only = 0; inference_only < 2; ++inference_only) {
+    Caffe::set_random_seed(this->seed_);
+    this->InitActivationMemoryNet(false, inference_only);
+    EXPECT_EQ(inference_only != 0, this->net_->inference_only());
+    caffe_copy(input.count(), input.cpu_data(),
+        this->net_->input_blobs()[0]->mutable_cpu_data());
+    this->net_->Forward();
+    outputs.push_back(shared_ptr<Blob<Dtype> >(new Blob<Dtype>()));
+    outputs.back()->CopyFrom(*this->net_->output_blobs()[0], false, true);
+  }
+  // Convolutions have learnable parameters, yet nothing needs backward
+  const vector<bool>& layer_need_backward = this->net_->layer_need_backward();
+  for (int i = 0; i < layer_need_backward.size(); ++i) {
+    EXPECT_FALSE(layer_need_backward[i]);
+    const vector<bool>& bottom_need_backward =
+        this->net_->bottom_need_backward()[i];
+    for (int j = 0; j < bottom_need_backward.size(); ++j) {
+      EXPECT_FALSE(bottom_need_backward[j]);
+    }
+    const vector<shared_ptr<Blob<Dtype> > >& params =
+        this->net_->layers()[i]->blobs();
+    for (int j = 0; j < params.size(); ++j) {
+      EXPECT_FALSE(this->net_->layers()[i]->param_propagate_down(j));
+    }
+  }
+  ASSERT_EQ(outputs[0]->count(), outputs[1]->count());
+  for (int i = 0; i < outputs[0]->count(); ++i) {
+    EXPECT_EQ(outputs[0]->cpu_data()[i], outputs[1]->cpu_data()[i]);
+  }
+}
+
 TYPED_TEST(NetTest, TestSkipPropagateDown) {
   // check bottom_need_backward if propagate_down is true
   this->InitSkipPropNet(false);
@@ -2601,4 +3190,127 @@ TYPED_TEST(NetTest, TestAllInOneNetDeploy) {
   ASSERT_TRUE(found_data);
 }
 
+TYPED_TEST(NetTest, TestInPlace) {
+  typedef typename TypeParam::Dtype Dtype;
+  Caffe::set_mode(Caffe::CPU);
+  vector<shared_ptr<Blob<Dtype> > > inputs;
+  for (int i = 0; i < 3; ++i) {
+    inputs.push_back(shared_ptr<Blob<Dtype> >(new Blob<Dtype>()));
+  }
+  vector<Dtype> losses;
+  vector<vector<shared_ptr<Blob<Dtype> > > > diffs(2);
+  for (int optimize = 0; optimize < 2; ++optimize) {
+    Caffe::set_random_seed(this->seed_);
+    this->InitInPlaceNet(optimize);
+    const vector<Blob<Dtype>*>& input_blobs = this->net_->input_blobs();
+    ASSERT_EQ(inputs.size(), input_blobs.size());
+    for (int i = 0; i < inputs.size(); ++i) {
+      if (optimize == 0) {
+        FillerParameter filler_param;
+        filler_param.set_std(1);
+        GaussianFiller<Dtype> filler(filler_param);
+        inputs[i]->ReshapeLike(*input_blobs[i]);
+        filler.Fill(inputs[i].get());
+      }
+      input_blobs[i]->CopyFrom(*inputs[i]);
+    }
+    losses.push_back(this->net_->ForwardBackward());
+    const vector<Blob<Dtype>*>& params = this->net_->learnable_params();
+    for (int i = 0; i < params.size(); ++i) {
+      diffs[optimize].push_back(
+          shared_ptr<Blob<Dtype> >(new Blob<Dtype>()));
+      diffs[optimize].back()->CopyFrom(*params[i], true, true);
+    }
+    diffs[optimize].push_back(shared_ptr<Blob<Dtype> >(new Blob<Dtype>()));
+    diffs[optimize].back()->CopyFrom(*input_blobs[0], true, true);
+    // The renamed tops remain available under their names
+    const shared_ptr<Blob<Dtype> > conv = this->net_->blob_by_name("conv");
+    EXPECT_EQ(optimize != 0, conv == this->net_->blob_by_name("relu"));
+    EXPECT_EQ(optimize != 0, conv == this->net_->blob_by_name("bn"));
+    EXPECT_EQ(optimize != 0,
+        this->net_->blob_by_name("ip") == this->net_->blob_by_name("sum"));
+    EXPECT_EQ(optimize != 0,
+        this->net_->blob_by_name("ip") == this->net_->blob_by_name("sigmoid"));
+    EXPECT_NE(this->net_->blob_by_name("sigmoid"),
+        this->net_->blob_by_name("relu2"));
+    EXPECT_EQ(optimize ? 7u : 12u, this->net_->blobs().size());
+  }
+  EXPECT_NEAR(losses[0], losses[1], 1e-5);
+  ASSERT_EQ(diffs[0].size(), diffs[1].size());
+  for (int i = 0; i < diffs[0].size(); ++i) {
+    for (int j = 0; j < diffs[0][i]->count(); ++j) {
+      EXPECT_NEAR(diffs[0][i]->cpu_diff()[j], diffs[1][i]->cpu_diff()[j],
+          1e-5);
+    }
+  }
+}
+
+TYPED_TEST(NetTest, TestFuseInferenceLayers) {
+  typedef typename TypeParam::Dtype Dtype;
+  Caffe::set_mode(Caffe::CPU);
+  Blob<Dtype> input;
+  vector<shared_ptr<Net<Dtype> > > nets;
+  for (int fuse = 0; fuse < 2; ++fuse) {
+    Caffe::set_random_seed(this->seed_);
+    this->InitFusedNet(fuse);
+    nets.push_back(this->net_);
+    Blob<Dtype>* input_blob = this->net_->input_blobs()[0];
+    if (fuse == 0) {
+      FillerParameter filler_param;
+      filler_param.set_std(1);
+      GaussianFiller<Dtype> filler(filler_param);
+      input.ReshapeLike(*input_blob);
+      filler.Fill(&input);
+      // Non-trivial statistics: the BatchNorm parameters are filled with 0
+      const vector<shared_ptr<Blob<Dtype> > >& stats =
+          this->net_->layer_by_name("bn")->blobs();
+      filler.Fill(stats[0].get());
+      filler_param.set_min(0.5);
+      filler_param.set_max(2);
+      UniformFiller<Dtype> variance_filler(filler_param);
+      variance_filler.Fill(stats[1].get());
+      stats[2]->mutable_cpu_data()[0] = 2;
+    } else {
+      this->net_->ShareTrainedLayersWith(nets[0].get());
+    }
+    input_blob->CopyFrom(input);
+    // Everything but the convolutions is fused
+    const vector<string>& layer_names = this->net_->layer_names();
+    for (int i = 0; i < layer_names.size(); ++i) {
+      EXPECT_EQ(fuse && layer_names[i] != "data"
+          && layer_names[i].find("conv") == string::npos,
+          this->net_->layer_fused()[i]) << layer_names[i];
+    }
+  }
+  // The folded weights follow the parameters
+  for (int pass = 0; pass < 2; ++pass) {
+    if (pass == 1) {
+      caffe_add_scalar(nets[0]->layer_by_name("bn")->blobs()[0]->count(),
+          Dtype(0.5),
+          nets[0]->layer_by_name("bn")->blobs()[0]->mutable_cpu_data());
+      caffe_scal(nets[0]->layer_by_name("conv2")->blobs()[0]->count(),
+          Dtype(-2),
+          nets[0]->layer_by_name("conv2")->blobs()[0]->mutable_cpu_data());
+    }
+    const Blob<Dtype>& output = *nets[0]->Forward()[0];
+    const Blob<Dtype>& fused_output = *nets[1]->Forward()[0];
+    ASSERT_EQ(output.count(), fused_output.count());
+    for (int i = 0; i < output.count(); ++i) {
+      EXPECT_NEAR(output.cpu_data()[i], fused_output.cpu_data()[i], 1e-4);
+    }
+  }
+}
+
+TYPED_TEST(NetTest, TestFuseInferenceLayersForceBackward) {
+  Caffe::set_mode(Caffe::CPU);
+  // The fused layers would run Backward on tops their Forward never wrote
+  this->InitFusedNet(true, true);
+  const vector<bool>& layer_fused = this->net_->layer_fused();
+  for (int i = 0; i < layer_fused.size(); ++i) {
+    EXPECT_FALSE(layer_fused[i]) << this->net_->layer_names()[i];
+  }
+  this->net_->Forward();
+  this->net_->Backward();
+}
+
 }  // namespace caffe
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <vector>
 
 #include "gtest/gtest.h"
@@ -67,6 +68,142 @@ TEST_F(SyncedMemoryTest, TestCPUWrite) {
   }
 }
 
+TEST_F(SyncedMemoryTest, TestVersion) {
+  SyncedMemory mem(10);
+  SyncedMemory other(10);
+  EXPECT_NE(mem.version(), other.version());
+  const uint64_t version = mem.version();
+  mem.cpu_data();
+  EXPECT_EQ(mem.version(), version);
+  mem.mutable_cpu_data();
+  EXPECT_NE(mem.version(), version);
+  EXPECT_NE(mem.version(), other.version());
+}
+
+TEST_F(SyncedMemoryTest, TestCPUAlignment) {
+  Caffe::set_mode(Caffe::CPU);
+  for (size_t size = 1; size <= 1 << 12; size *= 4) {
+    SyncedMemory mem(size);
+    const char* cpu_data = static_cast<const char*>(mem.cpu_data());
+    EXPECT_EQ(reinterpret_cast<size_t>(cpu_data) % HostAllocator::kAlignment,
+              0);
+    for (int i = 0; i < mem.size(); ++i) {
+      EXPECT_EQ(cpu_data[i], 0);
+    }
+  }
+}
+
+TEST_F(SyncedMemoryTest, TestCPULargeAllocation) {
+  Caffe::set_mode(Caffe::CPU);
+  SyncedMemory mem(AlignedHostAllocator::kHugePageSize + 10);
+  const char* cpu_data = static_cast<const char*>(mem.cpu_data());
+  EXPECT_EQ(mem.head(), SyncedMemory::HEAD_AT_CPU);
+#ifdef __linux__
+  EXPECT_EQ(reinterpret_cast<size_t>(cpu_data)
+            % AlignedHostAllocator::kHugePageSize, 0);
+#endif
+  for (int i = 0; i < mem.size(); ++i) {
+    ASSERT_EQ(cpu_data[i], 0);
+  }
+  caffe_memset(mem.size(), 3, mem.mutable_cpu_data());
+  EXPECT_EQ(static_cast<const char*>(mem.cpu_data())[mem.size() - 1], 3);
+}
+
+TEST_F(SyncedMemoryTest, TestAlignedHostAllocatorFree) {
+  // Heap buffers and mappings (from 4 kB), released by another instance:
+  // their header tells how
+  AlignedHostAllocator allocator(1 << 12);
+  AlignedHostAllocator other;
+  for (size_t size = 1000; size <= 1 << 16; size *= 4) {
+    bool zeroed = false;
+    char* ptr = static_cast<char*>(allocator.Allocate(size, &zeroed));
+    ASSERT_TRUE(ptr);
+    EXPECT_EQ(reinterpret_cast<size_t>(ptr) % HostAllocator::kAlignment, 0);
+#ifdef __linux__
+    EXPECT_EQ(size >= 1 << 12, zeroed);
+#endif
+    caffe_memset(size, 1, ptr);
+    other.Free(ptr);
+  }
+}
+
+class CountingHostAllocator : public AlignedHostAllocator {
+ public:
+  CountingHostAllocator() : allocations_(0), frees_(0) {}
+
+  virtual void* Allocate(size_t size, bool* zeroed) {
+    ++allocations_;
+    return AlignedHostAllocator::Allocate(size, zeroed);
+  }
+  virtual void Free(void* ptr) {
+    ++frees_;
+    AlignedHostAllocator::Free(ptr);
+  }
+
+  int allocations_;
+  int frees_;
+};
+
+TEST_F(SyncedMemoryTest, TestCustomHostAllocator) {
+  Caffe::set_mode(Caffe::CPU);
+  shared_ptr<HostAllocator> default_allocator = GetHostAllocator();
+  shared_ptr<CountingHostAllocator> allocator(new CountingHostAllocator());
+  SetHostAllocator(allocator);
+  {
+    SyncedMemory mem(10);
+    EXPECT_EQ(allocator->allocations_, 0);
+    EXPECT_TRUE(mem.mutable_cpu_data());
+    EXPECT_TRUE(mem.cpu_data());
+    EXPECT_EQ(allocator->allocations_, 1);
+  }
+  EXPECT_EQ(allocator->frees_, 1);
+  SetHostAllocator(default_allocator);
+}
+
+TEST_F(SyncedMemoryTest, TestPooledHostAllocatorSizeClass) {
+  EXPECT_EQ(PooledHostAllocator::SizeClass(1), 64);
+  EXPECT_EQ(PooledHostAllocator::SizeClass(64), 64);
+  EXPECT_EQ(PooledHostAllocator::SizeClass(65), 80);
+  EXPECT_EQ(PooledHostAllocator::SizeClass(1000), 1024);
+  EXPECT_EQ(PooledHostAllocator::SizeClass(1025), 1280);
+  for (size_t size = 1; size < 1 << 20; size = size * 3 + 1) {
+    const size_t size_class = PooledHostAllocator::SizeClass(size);
+    EXPECT_GE(size_class, size);
+    EXPECT_LE(size_class, std::max(size_t(64), size + size / 4));
+  }
+}
+
+TEST_F(SyncedMemoryTest, TestPooledHostAllocator) {
+  Caffe::set_mode(Caffe::CPU);
+  shared_ptr<HostAllocator> default_allocator = GetHostAllocator();
+  shared_ptr<CountingHostAllocator> allocator(new CountingHostAllocator());
+  shared_ptr<PooledHostAllocator> pool(new PooledHostAllocator(allocator));
+  SetHostAllocator(pool);
+  for (int i = 0; i < 3; ++i) {
+    SyncedMemory mem(1000);
+    // Recycled buffers are still zero-initialized
+    const char* cpu_data = static_cast<const char*>(mem.cpu_data());
+    for (int j = 0; j < mem.size(); ++j) {
+      ASSERT_EQ(cpu_data[j], 0);
+    }
+    caffe_memset(mem.size(), 1, mem.mutable_cpu_data());
+    // Same size class
+    SyncedMemory other(1010);
+    other.mutable_cpu_data();
+  }
+  PooledHostAllocator::Stats stats = pool->stats();
+  EXPECT_EQ(allocator->allocations_, 2);
+  EXPECT_EQ(stats.misses, 2);
+  EXPECT_EQ(stats.hits, 4);
+  EXPECT_EQ(stats.in_use_bytes, 0);
+  EXPECT_EQ(stats.cached_bytes, 2 * 1024);
+  EXPECT_EQ(stats.peak_bytes, 2 * 1024);
+  SetHostAllocator(default_allocator);
+  pool->Trim();
+  EXPECT_EQ(allocator->frees_, 2);
+  EXPECT_EQ(pool->stats().cached_bytes, 0);
+}
+
 #ifndef CPU_ONLY  // GPU test
 
 TEST_F(SyncedMemoryTest, TestGPURead) {
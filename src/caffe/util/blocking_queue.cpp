@@ -1,5 +1,8 @@
 #include <boost/thread.hpp>
+#include <atomic>
+#include <chrono>
 #include <string>
+#include <vector>
 
 #include "caffe/layers/base_data_layer.hpp"
 #include "caffe/parallel.hpp"
@@ -7,82 +10,275 @@
 
 namespace caffe {
 
+namespace {
+
+// Tries before sleeping: busy, then yielding the CPU
+const int kSpinTries = 64;
+const int kYieldTries = 16;
+
+// Separate cache lines for the positions written by producers and consumers
+const size_t kCacheLine = 64;
+
+}  // namespace
+
+// Bounded MPMC ring (D. Vyukov): the sequence number of a cell tells whether
+// it is free for the producer at position pos (sequence == pos) or holds the
+// element for the consumer at position pos (sequence == pos + 1). The mutex
+// and condition variables are only used by waiting threads.
 template<typename T>
 class BlockingQueue<T>::sync {
  public:
-  mutable boost::mutex mutex_;
-  boost::condition_variable condition_;
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T data;
+  };
+
+  explicit sync(size_t capacity)
+      : mask_(capacity - 1), cells_(capacity), enqueue_pos_(0),
+        dequeue_pos_(0), push_waiters_(0), pop_waiters_(0), pushes_(0),
+        pops_(0), push_waits_(0), pop_waits_(0), push_wait_ns_(0),
+        pop_wait_ns_(0) {
+    for (size_t i = 0; i < capacity; ++i) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  bool Enqueue(const T& t) {
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true) {
+      cell = &cells_[pos & mask_];
+      const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+      const intptr_t diff = intptr_t(sequence) - intptr_t(pos);
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;  // Full
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    cell->data = t;
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    pushes_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  bool Dequeue(T* t) {
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true) {
+      cell = &cells_[pos & mask_];
+      const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+      const intptr_t diff = intptr_t(sequence) - intptr_t(pos + 1);
+      if (diff == 0) {
+        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;  // Empty
+      } else {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    *t = cell->data;
+    cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+    pops_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  bool Peek(T* t) {
+    while (true) {
+      const size_t pos = dequeue_pos_.load(std::memory_order_acquire);
+      const Cell& cell = cells_[pos & mask_];
+      if (cell.sequence.load(std::memory_order_acquire) != pos + 1) {
+        return false;
+      }
+      const T data = cell.data;
+      // Valid if the element was not popped meanwhile
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (dequeue_pos_.load(std::memory_order_relaxed) == pos) {
+        *t = data;
+        return true;
+      }
+    }
+  }
+
+  // Wakes up the threads sleeping on condition, if any
+  void Notify(const std::atomic<int>& waiters,
+              boost::condition_variable* condition) {
+    // Pairs with the fence in Wait: either the waiter's last attempt sees
+    // the change, or this sees the waiter
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters.load(std::memory_order_relaxed) > 0) {
+      // Once the mutex is taken, the waiter is sleeping
+      boost::mutex::scoped_lock lock(mutex_);
+      condition->notify_all();
+    }
+  }
+
+  // Calls attempt until it succeeds, spinning first, then sleeping on
+  // condition until notified. The wait is added to waits and wait_ns, if
+  // not NULL.
+  template<typename Attempt>
+  void Wait(Attempt attempt, std::atomic<int>* waiters,
+            boost::condition_variable* condition,
+            std::atomic<uint64_t>* waits, std::atomic<uint64_t>* wait_ns) {
+    const std::chrono::steady_clock::time_point begin =
+        std::chrono::steady_clock::now();
+    bool done = false;
+    for (int i = 0; i < kSpinTries + kYieldTries && !done; ++i) {
+      if (i >= kSpinTries) {
+        boost::this_thread::interruption_point();
+        boost::this_thread::yield();
+      }
+      done = attempt();
+    }
+    if (!done) {
+      boost::mutex::scoped_lock lock(mutex_);
+      waiters->fetch_add(1);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      try {
+        while (!attempt()) {
+          condition->wait(lock);
+        }
+      } catch (...) {
+        waiters->fetch_sub(1);
+        throw;
+      }
+      waiters->fetch_sub(1);
+    }
+    if (waits) {
+      waits->fetch_add(1, std::memory_order_relaxed);
+      const std::chrono::nanoseconds wait =
+          std::chrono::duration_cast<std::chrono::nanoseconds>(
+              std::chrono::steady_clock::now() - begin);
+      wait_ns->fetch_add(wait.count(), std::memory_order_relaxed);
+    }
+  }
+
+  size_t size() const {
+    const size_t dequeue_pos = dequeue_pos_.load(std::memory_order_relaxed);
+    const size_t enqueue_pos = enqueue_pos_.load(std::memory_order_relaxed);
+    return enqueue_pos > dequeue_pos ? enqueue_pos - dequeue_pos : 0;
+  }
+
+  const size_t mask_;
+  std::vector<Cell> cells_;
+  char pad0_[kCacheLine];
+  std::atomic<size_t> enqueue_pos_;
+  char pad1_[kCacheLine - sizeof(std::atomic<size_t>)];
+  std::atomic<size_t> dequeue_pos_;
+  char pad2_[kCacheLine - sizeof(std::atomic<size_t>)];
+
+  boost::mutex mutex_;
+  boost::condition_variable not_empty_;
+  boost::condition_variable not_full_;
+  std::atomic<int> push_waiters_;
+  std::atomic<int> pop_waiters_;
+
+  std::atomic<uint64_t> pushes_;
+  std::atomic<uint64_t> pops_;
+  std::atomic<uint64_t> push_waits_;
+  std::atomic<uint64_t> pop_waits_;
+  std::atomic<uint64_t> push_wait_ns_;
+  std::atomic<uint64_t> pop_wait_ns_;
 };
 
+// Rounds the capacity up to a power of two
+static size_t RingCapacity(size_t capacity) {
+  size_t ring_capacity = 2;
+  while (ring_capacity < capacity) {
+    ring_capacity *= 2;
+  }
+  return ring_capacity;
+}
+
 template<typename T>
-BlockingQueue<T>::BlockingQueue()
-    : sync_(new sync()) {
+BlockingQueue<T>::BlockingQueue(size_t capacity)
+    : sync_(new sync(RingCapacity(capacity))) {
 }
 
 template<typename T>
 void BlockingQueue<T>::push(const T& t) {
-  boost::mutex::scoped_lock lock(sync_->mutex_);
-  queue_.push(t);
-  lock.unlock();
-  sync_->condition_.notify_one();
+  sync* s = sync_.get();
+  if (!s->Enqueue(t)) {
+    s->Wait([s, &t]() { return s->Enqueue(t); }, &s->push_waiters_,
+            &s->not_full_, &s->push_waits_, &s->push_wait_ns_);
+  }
+  s->Notify(s->pop_waiters_, &s->not_empty_);
 }
 
 template<typename T>
-bool BlockingQueue<T>::try_pop(T* t) {
-  boost::mutex::scoped_lock lock(sync_->mutex_);
-
-  if (queue_.empty()) {
+bool BlockingQueue<T>::try_push(const T& t) {
+  if (!sync_->Enqueue(t)) {
     return false;
   }
-
-  *t = queue_.front();
-  queue_.pop();
+  sync_->Notify(sync_->pop_waiters_, &sync_->not_empty_);
   return true;
 }
 
 template<typename T>
-T BlockingQueue<T>::pop(const string& log_on_wait) {
-  boost::mutex::scoped_lock lock(sync_->mutex_);
-
-  while (queue_.empty()) {
-    if (!log_on_wait.empty()) {
-      LOG_EVERY_N(INFO, 1000)<< log_on_wait;
-    }
-    sync_->condition_.wait(lock);
+bool BlockingQueue<T>::try_pop(T* t) {
+  if (!sync_->Dequeue(t)) {
+    return false;
   }
+  sync_->Notify(sync_->push_waiters_, &sync_->not_full_);
+  return true;
+}
 
-  T t = queue_.front();
-  queue_.pop();
+template<typename T>
+T BlockingQueue<T>::pop() {
+  sync* s = sync_.get();
+  T t;
+  if (!s->Dequeue(&t)) {
+    s->Wait([s, &t]() { return s->Dequeue(&t); }, &s->pop_waiters_,
+            &s->not_empty_, &s->pop_waits_, &s->pop_wait_ns_);
+  }
+  s->Notify(s->push_waiters_, &s->not_full_);
   return t;
 }
 
 template<typename T>
 bool BlockingQueue<T>::try_peek(T* t) {
-  boost::mutex::scoped_lock lock(sync_->mutex_);
-
-  if (queue_.empty()) {
-    return false;
-  }
-
-  *t = queue_.front();
-  return true;
+  return sync_->Peek(t);
 }
 
 template<typename T>
 T BlockingQueue<T>::peek() {
-  boost::mutex::scoped_lock lock(sync_->mutex_);
-
-  while (queue_.empty()) {
-    sync_->condition_.wait(lock);
+  sync* s = sync_.get();
+  T t;
+  if (!s->Peek(&t)) {
+    s->Wait([s, &t]() { return s->Peek(&t); }, &s->pop_waiters_,
+            &s->not_empty_, NULL, NULL);
   }
-
-  return queue_.front();
+  return t;
 }
 
 template<typename T>
 size_t BlockingQueue<T>::size() const {
-  boost::mutex::scoped_lock lock(sync_->mutex_);
-  return queue_.size();
+  return sync_->size();
+}
+
+template<typename T>
+size_t BlockingQueue<T>::capacity() const {
+  return sync_->mask_ + 1;
+}
+
+template<typename T>
+typename BlockingQueue<T>::Stats BlockingQueue<T>::stats() const {
+  Stats stats;
+  stats.pushes = sync_->pushes_.load();
+  stats.pops = sync_->pops_.load();
+  stats.push_waits = sync_->push_waits_.load();
+  stats.pop_waits = sync_->pop_waits_.load();
+  stats.push_wait_seconds = 1e-9 * sync_->push_wait_ns_.load();
+  stats.pop_wait_seconds = 1e-9 * sync_->pop_wait_ns_.load();
+  return stats;
 }
 
 template class BlockingQueue<Batch<float>*>;
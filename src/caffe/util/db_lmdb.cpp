@@ -44,6 +44,17 @@ LMDBCursor* LMDB::NewCursor() {
   return new LMDBCursor(mdb_txn, mdb_cursor);
 }
 
+size_t LMDB::NumEntries() {
+  MDB_txn* mdb_txn;
+  MDB_dbi mdb_dbi;
+  MDB_stat mdb_stats;
+  MDB_CHECK(mdb_txn_begin(mdb_env_, NULL, MDB_RDONLY, &mdb_txn));
+  MDB_CHECK(mdb_dbi_open(mdb_txn, NULL, 0, &mdb_dbi));
+  MDB_CHECK(mdb_stat(mdb_txn, mdb_dbi, &mdb_stats));
+  mdb_txn_abort(mdb_txn);
+  return mdb_stats.ms_entries;
+}
+
 LMDBTransaction* LMDB::NewTransaction() {
   return new LMDBTransaction(mdb_env_);
 }
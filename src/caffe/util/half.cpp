@@ -0,0 +1,31 @@
+#include <string>
+
+#include "glog/logging.h"
+
+#include "caffe/util/half.hpp"
+
+namespace caffe {
+
+void EncodeHalf(const int n, const float* x, const HalfFormat format,
+    std::string* bytes) {
+  bytes->resize(2 * n);
+  for (int i = 0; i < n; ++i) {
+    const uint16_t h = format == FLOAT16 ?
+        float_to_float16(x[i]) : float_to_bfloat16(x[i]);
+    (*bytes)[2 * i] = static_cast<char>(h & 0xff);
+    (*bytes)[2 * i + 1] = static_cast<char>(h >> 8);
+  }
+}
+
+void DecodeHalf(const int n, const std::string& bytes,
+    const HalfFormat format, float* y) {
+  CHECK_EQ(bytes.size(), 2 * n) << "Wrong number of 16 bit floats";
+  const unsigned char* data =
+      reinterpret_cast<const unsigned char*>(bytes.data());
+  for (int i = 0; i < n; ++i) {
+    const uint16_t h = data[2 * i] | (data[2 * i + 1] << 8);
+    y[i] = format == FLOAT16 ? float16_to_float(h) : bfloat16_to_float(h);
+  }
+}
+
+}  // namespace caffe
@@ -0,0 +1,269 @@
+#include <boost/thread.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#ifdef USE_MKL
+#include "mkl.h"
+#endif
+
+#include "caffe/util/host_allocator.hpp"
+
+namespace caffe {
+
+namespace {
+
+// Memory policies of mbind(2) (numaif.h), to avoid depending on libnuma
+const int kMpolPreferred = 1;
+const int kMpolBind = 2;
+
+// Stored in the kAlignment bytes in front of each AlignedHostAllocator
+// buffer, so that Free knows how to release it without any lookup
+struct BufferHeader {
+  // The mapping to munmap (starting at the page of the header), NULL for the
+  // heap buffers
+  void* mapping;
+  size_t length;
+};
+
+BufferHeader* Header(void* ptr) {
+  return reinterpret_cast<BufferHeader*>(
+      static_cast<char*>(ptr) - HostAllocator::kAlignment);
+}
+
+boost::mutex& AllocatorMutex() {
+  static boost::mutex mutex;
+  return mutex;
+}
+
+shared_ptr<HostAllocator>& Allocator() {
+  static shared_ptr<HostAllocator> allocator(new AlignedHostAllocator());
+  return allocator;
+}
+
+}  // namespace
+
+AlignedHostAllocator::AlignedHostAllocator(size_t huge_page_threshold,
+    bool transparent_huge_pages, NumaPolicy numa_policy, int numa_node)
+    : huge_page_threshold_(huge_page_threshold),
+      transparent_huge_pages_(transparent_huge_pages),
+      numa_policy_(numa_policy), numa_node_(numa_node) {
+  CHECK_GE(numa_node_, 0) << "Invalid NUMA node";
+  CHECK_LT(numa_node_, 8 * sizeof(unsigned long))  // NOLINT(runtime/int)
+      << "Only the first " << 8 * sizeof(unsigned long)  // NOLINT(runtime/int)
+      << " NUMA nodes are supported";
+}
+
+void* AlignedHostAllocator::Allocate(size_t size, bool* zeroed) {
+  void* ptr = NULL;
+#ifdef __linux__
+  if (size >= huge_page_threshold_) {
+    ptr = MapAligned(size);
+    if (ptr) {
+      *zeroed = true;
+      return ptr;
+    }
+  }
+#endif
+  *zeroed = false;
+  void* buffer = NULL;
+#ifdef USE_MKL
+  buffer = mkl_malloc(size + kAlignment, kAlignment);
+#else
+  if (posix_memalign(&buffer, kAlignment, size + kAlignment) != 0) {
+    buffer = NULL;
+  }
+#endif
+  if (!buffer) {
+    return NULL;
+  }
+  ptr = static_cast<char*>(buffer) + kAlignment;
+  Header(ptr)->mapping = NULL;
+  return ptr;
+}
+
+void AlignedHostAllocator::Free(void* ptr) {
+  if (!ptr) {
+    return;
+  }
+  BufferHeader* header = Header(ptr);
+#ifdef __linux__
+  if (header->mapping) {
+    CHECK_EQ(munmap(header->mapping, header->length), 0) << "munmap failed";
+    return;
+  }
+#endif
+#ifdef USE_MKL
+  mkl_free(header);
+#else
+  free(header);
+#endif
+}
+
+void* AlignedHostAllocator::MapAligned(size_t size) {
+#ifdef __linux__
+  const size_t page_size = sysconf(_SC_PAGESIZE);
+  const size_t length = (size + page_size - 1) / page_size * page_size;
+  // Over-allocate, then trim the mapping to a 2 MB aligned start, keeping the
+  // page before it for the header
+  void* mapping = mmap(NULL, length + kHugePageSize, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mapping == MAP_FAILED) {
+    return NULL;
+  }
+  char* begin = static_cast<char*>(mapping);
+  char* aligned = reinterpret_cast<char*>(
+      (reinterpret_cast<size_t>(begin) + page_size + kHugePageSize - 1)
+      / kHugePageSize * kHugePageSize);
+  char* header_page = aligned - page_size;
+  if (header_page > begin) {
+    munmap(begin, header_page - begin);
+  }
+  char* end = begin + length + kHugePageSize;
+  if (end > aligned + length) {
+    munmap(aligned + length, end - (aligned + length));
+  }
+#ifdef MADV_HUGEPAGE
+  if (transparent_huge_pages_) {
+    madvise(aligned, length, MADV_HUGEPAGE);
+  }
+#endif
+#ifdef SYS_mbind
+  if (numa_policy_ != FIRST_TOUCH) {
+    const unsigned long node_mask = 1ul << numa_node_;  // NOLINT(runtime/int)
+    const int mode = (numa_policy_ == BIND ? kMpolBind : kMpolPreferred);
+    if (syscall(SYS_mbind, aligned, length, mode, &node_mask,
+                8 * sizeof(node_mask) + 1, 0) != 0) {
+      LOG_FIRST_N(WARNING, 1) << "mbind to NUMA node " << numa_node_
+          << " failed, using the default placement";
+    }
+  }
+#endif
+  Header(aligned)->mapping = header_page;
+  Header(aligned)->length = length + page_size;
+  return aligned;
+#else
+  return NULL;
+#endif
+}
+
+class PooledHostAllocator::sync {
+ public:
+  mutable boost::mutex mutex_;
+};
+
+PooledHostAllocator::PooledHostAllocator(shared_ptr<HostAllocator> allocator,
+    size_t max_cached_bytes)
+    : allocator_(allocator), max_cached_bytes_(max_cached_bytes),
+      sync_(new sync()) {
+  CHECK(allocator_);
+  Stats stats = {0, 0, 0, 0, 0};
+  stats_ = stats;
+}
+
+PooledHostAllocator::~PooledHostAllocator() {
+  Trim();
+  // Buffers still in use (e.g. owned by static blobs) are not released
+}
+
+size_t PooledHostAllocator::SizeClass(size_t size) {
+  if (size <= kAlignment) {
+    return kAlignment;
+  }
+  size_t power = kAlignment;
+  while (power * 2 <= size) {
+    power *= 2;
+  }
+  const size_t step = power / 4;
+  return (size + step - 1) / step * step;
+}
+
+void* PooledHostAllocator::Allocate(size_t size, bool* zeroed) {
+  const size_t size_class = SizeClass(size);
+  {
+    boost::mutex::scoped_lock lock(sync_->mutex_);
+    map<size_t, vector<void*> >::iterator it = cached_.find(size_class);
+    if (it != cached_.end() && !it->second.empty()) {
+      void* ptr = it->second.back();
+      it->second.pop_back();
+      in_use_[ptr] = size_class;
+      ++stats_.hits;
+      stats_.cached_bytes -= size_class;
+      stats_.in_use_bytes += size_class;
+      *zeroed = false;
+      return ptr;
+    }
+  }
+  void* ptr = allocator_->Allocate(size_class, zeroed);
+  if (ptr) {
+    boost::mutex::scoped_lock lock(sync_->mutex_);
+    in_use_[ptr] = size_class;
+    ++stats_.misses;
+    stats_.in_use_bytes += size_class;
+    stats_.peak_bytes = std::max(stats_.peak_bytes,
+                                 stats_.in_use_bytes + stats_.cached_bytes);
+  }
+  return ptr;
+}
+
+void PooledHostAllocator::Free(void* ptr) {
+  {
+    boost::mutex::scoped_lock lock(sync_->mutex_);
+    map<void*, size_t>::iterator it = in_use_.find(ptr);
+    // Allocated before this pool was installed
+    if (it == in_use_.end()) {
+      lock.unlock();
+      allocator_->Free(ptr);
+      return;
+    }
+    const size_t size_class = it->second;
+    in_use_.erase(it);
+    stats_.in_use_bytes -= size_class;
+    if (stats_.cached_bytes + size_class <= max_cached_bytes_) {
+      cached_[size_class].push_back(ptr);
+      stats_.cached_bytes += size_class;
+      return;
+    }
+  }
+  allocator_->Free(ptr);
+}
+
+PooledHostAllocator::Stats PooledHostAllocator::stats() const {
+  boost::mutex::scoped_lock lock(sync_->mutex_);
+  return stats_;
+}
+
+void PooledHostAllocator::Trim() {
+  map<size_t, vector<void*> > cached;
+  {
+    boost::mutex::scoped_lock lock(sync_->mutex_);
+    cached.swap(cached_);
+    stats_.cached_bytes = 0;
+  }
+  for (map<size_t, vector<void*> >::iterator it = cached.begin();
+       it != cached.end(); ++it) {
+    for (int i = 0; i < it->second.size(); ++i) {
+      allocator_->Free(it->second[i]);
+    }
+  }
+}
+
+shared_ptr<HostAllocator> GetHostAllocator() {
+  boost::mutex::scoped_lock lock(AllocatorMutex());
+  return Allocator();
+}
+
+void SetHostAllocator(shared_ptr<HostAllocator> allocator) {
+  CHECK(allocator);
+  boost::mutex::scoped_lock lock(AllocatorMutex());
+  Allocator() = allocator;
+}
+
+}  // namespace caffe
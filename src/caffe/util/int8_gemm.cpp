@@ -0,0 +1,104 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "caffe/util/int8_gemm.hpp"
+
+namespace caffe {
+
+template <typename Dtype>
+void Int8Gemm<Dtype>::SetInputRange(const QuantizationParameter& param) {
+  // The range holds 0, so that the zero padding is exact
+  const Dtype min = std::min<Dtype>(param.input_min(), 0);
+  const Dtype max = std::max<Dtype>(param.input_max(), 0);
+  input_scale_ = max > min ? (max - min) / 255 : Dtype(1);
+  zero_point_ = std::min(255,
+      static_cast<int>(std::floor(-min / input_scale_ + Dtype(0.5))));
+}
+
+template <typename Dtype>
+void Int8Gemm<Dtype>::QuantizeWeights(const int rows, const int cols,
+    const Dtype* weights, const uint64_t version, const bool transposed) {
+  CHECK_LE(cols, kMaxInt8GemmK) << "Too many inputs for the int8 GEMM";
+  const int count = rows * cols;
+  if (rows == rows_ && cols == cols_ && transposed == transposed_
+      && version == version_) {
+    return;
+  }
+  rows_ = rows;
+  cols_ = cols;
+  transposed_ = transposed;
+  version_ = version;
+  weights_.resize(count);
+  weight_scales_.resize(rows);
+  row_sums_.resize(rows);
+  const int row_step = transposed ? 1 : cols;
+  const int col_step = transposed ? rows : 1;
+  for (int i = 0; i < rows; ++i) {
+    const Dtype* row = weights + i * row_step;
+    Dtype max = 0;
+    for (int j = 0; j < cols; ++j) {
+      max = std::max<Dtype>(max, std::fabs(row[j * col_step]));
+    }
+    const Dtype scale = max / 127;
+    const Dtype inverse_scale = max > 0 ? 1 / scale : Dtype(0);
+    int8_t* quantized = &weights_[i * cols];
+    int32_t sum = 0;
+    for (int j = 0; j < cols; ++j) {
+      quantized[j] = static_cast<int8_t>(
+          std::floor(row[j * col_step] * inverse_scale + Dtype(0.5)));
+      sum += quantized[j];
+    }
+    weight_scales_[i] = scale;
+    row_sums_[i] = sum;
+  }
+}
+
+template <typename Dtype>
+const uint8_t* Int8Gemm<Dtype>::QuantizeInput(const int count,
+    const Dtype* input) {
+  input_.resize(count);
+  uint8_t* quantized = input_.data();
+  const Dtype inverse_scale = 1 / input_scale_;
+  const Dtype zero_point = zero_point_;
+  CAFFE_PARALLEL_FOR(count)
+  for (int i = 0; i < count; ++i) {
+    // Rounded to the nearest, saturated (NaN to 0)
+    Dtype value = input[i] * inverse_scale + zero_point + Dtype(0.5);
+    value = value > 0 ? value : Dtype(0);
+    value = value < 255 ? value : Dtype(255);
+    quantized[i] = static_cast<uint8_t>(value);
+  }
+  return quantized;
+}
+
+template <typename Dtype>
+void Int8Gemm<Dtype>::Forward(const CBLAS_TRANSPOSE TransB,
+    const int first_row, const int rows, const int n, const uint8_t* input,
+    Dtype* output, const int row_stride, const int col_stride) {
+  CHECK_LE(first_row + rows, rows_);
+  product_.resize(rows * n);
+  int32_t* product = product_.data();
+  caffe_cpu_gemm_s8u8s32(TransB, rows, n, cols_,
+      weights_.data() + first_row * cols_, input, product);
+  const Dtype* weight_scales = weight_scales_.data() + first_row;
+  const int32_t* row_sums = row_sums_.data() + first_row;
+  const Dtype input_scale = input_scale_;
+  const uint32_t zero_point = zero_point_;
+  CAFFE_PARALLEL_FOR(rows * n)
+  for (int i = 0; i < rows; ++i) {
+    const Dtype scale = weight_scales[i] * input_scale;
+    const uint32_t offset = zero_point * static_cast<uint32_t>(row_sums[i]);
+    for (int j = 0; j < n; ++j) {
+      // Exact modulo 2^32, the sum over the inputs minus the zero point
+      // fitting in 32 bits like the product
+      const int32_t sum = static_cast<int32_t>(
+          static_cast<uint32_t>(product[i * n + j]) - offset);
+      output[i * row_stride + j * col_stride] = scale * sum;
+    }
+  }
+}
+
+INSTANTIATE_CLASS(Int8Gemm);
+
+}  // namespace caffe
@@ -1,9 +1,11 @@
 #include <boost/math/special_functions/next.hpp>
 #include <boost/random.hpp>
 
+#include <algorithm>
 #include <limits>
 
 #include "caffe/common.hpp"
+#include "caffe/util/fast_math.hpp"
 #include "caffe/util/math_functions.hpp"
 #include "caffe/util/rng.hpp"
 
@@ -174,10 +176,135 @@ void caffe_div<double>(const int n, const double* a, const double* b,
   vdDiv(n, a, b, y);
 }
 
+// The float exp, log, powx, sigmoid and tanh loops over the fast_math.hpp
+// approximations and the int8 GEMM loops, vectorized by the compiler. With GCC
+// on x86-64 Linux they are compiled for AVX-512, AVX2 and the baseline, picked
+// when the program is loaded for the CPU it runs on.
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) \
+    && defined(__linux__)
+#define CAFFE_TARGET_CLONES __attribute__((optimize("tree-vectorize"), \
+    target_clones("avx512f", "avx2", "default")))
+#else
+#define CAFFE_TARGET_CLONES
+#endif
+
+namespace {
+
+// The number of elements per call of a vectorized loop, the unit of work of
+// the parallel threads
+const int kFastMathBlock = 4096;
+
+#ifndef USE_MKL
+CAFFE_TARGET_CLONES void fast_exp_loop(const int n, const float* a,
+    float* y) {
+  for (int i = 0; i < n; ++i) {
+    y[i] = fast_exp(a[i]);
+  }
+}
+
+CAFFE_TARGET_CLONES void fast_log_loop(const int n, const float* a,
+    float* y) {
+  for (int i = 0; i < n; ++i) {
+    y[i] = fast_log(a[i]);
+  }
+}
+
+// a^b = e^(b log(a)), for 0 < a < inf
+CAFFE_TARGET_CLONES void fast_powx_loop(const int n, const float* a,
+    const float b, float* y) {
+  for (int i = 0; i < n; ++i) {
+    y[i] = fast_exp(b * fast_log(a[i]));
+  }
+}
+#endif  // !USE_MKL
+
+CAFFE_TARGET_CLONES void fast_sigmoid_loop(const int n, const float* a,
+    float* y) {
+  for (int i = 0; i < n; ++i) {
+    y[i] = fast_sigmoid(a[i]);
+  }
+}
+
+CAFFE_TARGET_CLONES void fast_tanh_loop(const int n, const float* a,
+    float* y) {
+  for (int i = 0; i < n; ++i) {
+    y[i] = fast_tanh(a[i]);
+  }
+}
+
+// c[0, n) = sum over k < K of a[k] B[k][0, n), B having ldb columns
+CAFFE_TARGET_CLONES void gemm_s8u8s32_row(const int n, const int K,
+    const int8_t* a, const uint8_t* B, const int ldb, int32_t* c) {
+  std::fill(c, c + n, 0);
+  for (int k = 0; k < K; ++k) {
+    const int32_t a_k = a[k];
+    const uint8_t* b = B + k * ldb;
+    for (int j = 0; j < n; ++j) {
+      c[j] += a_k * b[j];
+    }
+  }
+}
+
+// c[j] = the dot product of a and row j of B (K wide), for j < n
+CAFFE_TARGET_CLONES void gemm_s8u8s32_dots(const int n, const int K,
+    const int8_t* a, const uint8_t* B, int32_t* c) {
+  for (int j = 0; j < n; ++j) {
+    const uint8_t* b = B + j * K;
+    int32_t sum = 0;
+    for (int k = 0; k < K; ++k) {
+      sum += a[k] * b[k];
+    }
+    c[j] = sum;
+  }
+}
+
+// The columns of C computed at once by gemm_s8u8s32_row, which stay in the
+// L1 cache while the rows of B stream through
+const int kInt8GemmBlock = 1024;
+
+// Runs loop over blocks of kFastMathBlock elements, in parallel
+void fast_math_blocks(void (*loop)(const int, const float*, float*),
+    const int n, const float* a, float* y) {
+  CAFFE_PARALLEL_FOR(n)
+  for (int i = 0; i < n; i += kFastMathBlock) {
+    loop(std::min(kFastMathBlock, n - i), a + i, y + i);
+  }
+}
+
+}  // namespace
+
 template <>
 void caffe_powx<float>(const int n, const float* a, const float b,
     float* y) {
+#ifdef USE_MKL
   vsPowx(n, a, b, y);
+#else
+  if (b == 2) {
+    vsSqr(n, a, y);
+    return;
+  }
+  if (b == 0.5) {
+    vsSqrt(n, a, y);
+    return;
+  }
+  const float max = std::numeric_limits<float>::max();
+  CAFFE_PARALLEL_FOR(n)
+  for (int i = 0; i < n; i += kFastMathBlock) {
+    const int block = std::min(kFastMathBlock, n - i);
+    bool positive = true;
+    for (int j = 0; j < block; ++j) {
+      positive &= a[i + j] > 0 && a[i + j] <= max;
+    }
+    if (positive) {
+      fast_powx_loop(block, a + i, b, y + i);
+    } else {
+      // pow of 0, negative, inf and NaN
+      for (int j = 0; j < block; ++j) {
+        y[i + j] = std::pow(a[i + j], b);
+      }
+    }
+  }
+#endif
 }
 
 template <>
@@ -208,7 +335,11 @@ void caffe_sqrt<double>(const int n, const double* a, double* y) {
 
 template <>
 void caffe_exp<float>(const int n, const float* a, float* y) {
+#ifdef USE_MKL
   vsExp(n, a, y);
+#else
+  fast_math_blocks(fast_exp_loop, n, a, y);
+#endif
 }
 
 template <>
@@ -218,7 +349,11 @@ void caffe_exp<double>(const int n, const double* a, double* y) {
 
 template <>
 void caffe_log<float>(const int n, const float* a, float* y) {
+#ifdef USE_MKL
   vsLn(n, a, y);
+#else
+  fast_math_blocks(fast_log_loop, n, a, y);
+#endif
 }
 
 template <>
@@ -226,6 +361,56 @@ void caffe_log<double>(const int n, const double* a, double* y) {
   vdLn(n, a, y);
 }
 
+template <>
+void caffe_sigmoid<float>(const int n, const float* a, float* y) {
+  fast_math_blocks(fast_sigmoid_loop, n, a, y);
+}
+
+template <>
+void caffe_sigmoid<double>(const int n, const double* a, double* y) {
+  CAFFE_PARALLEL_FOR(n)
+  for (int i = 0; i < n; ++i) {
+    y[i] = fast_sigmoid(a[i]);
+  }
+}
+
+template <>
+void caffe_tanh<float>(const int n, const float* a, float* y) {
+  fast_math_blocks(fast_tanh_loop, n, a, y);
+}
+
+template <>
+void caffe_tanh<double>(const int n, const double* a, double* y) {
+  CAFFE_PARALLEL_FOR(n)
+  for (int i = 0; i < n; ++i) {
+    y[i] = fast_tanh(a[i]);
+  }
+}
+
+void caffe_cpu_gemm_s8u8s32(const CBLAS_TRANSPOSE TransB, const int M,
+    const int N, const int K, const int8_t* A, const uint8_t* B, int32_t* C) {
+  CHECK_LE(K, kMaxInt8GemmK);
+#ifdef _OPENMP
+  const int work = static_cast<int>(std::min<int64_t>(
+      std::numeric_limits<int>::max(), static_cast<int64_t>(M) * N * K));
+#endif
+  if (TransB == CblasNoTrans) {
+    const int blocks = (N + kInt8GemmBlock - 1) / kInt8GemmBlock;
+    CAFFE_PARALLEL_FOR(work)
+    for (int t = 0; t < M * blocks; ++t) {
+      const int i = t / blocks;
+      const int j = (t % blocks) * kInt8GemmBlock;
+      gemm_s8u8s32_row(std::min(kInt8GemmBlock, N - j), K, A + i * K, B + j,
+          N, C + i * N + j);
+    }
+  } else {
+    CAFFE_PARALLEL_FOR(work)
+    for (int i = 0; i < M; ++i) {
+      gemm_s8u8s32_dots(N, K, A + i * K, B, C + i * N);
+    }
+  }
+}
+
 template <>
 void caffe_abs<float>(const int n, const float* a, float* y) {
     vsAbs(n, a, y);
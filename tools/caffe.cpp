@@ -6,6 +6,7 @@ namespace bp = boost::python;
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
+#include <algorithm>
 #include <cstring>
 #include <map>
 #include <string>
@@ -54,6 +55,14 @@ DEFINE_string(sigint_effect, "stop",
 DEFINE_string(sighup_effect, "snapshot",
              "Optional; action to take when a SIGHUP signal is received: "
              "snapshot, stop or none.");
+DEFINE_int32(numa_node, -1,
+    "Optional; bind the large host buffers to this NUMA node. By default "
+    "they are placed on the node of the first thread writing them.");
+DEFINE_bool(huge_pages, false,
+    "Optional; back the large host buffers with transparent huge pages.");
+DEFINE_bool(host_memory_pool, false,
+    "Optional; recycle the host buffers released by blob reshapes instead of "
+    "returning them to the system.");
 
 // A simple registry for caffe commands.
 typedef int (*BrewFunction)();
@@ -275,8 +284,8 @@ int test() {
     LOG(INFO) << "Use CPU.";
     Caffe::set_mode(Caffe::CPU);
   }
-  // Instantiate the caffe net.
-  Net<float> caffe_net(FLAGS_model, caffe::TEST, FLAGS_level, &stages);
+  // Instantiate the caffe net (forward only).
+  Net<float> caffe_net(FLAGS_model, caffe::TEST, FLAGS_level, &stages, true);
   caffe_net.CopyTrainedLayersFrom(FLAGS_weights);
   LOG(INFO) << "Running for " << FLAGS_iterations << " iterations.";
 
@@ -432,6 +441,16 @@ int main(int argc, char** argv) {
       "  time            benchmark model execution time");
   // Run tool or show usage.
   caffe::GlobalInit(&argc, &argv);
+  shared_ptr<caffe::HostAllocator> host_allocator(
+      new caffe::AlignedHostAllocator(
+          caffe::AlignedHostAllocator::kHugePageSize, FLAGS_huge_pages,
+          FLAGS_numa_node < 0 ? caffe::AlignedHostAllocator::FIRST_TOUCH
+                              : caffe::AlignedHostAllocator::BIND,
+          std::max(FLAGS_numa_node, 0)));
+  if (FLAGS_host_memory_pool) {
+    host_allocator.reset(new caffe::PooledHostAllocator(host_allocator));
+  }
+  caffe::SetHostAllocator(host_allocator);
   if (argc == 2) {
 #ifdef WITH_PYTHON_LAYER
     try {
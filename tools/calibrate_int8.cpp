@@ -0,0 +1,180 @@
+// Calibrates the int8 inference path of the Convolution and InnerProduct
+// layers: runs the net over the batches of its data layers, recording the
+// range of the input of each of these layers, and writes the model with the
+// ranges as quantization_param. It then compares the outputs and the speed of
+// the int8 net with the float net, over the same batches.
+// Usage:
+//    calibrate_int8 --model=net.prototxt --weights=net.caffemodel
+//        --output=net_int8.prototxt [--iterations=50]
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "caffe/caffe.hpp"
+#include "caffe/util/io.hpp"
+#include "caffe/util/upgrade_proto.hpp"
+
+using caffe::Blob;
+using caffe::Caffe;
+using caffe::Net;
+using caffe::NetParameter;
+using caffe::string;
+using caffe::Timer;
+using caffe::vector;
+
+DEFINE_string(model, "",
+    "The model definition protocol buffer text file, with data layers "
+    "providing the calibration samples.");
+DEFINE_string(weights, "",
+    "The trained weights.");
+DEFINE_string(output, "",
+    "The model definition to write, with the quantization_param.");
+DEFINE_int32(iterations, 50,
+    "The number of batches to calibrate on, and then to compare.");
+
+// Records the range of the inputs of the convolutions and inner products
+class RangeRecorder : public Net<float>::Callback {
+ public:
+  explicit RangeRecorder(const Net<float>& net)
+      : net_(net), min_(net.layers().size(), 0),
+        max_(net.layers().size(), 0) {}
+
+  bool quantized(const int layer) const {
+    const string type = net_.layers()[layer]->type();
+    return type == "Convolution" || type == "InnerProduct";
+  }
+  float min(const int layer) const { return min_[layer]; }
+  float max(const int layer) const { return max_[layer]; }
+
+ protected:
+  virtual void run(int layer) {
+    if (!quantized(layer)) {
+      return;
+    }
+    const vector<Blob<float>*>& bottom = net_.bottom_vecs()[layer];
+    for (int i = 0; i < bottom.size(); ++i) {
+      const float* data = bottom[i]->cpu_data();
+      const int count = bottom[i]->count();
+      min_[layer] =
+          std::min(min_[layer], *std::min_element(data, data + count));
+      max_[layer] =
+          std::max(max_[layer], *std::max_element(data, data + count));
+    }
+  }
+
+ private:
+  const Net<float>& net_;
+  vector<float> min_;
+  vector<float> max_;
+};
+
+int main(int argc, char** argv) {
+  FLAGS_alsologtostderr = 1;
+  gflags::SetUsageMessage("Calibrates the int8 inference path of a model.\n"
+      "Usage: calibrate_int8 --model=net.prototxt --weights=net.caffemodel "
+      "--output=net_int8.prototxt [--iterations=50]");
+  caffe::GlobalInit(&argc, &argv);
+  CHECK_GT(FLAGS_model.size(), 0) << "Need a model definition to calibrate.";
+  CHECK_GT(FLAGS_weights.size(), 0) << "Need model weights to calibrate.";
+  CHECK_GT(FLAGS_output.size(), 0) << "Need a file to write the model to.";
+  CHECK_GT(FLAGS_iterations, 0);
+  // The int8 path is CPU only
+  Caffe::set_mode(Caffe::CPU);
+
+  NetParameter float_param;
+  caffe::ReadNetParamsFromTextFileOrDie(FLAGS_model, &float_param);
+  float_param.mutable_state()->set_phase(caffe::TEST);
+  for (int i = 0; i < float_param.layer_size(); ++i) {
+    float_param.mutable_layer(i)->clear_quantization_param();
+  }
+  NetParameter int8_param = float_param;
+
+  // Ranges of the inputs
+  {
+    Net<float> net(float_param);
+    net.CopyTrainedLayersFrom(FLAGS_weights);
+    RangeRecorder recorder(net);
+    net.add_before_forward(&recorder);
+    LOG(INFO) << "Calibrating on " << FLAGS_iterations << " batches.";
+    for (int i = 0; i < FLAGS_iterations; ++i) {
+      net.Forward();
+    }
+    std::map<string, int> layer_ids;
+    for (int layer_id = 0; layer_id < net.layers().size(); ++layer_id) {
+      layer_ids[net.layer_names()[layer_id]] = layer_id;
+    }
+    for (int i = 0; i < int8_param.layer_size(); ++i) {
+      caffe::LayerParameter* layer_param = int8_param.mutable_layer(i);
+      std::map<string, int>::const_iterator it =
+          layer_ids.find(layer_param->name());
+      if (it == layer_ids.end() || !recorder.quantized(it->second)) {
+        continue;
+      }
+      caffe::QuantizationParameter* quantization =
+          layer_param->mutable_quantization_param();
+      quantization->set_input_min(recorder.min(it->second));
+      quantization->set_input_max(recorder.max(it->second));
+      LOG(INFO) << layer_param->name() << ": input range ["
+          << quantization->input_min() << ", " << quantization->input_max()
+          << "]";
+    }
+  }
+  caffe::WriteProtoToTextFile(int8_param, FLAGS_output);
+  LOG(INFO) << "Wrote " << FLAGS_output;
+
+  // Accuracy and speed against the float net, both starting from the first
+  // batch again
+  Net<float> float_net(float_param);
+  float_net.CopyTrainedLayersFrom(FLAGS_weights);
+  Net<float> int8_net(int8_param);
+  int8_net.CopyTrainedLayersFrom(FLAGS_weights);
+  const vector<Blob<float>*>& float_outputs = float_net.output_blobs();
+  const vector<Blob<float>*>& int8_outputs = int8_net.output_blobs();
+  vector<double> float_sum(float_outputs.size(), 0);
+  vector<double> int8_sum(float_outputs.size(), 0);
+  vector<double> float_squares(float_outputs.size(), 0);
+  vector<double> error_squares(float_outputs.size(), 0);
+  double float_ms = 0;
+  double int8_ms = 0;
+  Timer timer;
+  for (int i = 0; i < FLAGS_iterations; ++i) {
+    timer.Start();
+    float_net.Forward();
+    float_ms += timer.MilliSeconds();
+    timer.Start();
+    int8_net.Forward();
+    int8_ms += timer.MilliSeconds();
+    for (int j = 0; j < float_outputs.size(); ++j) {
+      const float* expected = float_outputs[j]->cpu_data();
+      const float* result = int8_outputs[j]->cpu_data();
+      for (int k = 0; k < float_outputs[j]->count(); ++k) {
+        float_sum[j] += expected[k];
+        int8_sum[j] += result[k];
+        float_squares[j] += expected[k] * expected[k];
+        const double error = result[k] - expected[k];
+        error_squares[j] += error * error;
+      }
+    }
+  }
+  for (int j = 0; j < float_outputs.size(); ++j) {
+    const string& name =
+        float_net.blob_names()[float_net.output_blob_indices()[j]];
+    if (float_outputs[j]->count() == 1) {
+      // A score, such as an accuracy or a loss
+      LOG(INFO) << name << ": float " << float_sum[j] / FLAGS_iterations
+          << ", int8 " << int8_sum[j] / FLAGS_iterations;
+    } else {
+      LOG(INFO) << name << ": relative RMS error of int8 "
+          << std::sqrt(error_squares[j] / std::max(float_squares[j], 1e-30));
+    }
+  }
+  LOG(INFO) << "Average Forward pass: float " << float_ms / FLAGS_iterations
+      << " ms, int8 " << int8_ms / FLAGS_iterations << " ms.";
+  return 0;
+}
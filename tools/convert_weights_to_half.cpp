@@ -0,0 +1,77 @@
+// Converts the weights of a binary model to 16 bit floats, halving the size of
+// the file. The nets read it like any other model, converting the weights back
+// to float when loading them: the memory use of the net does not change.
+// Legacy (V1) models are upgraded first. With float16, the blobs holding values
+// beyond its range (e.g. BatchNorm statistics) are kept as floats.
+// Usage:
+//    convert_weights_to_half [bfloat16|float16] net_proto_file_in
+//        net_proto_file_out
+
+#include <cmath>
+#include <string>
+
+#include "caffe/caffe.hpp"
+#include "caffe/util/half.hpp"
+#include "caffe/util/io.hpp"
+#include "caffe/util/upgrade_proto.hpp"
+
+using namespace caffe;  // NOLINT(build/namespaces)
+
+// Whether a finite value of blob would become inf in float16
+bool OverflowsFloat16(const Blob<float>& blob) {
+  const float* data = blob.cpu_data();
+  for (int i = 0; i < blob.count(); ++i) {
+    if (std::isfinite(data[i])
+        && std::isinf(float16_to_float(float_to_float16(data[i])))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int main(int argc, char** argv) {
+  FLAGS_alsologtostderr = 1;  // Print output to stderr (while still logging)
+  ::google::InitGoogleLogging(argv[0]);
+  if (argc != 4) {
+    LOG(ERROR) << "Usage: convert_weights_to_half [bfloat16|float16] "
+        << "net_proto_file_in net_proto_file_out";
+    return 1;
+  }
+  const string format_name(argv[1]);
+  HalfFormat format;
+  if (format_name == "bfloat16") {
+    format = BFLOAT16;
+  } else if (format_name == "float16") {
+    format = FLOAT16;
+  } else {
+    LOG(ERROR) << "Unknown format " << format_name
+        << ", expected bfloat16 or float16";
+    return 1;
+  }
+
+  NetParameter net_param;
+  ReadNetParamsFromBinaryFileOrDie(argv[2], &net_param);
+  // Upgraded by ReadNetParamsFromBinaryFileOrDie: nothing in the V1 layers
+  // would be converted
+  CHECK_EQ(net_param.layers_size(), 0) << "Could not upgrade " << argv[2];
+  int count = 0;
+  for (int i = 0; i < net_param.layer_size(); ++i) {
+    LayerParameter* layer_param = net_param.mutable_layer(i);
+    for (int j = 0; j < layer_param->blobs_size(); ++j) {
+      Blob<float> blob;
+      blob.FromProto(layer_param->blobs(j));
+      if (format == FLOAT16 && OverflowsFloat16(blob)) {
+        LOG(WARNING) << "Blob " << j << " of layer " << layer_param->name()
+            << " exceeds the float16 range, kept as float";
+        continue;
+      }
+      blob.ToHalfProto(layer_param->mutable_blobs(j), format);
+      count += blob.count();
+    }
+  }
+  WriteProtoToBinaryFile(net_param, argv[3]);
+
+  LOG(INFO) << "Wrote " << count << " weights as " << argv[1] << " to "
+      << argv[3];
+  return 0;
+}
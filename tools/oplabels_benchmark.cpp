@@ -0,0 +1,190 @@
+// Benchmark of the OpenPose label renderer (caffe_oplabels), CPU only.
+// Each rendering engine is compared against the scalar reference.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+
+#ifdef USE_OPENCV
+#include "caffe/openpose/labelRenderer.hpp"
+#include "caffe/openpose/poseModel.hpp"
+#endif  // USE_OPENCV
+
+DEFINE_string(model, "COCO_18",
+    "The pose model (COCO_18, COCO_23, DOME_59, ...)");
+DEFINE_int32(batch_size, 10, "Number of images rendered per iteration");
+DEFINE_int32(people, 6, "Number of people per image");
+DEFINE_int32(crop_size, 368, "Input image size (square)");
+DEFINE_int32(stride, 8, "Label stride");
+DEFINE_double(sigma, 7., "Gaussian sigma (in input pixels)");
+DEFINE_double(min_time, 0.5, "Minimum time (in seconds) per benchmark");
+DEFINE_int32(seed, 1701, "Random seed for the synthetic keypoints");
+
+#ifdef USE_OPENCV
+using namespace caffe;  // NOLINT(build/namespaces)
+
+namespace {
+
+struct BenchmarkResult {
+  double real_time_ns;
+  double cpu_time_ns;
+  long long iterations;
+};
+
+// Doubles the number of iterations until the run takes at least min_time
+BenchmarkResult RunBenchmark(const std::function<void()>& function) {
+  long long iterations = 1;
+  while (true) {
+    const auto cpu_begin = std::clock();
+    const auto begin = std::chrono::steady_clock::now();
+    for (long long i = 0; i < iterations; ++i) {
+      function();
+    }
+    const double seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - begin).count();
+    const double cpu_seconds =
+        (std::clock() - cpu_begin) / double(CLOCKS_PER_SEC);
+    if (seconds >= FLAGS_min_time || iterations >= (1ll << 30)) {
+      return BenchmarkResult{1e9 * seconds / iterations,
+                             1e9 * cpu_seconds / iterations, iterations};
+    }
+    iterations *= 2;
+  }
+}
+
+// max_error < 0 if not compared against the reference
+void PrintResult(const std::string& name, const BenchmarkResult& result,
+                 const double max_error = -1.) {
+  std::printf("%-36s %12.0f ns %12.0f ns %10lld", name.c_str(),
+              result.real_time_ns, result.cpu_time_ns, result.iterations);
+  if (max_error >= 0.) {
+    std::printf(" max_error=%g", max_error);
+  }
+  std::printf("\n");
+}
+
+double MaxError(const std::vector<float>& a, const std::vector<float>& b) {
+  double max_error = 0.;
+  for (size_t i = 0; i < a.size(); ++i) {
+    max_error = std::max(max_error, double(std::abs(a[i] - b[i])));
+  }
+  return max_error;
+}
+
+}  // namespace
+#endif  // USE_OPENCV
+
+int main(int argc, char** argv) {
+#ifdef USE_OPENCV
+  ::google::InitGoogleLogging(argv[0]);
+  FLAGS_alsologtostderr = 1;
+
+#ifndef GFLAGS_GFLAGS_H_
+  namespace gflags = google;
+#endif
+
+  gflags::SetUsageMessage("Benchmark the OpenPose heat map and PAF label "
+        "renderer on synthetic keypoints\n"
+        "Usage:\n"
+        "    oplabels_benchmark [FLAGS]\n");
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  const PoseModel pose_model = flagsToPoseModel(FLAGS_model).first;
+  const int number_body_parts = getNumberBodyParts(pose_model);
+  const int number_channels =
+      getNumberPafChannels(pose_model) + number_body_parts + 1;
+  const LabelRenderingParameters parameters{
+      FLAGS_crop_size / FLAGS_stride, FLAGS_crop_size / FLAGS_stride,
+      FLAGS_stride, float(FLAGS_sigma), 1};
+  const int channel_offset = parameters.gridX * parameters.gridY;
+
+  // Synthetic people (some keypoints outside the image, some not labeled)
+  std::mt19937 generator(FLAGS_seed);
+  std::uniform_real_distribution<float> coordinate(-0.1f * FLAGS_crop_size,
+                                                   1.1f * FLAGS_crop_size);
+  std::uniform_int_distribution<int> visibility(0, 2);
+  std::vector<std::vector<Joints> > people_per_image(FLAGS_batch_size);
+  for (auto& people : people_per_image) {
+    people.resize(FLAGS_people);
+    for (auto& joints : people) {
+      for (int part = 0; part < number_body_parts; ++part) {
+        joints.points.emplace_back(coordinate(generator),
+                                   coordinate(generator));
+        joints.isVisible.push_back(float(visibility(generator)));
+      }
+    }
+  }
+
+  LOG(INFO) << "Model: " << FLAGS_model << ", batch: " << FLAGS_batch_size
+      << " x " << number_channels << " x " << parameters.gridY << " x "
+      << parameters.gridX << ", people per image: " << FLAGS_people
+      << ", best engine: "
+      << getLabelRenderingEngineName(LabelRenderingEngine::Auto);
+
+  const std::vector<LabelRenderingEngine> engines{
+      LabelRenderingEngine::Reference, LabelRenderingEngine::Scalar,
+      LabelRenderingEngine::Avx2, LabelRenderingEngine::Avx512};
+  std::vector<float> reference(
+      size_t(FLAGS_batch_size) * number_channels * channel_offset);
+  renderLabelsBatch(reference.data(), people_per_image, pose_model, parameters,
+                    LabelRenderingEngine::Reference);
+
+  std::printf("%-36s %15s %15s %10s\n", "Benchmark", "Time", "CPU",
+              "Iterations");
+  std::printf("%s\n", std::string(80, '-').c_str());
+  for (const auto engine : engines) {
+    if (!isLabelRenderingEngineSupported(engine)) {
+      LOG(INFO) << getLabelRenderingEngineName(engine)
+          << " not supported by this CPU, skipped.";
+      continue;
+    }
+    const std::string engine_name = getLabelRenderingEngineName(engine);
+
+    // Single heat map and PAF channel
+    std::vector<float> heat_map(channel_offset);
+    const auto gaussian_result = RunBenchmark([&]() {
+      std::fill(heat_map.begin(), heat_map.end(), 0.f);
+      for (const auto& joints : people_per_image[0]) {
+        putGaussianMaps(heat_map.data(), joints.points[0], parameters.stride,
+                        parameters.gridX, parameters.gridY, parameters.sigma,
+                        engine);
+      }
+    });
+    PrintResult("BM_PutGaussianMaps/" + engine_name, gaussian_result);
+
+    std::vector<float> paf(2 * channel_offset);
+    std::vector<float> count(channel_offset);
+    const auto paf_result = RunBenchmark([&]() {
+      std::fill(paf.begin(), paf.end(), 0.f);
+      std::fill(count.begin(), count.end(), 0.f);
+      for (const auto& joints : people_per_image[0]) {
+        putVectorMaps(paf.data(), paf.data() + channel_offset, count.data(),
+                      joints.points[0], joints.points[1], parameters.stride,
+                      parameters.gridX, parameters.gridY,
+                      parameters.threshold, engine);
+      }
+    });
+    PrintResult("BM_PutVectorMaps/" + engine_name, paf_result);
+
+    // Whole batch
+    std::vector<float> labels(reference.size());
+    const auto batch_result = RunBenchmark([&]() {
+      renderLabelsBatch(labels.data(), people_per_image, pose_model,
+                        parameters, engine);
+    });
+    PrintResult("BM_RenderLabelsBatch/" + engine_name, batch_result,
+                MaxError(labels, reference));
+  }
+#else
+  LOG(FATAL) << "This tool requires OpenCV; compile with USE_OPENCV.";
+#endif  // USE_OPENCV
+  return 0;
+}